@@ -1,5 +1,6 @@
 #pragma once
 #include <opendxa/core/particle_property.h>
+#include <opendxa/analysis/neighbor_list_cache.h>
 #include <opendxa/core/simulation_cell.h>
 #include <opendxa/structures/lattice_structure.h>
 
@@ -22,6 +23,9 @@ public:
     std::shared_ptr<ParticleProperty> correspondencesCode;
     std::shared_ptr<ParticleProperty> templateIndex;
 
+    // Nearest-neighbor trees shared by the analyses run on this context
+    std::shared_ptr<NeighborListCache> neighborCache;
+
     // Simulation
     const SimulationCell& simCell;
     LatticeStructureType inputCrystalType;
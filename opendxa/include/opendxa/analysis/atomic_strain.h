@@ -85,8 +85,8 @@ public:
         bool computeStrain(
             std::size_t particleIndex,
             CutoffNeighborFinder& neighborFinder,
-            const std::vector<int>& refToCurrentIndexMap,
-            const std::vector<int>& currentToRefIndexMap
+            const std::vector<AtomIndex>& refToCurrentIndexMap,
+            const std::vector<AtomIndex>& currentToRefIndexMap
         );
 
         Particles::ParticleProperty* _positions;
@@ -37,6 +37,11 @@ public:
         
         void perform();
 
+        // Coordinate type of the cell list used to find the neighbors
+        void setPrecision(SearchPrecision precision){
+            _precision = precision;
+        }
+
         std::shared_ptr<ParticleProperty> particleClusters() const{
             return _particleClusters;
         }
@@ -90,6 +95,7 @@ public:
     
         NeighborMode _neighborMode;
         double _cutoff;
+        SearchPrecision _precision = SearchPrecision::Double;
         bool _onlySelectedParticles;
         bool _sortBySize;
         bool _unwrapParticleCoordinates;
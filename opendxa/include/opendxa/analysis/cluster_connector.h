@@ -21,7 +21,7 @@ private:
 	void initializeClustersForSuperclusterFormation();
 	void processDefectClusters();
 
-	void connectClusterNeighbors(int atomIndex, Cluster* cluster1);
+	void connectClusterNeighbors(AtomIndex atomIndex, Cluster* cluster1);
 	void processAtomConnections(size_t atomIndex);
 
 	void mergeCompatibleGrains(size_t oldTransitionCount, size_t newTransitionCount);
@@ -30,30 +30,30 @@ private:
 	void buildClustersForPTM();
 	void baseBuildClusters();
 	void initializePTMClusterOrientation(Cluster* cluster, size_t seedAtomIndex);
-void growClusterPTM(Cluster* cluster, std::deque<int>& atomsToVisit, int structureType);
+void growClusterPTM(Cluster* cluster, std::deque<AtomIndex>& atomsToVisit, int structureType);
 	void growCluster(
 		Cluster* cluster,
-		std::deque<int>& atomsToVisit,
+		std::deque<AtomIndex>& atomsToVisit,
 		Matrix_3<double>& orientationV,
 		Matrix_3<double>& orientationW,
 		int structureType
 	);
 
-    bool alreadyProcessedAtom(int index);
-	bool calculateMisorientation(int atomIndex, int neighbor, int neighborIndex, Matrix3& outTransition);
-	bool areOrientationsCompatible(int atom1, int atom2, int structureType);
-    Quaternion getPTMAtomOrientation(int atom) const;
+    bool alreadyProcessedAtom(AtomIndex index);
+	bool calculateMisorientation(AtomIndex atomIndex, AtomIndex neighbor, int neighborIndex, Matrix3& outTransition);
+	bool areOrientationsCompatible(AtomIndex atom1, AtomIndex atom2, int structureType);
+    Quaternion getPTMAtomOrientation(AtomIndex atom) const;
 
 	std::pair<Cluster*, Cluster*> getParentGrains(ClusterTransition* transition);
 	ClusterTransition* buildParentTransition(ClusterTransition* transition, Cluster* parent1, Cluster* parent2);
-	Cluster* startNewCluster(int atomIndex, int structureType);
+	Cluster* startNewCluster(AtomIndex atomIndex, int structureType);
 	Cluster* getParentGrain(Cluster* c);
 
 	Matrix3 quaternionToMatrix(const Quaternion& q);
 
-	void processNeighborConnection(int atomIndex, int neighbor, int neighborIndex, Cluster* cluster1, int structureType);
-	void addReverseNeighbor(int neighbor, int atomIndex);
-	void createNewClusterTransition(int atomIndex, int neighbor, int neighborIndex, Cluster* cluster1, Cluster* cluster2);
+	void processNeighborConnection(AtomIndex atomIndex, AtomIndex neighbor, int neighborIndex, Cluster* cluster1, int structureType);
+	void addReverseNeighbor(AtomIndex neighbor, AtomIndex atomIndex);
+	void createNewClusterTransition(AtomIndex atomIndex, AtomIndex neighbor, int neighborIndex, Cluster* cluster1, Cluster* cluster2);
 
 	void processDefectCluster(Cluster* defectCluster);
 	void reorientAtomsToAlignClusters();
@@ -3,6 +3,7 @@
 #include <opendxa/core/opendxa.h>
 #include <opendxa/structures/neighbor_bond_array.h>
 #include <opendxa/structures/coordination_structure.h>
+#include <cstdint>
 
 namespace OpenDXA{
 
@@ -45,19 +46,33 @@ public:
 
     static int calcMaxChainLength(CNAPairBond* neighborBonds, int numBonds);
 	static void generateCellTooSmallError(int dimension);
+    static void computeNeighborClasses(
+        const NeighborBondArray& neighborArray,
+        const int* cnaSignatures,
+        int coordinationNumber,
+        std::uint64_t* neighborClasses
+    );
+
     static bool findMatchingNeighborPermutation(
         CoordinationStructureType coordinationType,
         int* neighborMapping,
-        int* previousMapping,
         int coordinationNumber,
         const int* cnaSignatures,
         const NeighborBondArray& neighborArray,
         const CoordinationStructure* coordinationStructures
     );
 
+    // Instantiated for FCC, HCP, BCC and the two diamond lattices.
+    template<LatticeStructureType Lattice>
+    static CoordinationStructureType computeCoordinationType(
+        const NeighborBondArray& neighborArray,
+        int* cnaSignatures,
+        bool identifyPlanarDefects
+    );
+
+    // Dispatches to the instantiation for inputCrystalType.
     static CoordinationStructureType computeCoordinationType(
         const NeighborBondArray& neighborArray,
-        int coordinationNumber,
         int* cnaSignatures,
         LatticeStructureType inputCrystalType,
         bool identifyPlanarDefects
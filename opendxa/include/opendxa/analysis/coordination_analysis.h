@@ -2,6 +2,7 @@
 
 #include <opendxa/core/particle_property.h>
 #include <opendxa/analysis/cutoff_neighbor_finder.h>
+#include <opendxa/analysis/verlet_neighbor_list.h>
 
 namespace OpenDXA{
 
@@ -42,6 +43,17 @@ public:
         // Computes the modifier's result and stores them in this object for later retrieval
         void perform();
 
+        // Uses a neighbor list that is already up to date for these positions
+        // instead of building a CutoffNeighborFinder.
+        void setNeighborList(const VerletNeighborList* neighborList){
+            _neighborList = neighborList;
+        }
+
+        // Coordinate type of the cell list built when no neighbor list is set
+        void setPrecision(SearchPrecision precision){
+            _precision = precision;
+        }
+
         // Returns the property storage that contain the input particle positions
         ParticleProperty* positions() const{
             return _positions;
@@ -73,6 +85,12 @@ public:
         ParticleProperty* _positions;
         std::shared_ptr<ParticleProperty> _coordinationNumbers;
         std::vector<double> _rdfHistogram;
+        const VerletNeighborList* _neighborList = nullptr;
+        SearchPrecision _precision = SearchPrecision::Double;
+
+    private:
+        template <typename NeighborList>
+        void computeCoordination(const NeighborList& neighborList);
     };
 
 public:
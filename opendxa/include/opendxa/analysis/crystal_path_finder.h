@@ -32,16 +32,16 @@ public:
         return _structureAnalysis.clusterGraph();
     }
 
-    [[nodiscard]] std::optional<ClusterVector> findPath(int atomIndex1, int atomIndex2);
+    [[nodiscard]] std::optional<ClusterVector> findPath(AtomIndex atomIndex1, AtomIndex atomIndex2);
 
 private:
     struct PathNode{
-        int atomIndex;
+        AtomIndex atomIndex;
         ClusterVector idealVector;
         int distance = 0;
         PathNode* nextToProcess  = nullptr;
 
-        PathNode(int idx, const ClusterVector& vec) noexcept
+        PathNode(AtomIndex idx, const ClusterVector& vec) noexcept
           : atomIndex(idx), idealVector(vec){}
     };
 
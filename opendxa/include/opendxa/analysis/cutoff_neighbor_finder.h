@@ -9,24 +9,19 @@
 namespace OpenDXA{
 
 class CutoffNeighborFinder{
-private:
-    // An internal per-particle data structure
-    struct NeighborListParticle{
-        // The position of the particle, wrapped at periodic boundaries
-        Point3 pos;
-        // The offset applied to the particle when wrapping it at periodic boundaries
-        Vector_3<int8_t> pbcShift;
-        // Pointer to next particle in linked list
-        const NeighborListParticle* nextInBin;
-    };
-
 public:
     // Default constructor
     CutoffNeighborFinder(): _cutoffRadius(0), _cutoffRadiusSquared(0){}
 
     // Prepares the neighbor finder by sorting particles into a grid of a bin cells.
+    // The finder reads the positions in place, so they must outlive it.
     bool prepare(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell);
 
+    // Selects the type of the coordinate columns; takes effect with the next prepare().
+    void setPrecision(SearchPrecision precision){
+        _precision = precision;
+    }
+
     // Returns the cutoff radius set via prepare()
     double cutoffRadius() const{
         return _cutoffRadius;
@@ -76,8 +71,8 @@ public:
         // Returns the PBC shift vector between the central particle and the current neighbor
         // as if the two particles were not wrapped at the periodic boundaries of the simulation cell.
         Vector_3<int8_t> unwrappedPbcShift() const {
-			const auto& s1 = _builder.particles[_centerIndex].pbcShift;
-			const auto& s2 = _builder.particles[_neighborIndex].pbcShift;
+			const auto& s1 = _builder.pbcShifts[_centerIndex];
+			const auto& s2 = _builder.pbcShifts[_neighborIndex];
 			return Vector_3<int8_t>(
 					_pbcShift.x() - s1.x() + s2.x(),
 					_pbcShift.y() - s1.y() + s2.y(),
@@ -92,31 +87,59 @@ public:
         std::vector<Vector3I>::const_iterator _stencilIter;
         Point3I _centerBin;
         Point3I _currentBin;
-        const NeighborListParticle* _neighbor;
+        // Remaining slots of the bin currently being visited
+        size_t _binIter;
+        size_t _binEnd;
+        // Slots of the last tested batch, starting at _batchBase, that are
+        // within the cutoff and not yet returned
+        std::uint64_t _batchMask;
+        size_t _batchBase;
         size_t _neighborIndex;
         Vector_3<int8_t> _pbcShift;
+        // Center relative to the corner of the current bin, rounded to float,
+        // in single precision
+        Point3 _binCenter;
         Vector3 _delta;
         double _distSq;
     };
 
 private:
+    Point3 binOrigin(size_t bin) const;
+    Point3 wrappedPosition(size_t index) const;
+
     // The neighbor criterion
     double _cutoffRadius;
     double _cutoffRadiusSquared;
+    SearchPrecision _precision = SearchPrecision::Double;
     
     SimulationCell simCell;
 
     // Number of bins in each spatial direction
     int binDim[3];
 
-    // Used to determine the bin from a particle position
+    // Maps bin coordinates to positions and back
+    AffineTransformation binCell;
     AffineTransformation reciprocalBinCell;
 
-    // The internal list of particles
-    std::vector<NeighborListParticle> particles;
-
-    // An 3d array of cubic bins. Each bin is a linked list of particles.
-    std::vector<const NeighborListParticle*> bins;
+    // The input positions, which are not copied. A particle is wrapped at
+    // the periodic boundaries by adding pbcShifts[i] cell vectors to them.
+    const Point3* _positions = nullptr;
+    std::vector<Vector_3<int8_t>> pbcShifts;
+
+    // An 3d array of cubic bins in compressed sparse row form: the particles
+    // of bin b occupy slots [binStart[b], binStart[b+1]) of binParticles, which
+    // holds their indices, and of binX/binY/binZ, which hold a copy of their
+    // wrapped coordinates so a bin is tested in SIMD batches. In single
+    // precision binXf/binYf/binZf replace them and hold the coordinates
+    // relative to the lower corner of the bin.
+    std::vector<size_t> binStart;
+    std::vector<AtomIndex> binParticles;
+    std::vector<double> binX;
+    std::vector<double> binY;
+    std::vector<double> binZ;
+    std::vector<float> binXf;
+    std::vector<float> binYf;
+    std::vector<float> binZf;
 
     // The list of adjacent cells to visit while finding
     // the neighbors of a central particle
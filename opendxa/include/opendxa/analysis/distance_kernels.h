@@ -0,0 +1,133 @@
+#pragma once
+
+// Batched squared-distance tests for the neighbor finders. Candidates are
+// stored as separate x/y/z columns, so one AVX-512 (8 doubles) or AVX2
+// (4 doubles) iteration tests a whole batch against the query point and
+// yields a bitmask of the candidates that pass. Callers then visit only the
+// set bits. Finders in single precision mode store float columns, which fit
+// twice as many candidates into a register. As with the tokenizer, the
+// instruction set is chosen when the library is compiled (-march=native);
+// other targets use the scalar loop.
+
+#include <opendxa/core/opendxa.h>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace OpenDXA::DistanceKernels{
+
+// Largest batch a single withinMask() call accepts.
+constexpr size_t MaxBatch = 64;
+
+// Returns a mask whose bit i is set when the squared distance between q and
+// point i, for i < n <= MaxBatch, is at most limitSq.
+inline std::uint64_t withinMask(const double* x, const double* y, const double* z, size_t n, const Point3& q, double limitSq){
+    std::uint64_t mask = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512d qx = _mm512_set1_pd(q.x());
+    const __m512d qy = _mm512_set1_pd(q.y());
+    const __m512d qz = _mm512_set1_pd(q.z());
+    const __m512d limit = _mm512_set1_pd(limitSq);
+    for(; i + 8 <= n; i += 8){
+        const __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + i), qx);
+        const __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + i), qy);
+        const __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(z + i), qz);
+        const __m512d d2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+        mask |= static_cast<std::uint64_t>(_mm512_cmp_pd_mask(d2, limit, _CMP_LE_OQ)) << i;
+    }
+#elif defined(__AVX2__)
+    const __m256d qx = _mm256_set1_pd(q.x());
+    const __m256d qy = _mm256_set1_pd(q.y());
+    const __m256d qz = _mm256_set1_pd(q.z());
+    const __m256d limit = _mm256_set1_pd(limitSq);
+    for(; i + 4 <= n; i += 4){
+        const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), qx);
+        const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), qy);
+        const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), qz);
+        const __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+        mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_cmp_pd(d2, limit, _CMP_LE_OQ))) << i;
+    }
+#endif
+    // The tail counts from zero: with n a compile-time multiple of the
+    // vector width, GCC 12 reports a bogus out-of-range iteration for a
+    // loop that continues from i.
+    for(size_t j = 0; j < n - i; j++){
+        const double dx = x[i + j] - q.x();
+        const double dy = y[i + j] - q.y();
+        const double dz = z[i + j] - q.z();
+        mask |= static_cast<std::uint64_t>(dx * dx + dy * dy + dz * dz <= limitSq) << (i + j);
+    }
+    return mask;
+}
+
+// Relative widening of the limit in the single-precision test. Rounding the
+// differences and their squares to float changes a squared distance by a few
+// ulps, far less than this.
+constexpr double SinglePrecisionSlack = 1e-5;
+
+// Single-precision variant for coordinates stored as float. The components of
+// q must be representable as float. The test is conservative: every point whose
+// squared distance, evaluated in double from the stored floats, is at most
+// limitSq has its bit set, so callers must repeat the exact test on the bits
+// they visit.
+inline std::uint64_t withinMask(const float* x, const float* y, const float* z, size_t n, const Point3& q, double limitSq){
+    const float limitf = limitSq < std::numeric_limits<float>::max() ? static_cast<float>(limitSq * (1 + SinglePrecisionSlack)) : std::numeric_limits<float>::infinity();
+    const float qxf = static_cast<float>(q.x());
+    const float qyf = static_cast<float>(q.y());
+    const float qzf = static_cast<float>(q.z());
+    std::uint64_t mask = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512 qx = _mm512_set1_ps(qxf);
+    const __m512 qy = _mm512_set1_ps(qyf);
+    const __m512 qz = _mm512_set1_ps(qzf);
+    const __m512 limit = _mm512_set1_ps(limitf);
+    for(; i + 16 <= n; i += 16){
+        const __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(x + i), qx);
+        const __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(y + i), qy);
+        const __m512 dz = _mm512_sub_ps(_mm512_loadu_ps(z + i), qz);
+        const __m512 d2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+        mask |= static_cast<std::uint64_t>(_mm512_cmp_ps_mask(d2, limit, _CMP_LE_OQ)) << i;
+    }
+#elif defined(__AVX2__)
+    const __m256 qx = _mm256_set1_ps(qxf);
+    const __m256 qy = _mm256_set1_ps(qyf);
+    const __m256 qz = _mm256_set1_ps(qzf);
+    const __m256 limit = _mm256_set1_ps(limitf);
+    for(; i + 8 <= n; i += 8){
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), qx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), qy);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), qz);
+        const __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_cmp_ps(d2, limit, _CMP_LE_OQ))) << i;
+    }
+#endif
+    for(size_t j = 0; j < n - i; j++){
+        const float dx = x[i + j] - qxf;
+        const float dy = y[i + j] - qyf;
+        const float dz = z[i + j] - qzf;
+        mask |= static_cast<std::uint64_t>(dx * dx + dy * dy + dz * dz <= limitf) << (i + j);
+    }
+    return mask;
+}
+
+// Index of the lowest set bit of a non-zero mask.
+inline int lowestBit(std::uint64_t mask){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int i = 0;
+    while(!(mask & 1)){
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+}
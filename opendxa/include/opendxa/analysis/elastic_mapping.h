@@ -11,14 +11,14 @@ namespace OpenDXA {
 
 class ElasticMapping{
     struct TessellationEdge{
-        int vertex1;
-        int vertex2;
+        AtomIndex vertex1;
+        AtomIndex vertex2;
         Vector3 clusterVector{};
         ClusterTransition* clusterTransition = nullptr;
         TessellationEdge* nextLeavingEdge = nullptr;
         TessellationEdge* nextArrivingEdge = nullptr;
 
-        TessellationEdge(int v1, int v2) noexcept : vertex1(v1), vertex2(v2){}
+        TessellationEdge(AtomIndex v1, AtomIndex v2) noexcept : vertex1(v1), vertex2(v2){}
 
         [[nodiscard]] bool hasClusterVector() const noexcept{
 			return clusterTransition != nullptr;
@@ -68,12 +68,12 @@ public:
     [[nodiscard]] auto isElasticMappingCompatible(DelaunayTessellation::CellHandle cell) const -> bool;
     void releaseCaches() noexcept;
 
-    [[nodiscard]] auto clusterOfVertex(int idx) const noexcept -> Cluster*{
-		assert(idx < (int)_vertexClusters.size());
+    [[nodiscard]] auto clusterOfVertex(AtomIndex idx) const noexcept -> Cluster*{
+		assert(idx >= 0 && static_cast<size_t>(idx) < _vertexClusters.size());
 		return _vertexClusters[idx];
 	}
 
-    [[nodiscard]] auto getEdgeClusterVector(int v1, int v2) const -> std::pair<Vector3, ClusterTransition*>{
+    [[nodiscard]] auto getEdgeClusterVector(AtomIndex v1, AtomIndex v2) const -> std::pair<Vector3, ClusterTransition*>{
         auto* e = findEdge(v1, v2);
         assert(e && e->hasClusterVector());
         if(e->vertex1 == v1){
@@ -87,13 +87,13 @@ public:
     }
 
 private:
-    [[nodiscard]] auto edgeCount() const noexcept -> int {
+    [[nodiscard]] auto edgeCount() const noexcept -> size_t {
 		return _edgeCount;
 	}
 
-    [[nodiscard]] auto findEdge(int v1, int v2) const noexcept -> TessellationEdge* {
-        assert(v1 >= 0 && v1 < static_cast<int>(_vertexEdges.size()));
-        assert(v2 >= 0 && v2 < static_cast<int>(_vertexEdges.size()));
+    [[nodiscard]] auto findEdge(AtomIndex v1, AtomIndex v2) const noexcept -> TessellationEdge* {
+        assert(v1 >= 0 && static_cast<size_t>(v1) < _vertexEdges.size());
+        assert(v2 >= 0 && static_cast<size_t>(v2) < _vertexEdges.size());
 
 		for(auto* e = _vertexEdges[v1].first; e; e = e->nextLeavingEdge){
             if(e->vertex2 == v2) return e;
@@ -112,7 +112,7 @@ private:
     ClusterGraph& _clusterGraph;
 
     MemoryPool<TessellationEdge> _edgePool{ 16'384 };
-    int _edgeCount = 0;
+    size_t _edgeCount = 0;
     std::vector<std::pair<TessellationEdge*, TessellationEdge*>> _vertexEdges;
     std::vector<Cluster*> _vertexClusters;
 };
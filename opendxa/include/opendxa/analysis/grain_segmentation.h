@@ -8,6 +8,7 @@
 #include <opendxa/analysis/polyhedral_template_matching.h>
 #include <opendxa/analysis/nearest_neighbor_finder.h>
 #include <opendxa/analysis/ptm_neighbor_finder.h>
+#include <opendxa/analysis/neighbor_list_cache.h>
 
 #include <ptm_functions.h>
 #include <boost/sort/sort.hpp>
@@ -506,7 +507,8 @@ public:
         std::shared_ptr<ParticleProperty> correspondences,
         const SimulationCell* simCell,
         bool handleCoherentInterfaces,
-        bool outputBonds
+        bool outputBonds,
+        std::shared_ptr<NeighborListCache> neighborCache = nullptr
     )
     : _handleBoundaries(handleCoherentInterfaces)
     , _numParticles(positions ? positions->size() : 0)
@@ -516,6 +518,7 @@ public:
     , _correspondencesProperty(std::move(correspondences))
     , _simCell(*simCell)
     , _outputBonds(outputBonds)
+    , _neighborCache(std::move(neighborCache))
     {
         _adjustedStructureTypes.resize(_numParticles, StructureType::OTHER);
         _adjustedOrientations.resize(_numParticles);
@@ -650,6 +653,12 @@ private:
     } 
 
 private:
+    // The PTM tree from structure identification, so the neighbor bonds do
+    // not need a kd-tree of their own.
+    std::shared_ptr<const NearestNeighborFinder> sharedNeighborFinder() const{
+        return _neighborCache ? _neighborCache->nearestNeighbors(PTM::MAX_INPUT_NEIGHBORS) : nullptr;
+    }
+
     void createNeighborBonds(){
         PTMNeighborFinder neighFinder(
             false, 
@@ -657,12 +666,13 @@ private:
             _structuresProperty, 
             _orientationsProperty, 
             _correspondencesProperty, 
-            _simCell
+            _simCell,
+            sharedNeighborFinder()
         );
 
         using BaseQuery = NearestNeighborFinder::Query<PTM::MAX_INPUT_NEIGHBORS>;
         tbb::enumerable_thread_specific<BaseQuery> baseQueries([&]{
-            return BaseQuery(neighFinder);
+            return BaseQuery(neighFinder.neighborFinder(), neighFinder.maxNeighbors());
         });
 
         tbb::enumerable_thread_specific<std::vector<NeighborBond>> tlsBonds;
@@ -726,11 +736,12 @@ private:
             _structuresProperty, 
             _orientationsProperty, 
             _correspondencesProperty, 
-            _simCell
+            _simCell,
+            sharedNeighborFinder()
         );
 
         using BaseQuery = NearestNeighborFinder::Query<PTM::MAX_INPUT_NEIGHBORS>;
-        BaseQuery base(neighFinder);
+        BaseQuery base(neighFinder.neighborFinder(), neighFinder.maxNeighbors());
 
         struct PQCmp{
             bool operator()(const NeighborBond& a, const NeighborBond& b) const{
@@ -998,6 +1009,9 @@ private:
     const SimulationCell _simCell;
     bool _outputBonds;
 
+    // Trees built during structure identification, if the caller shares them
+    std::shared_ptr<NeighborListCache> _neighborCache;
+
     std::vector<NeighborBond> _neighborBonds;
     std::vector<StructureType> _adjustedStructureTypes;
     std::vector<Quaternion> _adjustedOrientations;
@@ -2,58 +2,88 @@
 #include <opendxa/core/opendxa.h>
 #include <opendxa/utilities/bounded_priority_queue.h>
 #include <opendxa/core/simulation_cell.h>
-#include <opendxa/utilities/memory_pool.h>
+#include <vector>
 
 #define TREE_DEPTH_LIMIT 17
 
 namespace OpenDXA{
 class NearestNeighborFinder{
 protected:
-	struct NeighborListAtom{
-		NeighborListAtom* nextInBin;
-		Point3 pos;
-	};
-
-	struct TreeNode {
-		TreeNode() : splitDim(-1), atoms(nullptr), numAtoms(0){}
-
-		bool isLeaf() const;
-		void convertToAbsoluteCoordinates(const SimulationCell& cell);
-
-		int splitDim;
-		union{
-			struct{
-				TreeNode* children[2];
-				double splitPos;
-			};
-
-			struct{
-				NeighborListAtom* atoms;
-				int numAtoms;
-			};
-		};
+	// Tree nodes live in one flat array in breadth-first order; the two
+	// children of an inner node are adjacent at firstChild. A leaf owns the
+	// slice [begin, end) of the leaf arrays, where its atoms are stored
+	// contiguously as separate x/y/z/index columns. Ghost atoms come last in
+	// their leaf, from ghostBegin on. In single precision the columns are float
+	// offsets from the lower corner of the leaf box, which keeps the rounding
+	// error at the scale of the leaf rather than of the cell.
+	struct TreeNode{
+		bool isLeaf() const{ return splitDim < 0; }
 
 		Box3 bounds;
+		double splitPos = 0;
+		int splitDim = -1;
+		int firstChild = -1;
+		size_t begin = 0;
+		size_t ghostBegin = 0;
+		size_t end = 0;
 	};
 
 public:
+	// How queries account for periodic boundaries. With Images a query descends
+	// the tree once for every periodic image of the cell that may still hold a
+	// closer neighbor. With Ghosts the tree additionally stores copies of the
+	// atoms within a padding distance of each periodic face, so one descent from
+	// the wrapped query point suffices. Auto picks Ghosts when a periodic
+	// dimension of the cell is thin compared to the expected neighbor distance,
+	// where every atom is close enough to a face to need several descents.
+	enum class PeriodicMode{
+		Auto,
+		Images,
+		Ghosts
+	};
+
 	NearestNeighborFinder(int _numNeighbors = 16) : numNeighbors(_numNeighbors), numLeafNodes(0), maxTreeDepth(1){
 		bucketSize = std::max(_numNeighbors / 2, 8);
 	}
 
+	// Takes effect with the next prepare().
+	void setPeriodicMode(PeriodicMode mode){
+		periodicMode = mode;
+	}
+
+	// Takes effect with the next prepare().
+	void setPrecision(SearchPrecision precision){
+		this->precision = precision;
+	}
+
+	SearchPrecision searchPrecision() const{
+		return precision;
+	}
+
+	bool usesGhostAtoms() const{
+		return ghostPadding > 0;
+	}
+
 	size_t particleCount() const{
-		return atoms.size();
+		return numInputPositions;
 	}
 
+	// Number of neighbors a Query returns by default
+	int maxNeighbors() const{
+		return numNeighbors;
+	}
+
+	// The finder keeps a pointer to the positions of posProperty, which must
+	// stay alive and unchanged while the finder is in use.
 	bool prepare(ParticleProperty* posProperty, const SimulationCell& cellData, ParticleProperty* selectionProperty = nullptr);
 
-	const Point3& particlePos(size_t index) const;
+	// Position of the particle wrapped into the cell, as the tree holds it.
+	Point3 particlePos(size_t index) const;
 
 	struct Neighbor{
 		Vector3 delta;
 		double distanceSq;
-		NeighborListAtom* atom;
-		size_t index;
+		AtomIndex index;
 
 		bool operator<(const Neighbor& other) const{
 			return distanceSq < other.distanceSq;
@@ -64,6 +94,10 @@ public:
 	class Query{
 	public:
 		Query(const NearestNeighborFinder& finder) : t(finder), queue(finder.numNeighbors) {}
+
+		// Finds numNeighbors neighbors instead of the finder's default, e.g. when
+		// querying a shared tree that was built for a larger neighbor count.
+		Query(const NearestNeighborFinder& finder, int numNeighbors) : t(finder), queue(numNeighbors) {}
 		void findNeighbors(size_t particleIndex, bool includeSelf);
 		void findNeighbors(const Point3& query_point, bool includeSelf);
 		void findNeighbors(size_t particleIndex);
@@ -72,33 +106,56 @@ public:
 		const BoundedPriorityQueue<Neighbor, std::less<Neighbor>, MAX_NEIGHBORS_LIMIT>& results() const { return queue; }
 
 	private:
-		void visitNode(TreeNode* node);
-		void visitNode(TreeNode* node, bool includeSelf);
+		void visitNode(const TreeNode& node, bool includeSelf);
+
+		template<typename Coordinate>
+		void scanLeaf(const Coordinate* x, const Coordinate* y, const Coordinate* z, size_t begin, size_t end, const Point3& origin, bool includeSelf);
 
 	private:
 		const NearestNeighborFinder& t;
 		Point3 q, qr;
+		bool visitGhosts = false;
 		BoundedPriorityQueue<Neighbor, std::less<Neighbor>, MAX_NEIGHBORS_LIMIT> queue;
 	};
 
 protected:
-	void insertParticle(NeighborListAtom* atom, const Point3& p, TreeNode* node, int depth);
-	void splitLeafNode(TreeNode* node, int splitDim);
-
-    int determineSplitDirection(TreeNode* node);
-
-	double minimumDistance(TreeNode* node, const Point3& query_point) const;
-
-	std::vector<NeighborListAtom> atoms;
+	void buildTree(const Point3* points, size_t count, const int* selection);
+	void splitNode(size_t nodeIndex, const std::vector<Point3>& reduced, std::vector<size_t>& entries, std::vector<size_t>& scratch);
+	int determineSplitDirection(const TreeNode& node) const;
+
+	double minimumDistance(const TreeNode& node, const Point3& query_point) const;
+	double chooseGhostPadding(size_t selectedCount) const;
+	Point3 wrapPosition(const Point3& pos, Point3& reduced) const;
+
+	// The positions passed to buildTree(). They are not copied, so they must
+	// outlive the finder; particlePos() wraps them on demand.
+	const Point3* inputPositions = nullptr;
+	size_t numInputPositions = 0;
+
+	// Leaf atoms in tree order, so each leaf is one contiguous slice.
+	std::vector<double> leafX;
+	std::vector<double> leafY;
+	std::vector<double> leafZ;
+	std::vector<AtomIndex> leafIndex;
+	// Single precision replacement of leafX/leafY/leafZ
+	std::vector<float> leafXf;
+	std::vector<float> leafYf;
+	std::vector<float> leafZf;
+
+	std::vector<TreeNode> nodes;
 	SimulationCell simCell;
 	Vector3 planeNormals[3];
-	MemoryPool<TreeNode> nodePool;
-	TreeNode* root;
 	int numNeighbors;
 	int bucketSize;
 	std::vector<Vector3> pbcImages;
 	int numLeafNodes;
 	int maxTreeDepth;
+
+	PeriodicMode periodicMode = PeriodicMode::Auto;
+	SearchPrecision precision = SearchPrecision::Double;
+	// Width of the ghost layer around the periodic faces; zero when the tree
+	// holds no ghost atoms.
+	double ghostPadding = 0;
 };
 
 }
\ No newline at end of file
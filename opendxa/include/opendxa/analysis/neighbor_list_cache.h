@@ -0,0 +1,67 @@
+#pragma once
+
+#include <opendxa/analysis/nearest_neighbor_finder.h>
+#include <opendxa/core/particle_property.h>
+#include <opendxa/core/simulation_cell.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace OpenDXA{
+
+// Nearest-neighbor trees over the positions of an AnalysisContext, shared by
+// the analyses that run on it. CNA, PTM and the PTM-based grain segmentation
+// all search the k nearest neighbors of every atom; instead of each building
+// its own kd-tree they ask the cache, which hands out an existing tree if one
+// was built over the same selection for at least as many neighbors.
+//
+// A finder obtained here may have been built for more neighbors than were
+// requested, so callers must pass their own count to the
+// NearestNeighborFinder::Query constructor.
+//
+// The cache belongs to one AnalysisContext, whose positions do not change
+// while it lives; each frame gets a new context and cache. The trees read
+// those positions in place, so they must not outlive the context. Selections are
+// matched by their contents, not by address, so a property that reuses the
+// storage of a freed one is not mistaken for it. A hash of the contents
+// filters the entries and a byte comparison confirms the match.
+class NeighborListCache{
+public:
+    NeighborListCache(ParticleProperty* positions, const SimulationCell& cell)
+        : _positions(positions), _simCell(cell){}
+
+    // Returns a prepared finder for numNeighbors neighbors of the selected
+    // particles (all particles if selection is null), building it on a miss.
+    std::shared_ptr<const NearestNeighborFinder> nearestNeighbors(int numNeighbors, ParticleProperty* selection = nullptr);
+
+    // Coordinate type of the trees built from now on. Trees built with the
+    // other precision are dropped.
+    void setPrecision(SearchPrecision precision);
+
+    SearchPrecision precision() const{
+        return _precision;
+    }
+
+    // Number of trees built since construction
+    size_t buildCount() const{
+        return _buildCount;
+    }
+
+private:
+    struct Entry{
+        int numNeighbors;
+        bool hasSelection;
+        size_t selectionHash;
+        std::vector<char> selectionBytes;
+        std::shared_ptr<const NearestNeighborFinder> finder;
+    };
+
+    ParticleProperty* _positions;
+    SimulationCell _simCell;
+    SearchPrecision _precision = SearchPrecision::Double;
+    size_t _buildCount = 0;
+    std::vector<Entry> _entries;
+    std::mutex _mutex;
+};
+
+}
@@ -8,6 +8,7 @@
 #include <ptm_functions.h>
 
 #include <vector>
+#include <memory>
 #include <array>
 #include <algorithm>
 #include <cstdint>
@@ -124,12 +125,48 @@ public:
         return _calculateDefGradient;
     }
 
-    bool prepare(const Point3* positions, size_t particle_count, const SimulationCell& cell);
+    // Builds the neighbor search tree, unless sharedFinder supplies one that was
+    // prepared over the same positions for at least MAX_INPUT_NEIGHBORS. The
+    // tree reads the positions in place, so they must outlive this object.
+    bool prepare(const Point3* positions, size_t particle_count, const SimulationCell& cell, std::shared_ptr<const NearestNeighborFinder> sharedFinder = nullptr);
+
+    // The tree the kernels search
+    const NearestNeighborFinder& neighborFinder() const{
+        return _sharedFinder ? *_sharedFinder : *this;
+    }
 
     size_t particleCount() const{
         return _particleCount;
     }
 
+    // Atoms per tile of the batched identification
+    static constexpr size_t TileSize = 64;
+
+    // A run of up to TileSize consecutive atoms. Kernel::identifyTile() gathers
+    // the neighbor shell of every atom once into the contiguous input buffers
+    // and writes the results column by column, so that each column can be
+    // copied into its per-atom property as one block.
+    struct Tile{
+        size_t begin = 0;
+        size_t count = 0;
+
+        // Neighbor shells in distance order
+        int numNeighbors[TileSize];
+        size_t neighborIndices[TileSize][MAX_INPUT_NEIGHBORS];
+        double neighborPoints[TileSize][MAX_INPUT_NEIGHBORS][3];
+
+        // Raw RMSD and correspondences of every atom
+        double rmsd[TileSize];
+        uint64_t correspondences[TileSize];
+
+        // Only set for accepted atoms; OTHER, zero and -1 otherwise
+        int structureTypes[TileSize];
+        int templateIndices[TileSize];
+        double orientations[TileSize][4];
+        double deformationGradients[TileSize][9];
+        AtomIndex templateNeighbors[TileSize][MAX_OUTPUT_NEIGHBORS];
+    };
+
     class Kernel : private NearestNeighborFinder::Query<MAX_INPUT_NEIGHBORS>{
     private:
         using NeighborQuery = NearestNeighborFinder::Query<MAX_INPUT_NEIGHBORS>;
@@ -141,6 +178,15 @@ public:
         StructureType identifyStructure(size_t particleIndex, const std::vector<uint64_t>& cachedNeighbors, Quaternion* qtarget = nullptr);
         int cacheNeighbors(size_t particleIndex, uint64_t* res);
 
+        // Identifies the atoms [begin, end), at most TileSize of them. Their
+        // shells are searched once, and the shells PTM asks for again (the
+        // central atom and, for the diamond templates, its first neighbors)
+        // are read from the tile when they lie inside it. Atoms whose RMSD
+        // exceeds rmsdLimit are stored as OTHER but keep their RMSD and
+        // correspondences. cachedNeighbors must hold cacheNeighbors() of
+        // every atom.
+        void identifyTile(Tile& tile, size_t begin, size_t end, const std::vector<uint64_t>& cachedNeighbors, double rmsdLimit);
+
         StructureType structureType() const{
             return _structureType;
         }
@@ -174,6 +220,9 @@ public:
         const NearestNeighborFinder::Neighbor& getTemplateNeighbor(int index) const;
 
     private:
+        // Takes over the result of ptm_index() and applies the RMSD cutoff
+        StructureType storeResult(const ptm_result_t& result);
+
         const PTM& _algorithm;
         ptm_local_handle_t _handle;
         double _rmsd;
@@ -193,6 +242,7 @@ private:
     friend class Kernel;
     size_t _particleCount = 0;
     const int* _particleTypes = nullptr;
+    std::shared_ptr<const NearestNeighborFinder> _sharedFinder;
 
     std::array<bool, static_cast<size_t>(StructureType::NUM_STRUCTURE_TYPES)> _typesToIdentify = {};
     bool _identifyOrdering = false;
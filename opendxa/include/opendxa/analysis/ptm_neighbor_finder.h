@@ -23,13 +23,22 @@ public:
         std::shared_ptr<ParticleProperty> structures,
         std::shared_ptr<ParticleProperty> orientations,
         std::shared_ptr<ParticleProperty> correspondences,
-        const SimulationCell& cell
+        const SimulationCell& cell,
+        std::shared_ptr<const NearestNeighborFinder> sharedFinder = nullptr
     )
-    : _structuresArray(std::move(structures))
+    : _positionsArray(std::move(positions))
+    , _structuresArray(std::move(structures))
     , _orientationsArray(std::move(orientations))
     , _correspondencesArray(std::move(correspondences))
+    , _sharedFinder(std::move(sharedFinder))
     {
-        this->prepare(positions.get(), cell, nullptr);
+        if(!_sharedFinder) this->prepare(_positionsArray.get(), cell, nullptr);
+    }
+
+    // The tree the queries search: either the one built by the constructor or
+    // a shared one prepared over the same positions.
+    const NearestNeighborFinder& neighborFinder() const{
+        return _sharedFinder ? *_sharedFinder : *this;
     }
 
     // Performs a PTM calculation on a single input particle.
@@ -88,9 +97,14 @@ public:
         boost::container::small_vector<Neighbor, PTM::MAX_INPUT_NEIGHBORS> _list;
     };
 
+    // Held because the tree reads the positions from it instead of a copy.
+    std::shared_ptr<ParticleProperty> _positionsArray;
     std::shared_ptr<ParticleProperty> _structuresArray;
     std::shared_ptr<ParticleProperty> _orientationsArray;
     std::shared_ptr<ParticleProperty> _correspondencesArray;
+
+private:
+    std::shared_ptr<const NearestNeighborFinder> _sharedFinder;
 };
 
 }
\ No newline at end of file
@@ -37,6 +37,11 @@ public:
 
 	void identifyStructures();
 
+	// Neighbor lists of the structure identification stage hold AtomIndex
+	// entries. Fills result with the error and returns false for frames
+	// with more atoms than that type can address.
+	static bool checkAtomCount(std::int64_t natoms, json& result);
+
 	void computeMaximumNeighborDistance();
 
 	json getAtomsData(
@@ -48,9 +53,9 @@ public:
 	void computeMaximumNeighborDistanceFromPTM();
 	void determineLocalStructuresWithPTM();
 
-	int numberOfNeighbors(int atomIndex) const {
+	int numberOfNeighbors(AtomIndex atomIndex) const {
 		assert(_context.neighborLists);
-		const int* neighborList = _context.neighborLists->constDataInt() + (size_t)atomIndex * _context.neighborLists->componentCount();
+		const AtomIndex* neighborList = _context.neighborLists->constDataAtomIndex() + (size_t)atomIndex * _context.neighborLists->componentCount();
 		size_t count = 0;
 		while(count < _context.neighborLists->componentCount() && neighborList[count] != -1){
 			count++;
@@ -58,14 +63,14 @@ public:
 		return count;
 	}
 	
-	int getNeighbor(int centralAtomIndex, int neighborListIndex) const{
+	AtomIndex getNeighbor(AtomIndex centralAtomIndex, int neighborListIndex) const{
 		assert(_context.neighborLists);
-		return _context.neighborLists->getIntComponent(centralAtomIndex, neighborListIndex);
+		return _context.neighborLists->getAtomIndexComponent(centralAtomIndex, neighborListIndex);
 	}
 
-	int findNeighbor(int centralAtomIndex, int neighborAtomIndex) const{
+	int findNeighbor(AtomIndex centralAtomIndex, AtomIndex neighborAtomIndex) const{
 		assert(_context.neighborLists);
-		const int* neighborList = _context.neighborLists->constDataInt() + (size_t)centralAtomIndex * _context.neighborLists->componentCount();
+		const AtomIndex* neighborList = _context.neighborLists->constDataAtomIndex() + (size_t)centralAtomIndex * _context.neighborLists->componentCount();
 		for(size_t index = 0; index < _context.neighborLists->componentCount() && neighborList[index] != -1; index++){
 			if(neighborList[index] == neighborAtomIndex){
 				return index;
@@ -94,7 +99,7 @@ public:
 		return *_clusterGraph;
 	}
 
-	Cluster* atomCluster(int atomIndex) const{
+	Cluster* atomCluster(AtomIndex atomIndex) const{
 		return clusterGraph().findCluster(_context.atomClusters->getInt(atomIndex));
 	}
 	
@@ -118,7 +123,7 @@ public:
 	int findClosestSymmetryPermutation(int structureType, const Matrix3& rotation);
 
 	// Returns the ideal lattice vector associated with a neighbor bond
-	const Vector3& neighborLatticeVector(int centralAtomIndex, int neighborIndex) const{
+	const Vector3& neighborLatticeVector(AtomIndex centralAtomIndex, int neighborIndex) const{
 		assert(_context.atomSymmetryPermutations);
 		int structureType = _context.structureTypes->getInt(centralAtomIndex);
 		const LatticeStructure& latticeStructure = CoordinationStructures::getLatticeStruct(structureType);
@@ -141,19 +146,19 @@ public:
         _statisticsValid = true;
     }
     
-    const std::map<int, int>& getStructureStatistics() const {
+    const std::map<int, size_t>& getStructureStatistics() const {
         if (!_statisticsValid) {
             calculateStructureStatistics();
         }
         return _structureStatistics;
     }
     
-    std::map<std::string, int> getNamedStructureStatistics() const {
+    std::map<std::string, size_t> getNamedStructureStatistics() const {
         if (!_statisticsValid) {
             calculateStructureStatistics();
         }
         
-        std::map<std::string, int> namedStats;
+        std::map<std::string, size_t> namedStats;
         
         for (const auto& [structureType, count] : _structureStatistics) {
             std::string name = getStructureTypeName(structureType);
@@ -205,13 +210,13 @@ public:
     json getStructureStatisticsJson() const{
 		if(!_statisticsValid) calculateStructureStatistics();
 
-		const int N = _context.atomCount();
+		const size_t N = _context.atomCount();
 		const double invN = (N > 0) ? (100.0 / static_cast<double>(N)) : 0.0;
 		json stats = json::object();
 		stats["total_atoms"] = N;
 
 		json typeStats = json::object();
-		int totalIdentified = 0;
+		size_t totalIdentified = 0;
 
 		constexpr int K = static_cast<int>(StructureType::NUM_STRUCTURE_TYPES);
 		std::vector<std::string> nameCache(K);
@@ -241,7 +246,7 @@ public:
 			}
 		}
 
-		int unidentified = 0;
+		size_t unidentified = 0;
 		auto itOther = _structureStatistics.find(static_cast<int>(StructureType::OTHER));
 		if(itOther != _structureStatistics.end()){
 			unidentified = itOther->second;
@@ -259,9 +264,10 @@ public:
 	}
 
 private:
-	void storeDeformationGradient(const PTM::Kernel& kernel, size_t atomIndex);
-	void storeOrientationData(const PTM::Kernel& kernel, size_t atomIndex);
-	void storeNeighborIndices(const PTM::Kernel& kernel, size_t atomIndex);
+	template<LatticeStructureType Lattice>
+	void identifyStructuresCNA(const NearestNeighborFinder& neighFinder, int maxNeighborListSize);
+
+	void storePTMTile(const PTM::Tile& tile);
 
 	void processPTMAtom(
 		PTM::Kernel& kernel,
@@ -273,7 +279,7 @@ private:
 
 	bool setupPTM(OpenDXA::PTM& ptm, size_t N);
 
-	mutable std::map<int, int> _structureStatistics;
+	mutable std::map<int, size_t> _structureStatistics;
     mutable bool _statisticsValid = false;
 
 	Mode _identificationMode;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <opendxa/core/opendxa.h>
+#include <opendxa/core/simulation_cell.h>
+#include <opendxa/core/particle_property.h>
+#include <vector>
+
+namespace OpenDXA{
+
+// Neighbor list that persists across the frames of a trajectory. It stores,
+// for every particle, the neighbors within cutoff + skin in compressed sparse
+// row form. As long as no particle has moved more than half the skin since
+// the last build, every pair within the cutoff is still on the list, so a new
+// frame only costs a displacement check and the queries filter the stored
+// candidates by their current distance.
+//
+// The list is rebuilt from a CutoffNeighborFinder when a particle exceeds
+// that bound, and whenever the cutoff, the simulation cell, the particle
+// count or (if given) the set of particle identifiers changes. A frame that
+// stores the same particles in a different order (unsorted dumps, spatial
+// sorting) only has the stored rows permuted into its order.
+class VerletNeighborList{
+public:
+    explicit VerletNeighborList(double skin = 0.3) : _skin(skin){}
+
+    double skin() const{
+        return _skin;
+    }
+
+    // Changing the skin invalidates the current list.
+    void setSkin(double skin){
+        _skin = skin;
+        _neighborStart.clear();
+    }
+
+    // Brings the list up to date with the given positions and returns true if
+    // it had to be rebuilt. The positions must stay alive and unchanged while
+    // queries run. ids, if given, identifies the particles so that a frame
+    // that stores them in a different order is matched to the stored rows.
+    bool update(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell, const std::vector<AtomId>* ids = nullptr);
+
+    double cutoffRadius() const{
+        return _cutoffRadius;
+    }
+
+    double cutoffRadiusSquared() const{
+        return _cutoffRadius * _cutoffRadius;
+    }
+
+    // Number of rebuilds since construction
+    size_t rebuildCount() const{
+        return _rebuildCount;
+    }
+
+    // Iterates over the neighbors of a particle within the cutoff radius. Has
+    // the same interface as CutoffNeighborFinder::Query.
+    class Query{
+    public:
+        Query(const VerletNeighborList& list, size_t particleIndex);
+
+        bool atEnd() const{
+            return _atEnd;
+        }
+
+        void next();
+
+        size_t current(){
+            return _neighborIndex;
+        }
+
+        const Vector3& delta() const{
+            return _delta;
+        }
+
+        double distanceSquared() const{
+            return _distSq;
+        }
+
+        // PBC shift vector between the central particle and the current neighbor
+        // relative to the positions passed to update().
+        const Vector_3<int8_t>& unwrappedPbcShift() const{
+            return _pbcShift;
+        }
+
+    private:
+        const VerletNeighborList& _list;
+        size_t _centerIndex;
+        size_t _entry;
+        size_t _entryEnd;
+        bool _atEnd;
+        size_t _neighborIndex;
+        Vector_3<int8_t> _pbcShift;
+        Vector3 _delta;
+        double _distSq;
+    };
+
+private:
+    bool isValid(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell, const std::vector<AtomId>* ids);
+    void rebuild(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell, const std::vector<AtomId>* ids);
+    bool reorder(const std::vector<AtomId>& ids);
+
+    double _skin;
+    double _cutoffRadius = 0;
+    size_t _rebuildCount = 0;
+    SimulationCell _simCell;
+
+    // Positions passed to the last update()
+    const Point3* _positions = nullptr;
+
+    // Positions at the last rebuild, and the periodic image each particle has
+    // been wrapped into since then.
+    std::vector<Point3> _referencePositions;
+    std::vector<Vector_3<int8_t>> _imageShifts;
+    std::vector<AtomId> _ids;
+
+    // Candidate neighbors of particle i occupy [_neighborStart[i], _neighborStart[i+1])
+    std::vector<size_t> _neighborStart;
+    std::vector<size_t> _neighborIndices;
+    std::vector<Vector_3<int8_t>> _neighborShifts;
+};
+
+}
@@ -19,6 +19,7 @@ public:
         bool computeCenterOfMass,
         bool computeRadiusOfGyration
     );
+    void setSearchPrecision(SearchPrecision precision);
 
     json compute(const LammpsParser::Frame& frame, const std::string &outputFilename);
 
@@ -29,6 +30,7 @@ private:
     bool _unwrapParticleCoordinates;
     bool _computeCentersOfMass;
     bool _computeRadiusOfGyration;
+    SearchPrecision _searchPrecision;
 
     DXAJsonExporter _jsonExporter;
 };
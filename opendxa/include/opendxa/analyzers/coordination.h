@@ -5,6 +5,7 @@
 #include <opendxa/utilities/json_exporter.h>
 #include <opendxa/core/particle_property.h>
 #include <opendxa/analysis/coordination_analysis.h>
+#include <memory>
 #include <string>
 
 namespace OpenDXA{
@@ -16,6 +17,14 @@ public:
     void setCutoff(double cutoff);
     void setRdfBins(int bins);
 
+    // Keeps a Verlet neighbor list with this skin across compute() calls, so
+    // consecutive frames of a trajectory reuse it until an atom has moved
+    // more than half the skin. Zero (the default) builds a fresh cell list
+    // for every frame.
+    void setNeighborSkin(double skin);
+
+    void setSearchPrecision(SearchPrecision precision);
+
     json compute(
         const LammpsParser::Frame &frame,
         const std::string &outputFilename = ""
@@ -24,6 +33,8 @@ public:
 private:
     double _cutoff;
     int _rdfBins;
+    SearchPrecision _searchPrecision;
+    std::unique_ptr<VerletNeighborList> _neighborList;
 
     mutable DXAJsonExporter _jsonExporter;
 
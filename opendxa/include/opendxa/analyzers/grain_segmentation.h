@@ -18,6 +18,7 @@ public:
     
     void setIdentificationMode(StructureAnalysis::Mode mode);
     void setRMSD(float rmsd);
+    void setSearchPrecision(SearchPrecision precision);
 
     void setParameters(
         bool adoptOrphanAtoms,
@@ -33,6 +34,7 @@ public:
 
 private:
     float _rmsd;
+    SearchPrecision _searchPrecision;
     StructureAnalysis::Mode _identificationMode;
 
     bool _adoptOrphanAtoms;
@@ -3,6 +3,11 @@
 #include <opendxa/core/dislocation_analysis.h>
 #include <opendxa/analysis/structure_analysis.h>
 #include <opendxa/core/lammps_parser.h>
+#include <opendxa/core/lammps_binary_parser.h>
+#include <opendxa/core/snapshot.h>
+#include <opendxa/core/frame_pipeline.h>
+#include <opendxa/core/frame_cache.h>
+#include <opendxa/core/spatial_sort.h>
 
 #include <iostream>
 #include <string>
@@ -12,6 +17,7 @@
 #include <memory>
 #include <algorithm>
 #include <optional>
+#include <sstream>
 #include <cstdlib>
 #include <cctype>
 
@@ -49,7 +55,8 @@ inline std::map<std::string, std::string> parseArgs(
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg.rfind("--", 0) == 0) {
-            if (i + 1 < argc && argv[i + 1][0] != '-') {
+            // Negative numbers such as --region -5,... are values, not flags.
+            if (i + 1 < argc && (argv[i + 1][0] != '-' || std::isdigit(static_cast<unsigned char>(argv[i + 1][1])))) {
                 options[arg] = argv[++i];
             } else {
                 options[arg] = "true";
@@ -72,17 +79,86 @@ inline std::string deriveOutputBase(const std::string& filename, const std::stri
     return (inputPath.parent_path() / inputPath.stem()).string();
 }
 
+// Reorders the atoms of a loaded frame along a space-filling curve when
+// OPENDXA_SPATIAL_SORT is set.
+inline void sortFrameIfRequested(LammpsParser::Frame& frame) {
+    if (SpatialSort::enabledFromEnvironment()) SpatialSort::reorder(frame);
+}
+
+// Dumps are looked up in the frame cache first when OPENDXA_FRAME_CACHE
+// names a cache directory, and parsed frames are added to it. The cache
+// always holds frames in dump order; spatial sorting happens after it.
 inline bool parseFrame(const std::string& filename, LammpsParser::Frame& frame) {
     spdlog::info("Parsing LAMMPS file: {}", filename);
-    LammpsParser parser;
-    if (!parser.parseFile(filename, frame)) {
+    if (Snapshot::isSnapshot(filename)) {
+        if (!Snapshot::read(filename, frame)) {
+            spdlog::error("Failed to parse LAMMPS file: {}", filename);
+            return false;
+        }
+        spdlog::info("Successfully loaded {} atoms from the file.", frame.natoms);
+        sortFrameIfRequested(frame);
+        return true;
+    }
+
+    auto cache = FrameCache::fromEnvironment();
+    if (cache && cache->load(filename, frame)) {
+        spdlog::info("Successfully loaded {} atoms from the file.", frame.natoms);
+        sortFrameIfRequested(frame);
+        return true;
+    }
+
+    bool parsed = false;
+    if (LammpsBinaryParser::isBinaryDump(filename)) {
+        LammpsBinaryParser parser;
+        parsed = parser.parseFile(filename, frame);
+    } else {
+        LammpsParser parser;
+        parsed = parser.parseFile(filename, frame);
+    }
+    if (!parsed) {
         spdlog::error("Failed to parse LAMMPS file: {}", filename);
         return false;
     }
+    if (cache) cache->store(filename, frame);
     spdlog::info("Successfully loaded {} atoms from the file.", frame.natoms);
+    sortFrameIfRequested(frame);
     return true;
 }
 
+// Call fn(frame) for every frame of a multi-frame text or binary dump,
+// stopping early when it returns false. Frames are parsed on a reader
+// thread up to depth - 1 frames ahead of fn.
+template <typename Fn>
+inline bool forEachFrame(
+    const std::string& filename,
+    const std::vector<LammpsParser::ColumnRequest>& columns,
+    const LammpsParser::AtomFilter& filter,
+    size_t depth,
+    Fn&& fn
+) {
+    auto run = [&](auto& reader) {
+        reader.setRequestedColumns(columns);
+        reader.setAtomFilter(filter);
+        FramePipeline pipeline(reader, depth);
+        size_t frames = 0;
+        while (LammpsParser::Frame* frame = pipeline.next()) {
+            sortFrameIfRequested(*frame);
+            if (!fn(*frame)) return false;
+            ++frames;
+        }
+        if (pipeline.failed()) return false;
+        spdlog::info("Processed {} frames of {}", frames, filename);
+        return true;
+    };
+
+    if (LammpsBinaryParser::isBinaryDump(filename)) {
+        LammpsBinaryParser::TrajectoryReader reader(filename);
+        return run(reader);
+    }
+    LammpsParser::TrajectoryReader reader(filename);
+    return run(reader);
+}
+
 inline bool getBool(const std::map<std::string, std::string>& opts, const std::string& key, bool defaultVal = false) {
     auto it = opts.find(key);
     if (it == opts.end()) return defaultVal;
@@ -140,6 +216,41 @@ inline int getEnvInt(const char* name) {
     catch (...) { return 0; }
 }
 
+// Atom filter from --region <xlo,ylo,zlo,xhi,yhi,zhi>, --regionPadding
+// <float> and --types <a,b,...>. Malformed values leave that part unset.
+inline LammpsParser::AtomFilter parseAtomFilter(const std::map<std::string, std::string>& opts) {
+    LammpsParser::AtomFilter filter;
+    auto splitList = [](const std::string& list) {
+        std::vector<std::string> items;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    };
+
+    try {
+        auto bounds = splitList(getString(opts, "--region"));
+        if (bounds.size() == 6) {
+            filter.region = Box3(
+                Point3(std::stod(bounds[0]), std::stod(bounds[1]), std::stod(bounds[2])),
+                Point3(std::stod(bounds[3]), std::stod(bounds[4]), std::stod(bounds[5])));
+        } else if (!bounds.empty()) {
+            spdlog::warn("--region expects xlo,ylo,zlo,xhi,yhi,zhi; ignoring it");
+        }
+        for (const auto& type : splitList(getString(opts, "--types"))) {
+            filter.types.push_back(std::stoi(type));
+        }
+    } catch (...) {
+        spdlog::warn("Ignoring malformed --region or --types");
+        filter.region = Box3();
+        filter.types.clear();
+    }
+    filter.padding = getDouble(opts, "--regionPadding", 0.0);
+    return filter;
+}
+
 struct ParallelConfig {
     int threads = 1;
     bool deterministic = true;
@@ -201,6 +312,11 @@ inline StructureAnalysis::Mode parseIdentificationMode(const std::string& val) {
     return StructureAnalysis::Mode::CNA;
 }
 
+inline SearchPrecision parseSearchPrecision(const std::string& val) {
+    if (val == "single") return SearchPrecision::Single;
+    return SearchPrecision::Double;
+}
+
 inline void printUsageHeader(const std::string& name, const std::string& description) {
     std::cerr << "\n" << description << "\n\n"
               << "Usage: " << name << " <lammps_file> [output_base] [options]\n\n"
@@ -10,6 +10,24 @@
 #include <opendxa/analysis/analysis_context.h>
 
 namespace OpenDXA{
+
+// Nearest neighbors of every particle, gathered in one parallel pass for the
+// diamond lattices, whose CNA shells consist of the first neighbors of the
+// first neighbors. No row holds more than RowSize entries, so the rows are
+// stored at a fixed stride rather than behind an offset array: row i starts
+// at i * RowSize and has rowSize(i) entries.
+struct DiamondNeighborTable{
+    static constexpr int RowSize = 4;
+
+    // Number of neighbors the CNA query of each particle found
+    std::vector<unsigned char> neighborCounts;
+    std::vector<AtomIndex> indices;
+    std::vector<Vector3> deltas;
+
+    int rowSize(size_t particleIndex) const{
+        return std::min<int>(neighborCounts[particleIndex], RowSize);
+    }
+};
     
 class CoordinationStructures{
 public:
@@ -17,17 +35,67 @@ public:
 
     double determineLocalStructure(
         const NearestNeighborFinder& neighList, 
-        int particleIndex,
+        int maxNeighbors,
+        AtomIndex particleIndex,
         std::shared_ptr<ParticleProperty> neighborLists
     ) const;
-    
-    static void initializeStructures();
 
-    void postProcessDiamondNeighbors(
-        AnalysisContext& context,
-        const NearestNeighborFinder& neighList
+    // Per-atom CNA specialized for the input lattice, which must be the one
+    // this object was created with. The coordination number and shell layout
+    // are compile-time constants, so callers that switch on
+    // inputCrystalType() once avoid a dispatch per atom. Instantiated for
+    // FCC, HCP, BCC and the two diamond lattices.
+    template<LatticeStructureType Lattice>
+    double determineLocalStructure(
+        const NearestNeighborFinder& neighList,
+        int maxNeighbors,
+        AtomIndex particleIndex,
+        std::shared_ptr<ParticleProperty> neighborLists
     ) const;
 
+    // Batched variant of determineLocalStructure() for the particles in
+    // [begin, end); returns the largest local cutoff of the identified ones.
+    // Only available when supportsBatchedCNA() is true.
+    double determineLocalStructures(
+        const NearestNeighborFinder& neighList,
+        int maxNeighbors,
+        size_t begin,
+        size_t end,
+        std::shared_ptr<ParticleProperty> neighborLists
+    ) const;
+
+    // Instantiated for FCC, HCP and BCC.
+    template<LatticeStructureType Lattice>
+    double determineLocalStructures(
+        const NearestNeighborFinder& neighList,
+        int maxNeighbors,
+        size_t begin,
+        size_t end,
+        std::shared_ptr<ParticleProperty> neighborLists
+    ) const;
+
+    // FCC, HCP and BCC shells consist of the nearest neighbors alone and can
+    // be processed in blocks; diamond shells need second-neighbor queries.
+    bool supportsBatchedCNA() const;
+
+    // Runs the CNA neighbor query of every particle once and keeps the first
+    // neighbors for the diamond shells.
+    DiamondNeighborTable computeDiamondNeighborTable(const NearestNeighborFinder& neighList, int maxNeighbors) const;
+
+    // Diamond CNA for the particles in [begin, end), with the shells gathered
+    // from a computeDiamondNeighborTable() result instead of queried again.
+    // Returns the largest local cutoff of the identified particles.
+    // Instantiated for the two diamond lattices.
+    template<LatticeStructureType Lattice>
+    double determineLocalStructures(
+        const DiamondNeighborTable& firstNeighbors,
+        size_t begin,
+        size_t end,
+        std::shared_ptr<ParticleProperty> neighborLists
+    ) const;
+    
+    static void initializeStructures();
+
     static const LatticeStructureType getLatticeIdx(int s){
         switch(s){
             case StructureType::SC:  return LATTICE_SC;
@@ -94,6 +162,28 @@ public:
     static LatticeStructure _latticeStructures[NUM_LATTICE_TYPES];
     int getCoordinationNumber() const;
 
+    LatticeStructureType inputCrystalType() const{
+        return _inputCrystalType;
+    }
+
+    // Number of neighbors CNA analyzes around an atom of the given lattice
+    static constexpr int latticeCoordinationNumber(LatticeStructureType lattice){
+        switch(lattice){
+            case LATTICE_FCC:
+            case LATTICE_HCP:
+                return 12;
+            case LATTICE_BCC:
+                return 14;
+            case LATTICE_CUBIC_DIAMOND:
+            case LATTICE_HEX_DIAMOND:
+                return 16;
+            case LATTICE_SC:
+                return 6;
+            default:
+                return 0;
+        }
+    }
+
     const SimulationCell& cell() const{
         return _simCell;
     }
@@ -140,13 +230,34 @@ private:
     static void initializeHexagonalDiamond();
     static void initializeOther();
     
+    template<LatticeStructureType Lattice>
+    double computeShellCutoff(const NearestNeighborFinder::Query<MAX_NEIGHBORS>& neighQuery) const;
+
+    template<LatticeStructureType Lattice>
+    bool assignLocalStructure(
+        AtomIndex particleIndex,
+        const AtomIndex* neighborIndices,
+        const Vector3* neighborVectors,
+        const NeighborBondArray& neighborArray,
+        const std::shared_ptr<ParticleProperty>& neighborLists
+    ) const;
+
+    template<LatticeStructureType Lattice>
     double computeLocalCutoff(
         const NearestNeighborFinder& neighList, 
         const NearestNeighborFinder::Query<MAX_NEIGHBORS>& neighQuery,
         int numNeighbors,
-        int coordinationNumber,
-        int particleIndex,
-        int* neighborIndices,
+        AtomIndex particleIndex,
+        AtomIndex* neighborIndices,
+        Vector3* neighborVectors,
+        NeighborBondArray& neighborArray
+    ) const;
+
+    template<LatticeStructureType Lattice, typename FirstNeighbors>
+    double computeDiamondCutoff(
+        const FirstNeighbors& firstNeighbors,
+        AtomIndex particleIndex,
+        AtomIndex* neighborIndices,
         Vector3* neighborVectors,
         NeighborBondArray& neighborArray
     ) const;
@@ -156,6 +267,7 @@ private:
     static void initializeSymmetryInformation();
     static void findCommonNeighborsForBond(CoordinationStructure& coordStruct, int neighborIndex);
     static void initializeCommonNeighbors();
+    static void initializeNeighborClasses();
 
     static void calculateProductForPermutation(
         LatticeStructure& latticeStruct, 
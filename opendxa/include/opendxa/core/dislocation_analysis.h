@@ -34,6 +34,10 @@ public:
     
     void setIdentificationMode(StructureAnalysis::Mode identificationMode);
     void setRmsd(float rmsd);
+
+    // Coordinate type of the neighbor search during structure identification.
+    // Burgers vectors and everything after the search stay double.
+    void setSearchPrecision(SearchPrecision precision);
     
     json compute(const LammpsParser::Frame &frame, const std::string& jsonOutputFile = "");
 
@@ -47,6 +51,7 @@ private:
     double _defectMeshSmoothingLevel;
 
     float _rmsd;
+    SearchPrecision _searchPrecision;
 
     StructureAnalysis::Mode _identificationMode;
 
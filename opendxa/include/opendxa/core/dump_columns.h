@@ -0,0 +1,61 @@
+#pragma once
+
+#include <opendxa/core/lammps_parser.h>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OpenDXA{
+
+// Column handling shared by the text and binary LAMMPS dump readers.
+
+// Columns that are decoded into Frame::positions/ids/types rather than
+// into Frame::properties.
+bool isCoreDumpColumn(std::string_view name);
+
+// Integer-valued LAMMPS per-atom attributes; every other column,
+// including compute/fix/variable outputs, is read as a double.
+Particles::DataType inferDumpColumnType(std::string_view name);
+
+struct BoundColumn{
+    int column;
+    Particles::DataType dataType;
+    void* data;
+};
+
+// Resolve the requested columns against a dump's column names and give the
+// frame one property per column, sized to frame.natoms. A property left over
+// from the previous frame is reused when its type matches and nobody else
+// holds a reference to it.
+std::vector<BoundColumn> bindRequestedColumns(
+    const std::vector<std::string>& names,
+    const std::vector<LammpsParser::ColumnRequest>& requests,
+    LammpsParser::Frame& frame
+);
+
+// An AtomFilter resolved against one frame's cell: the padded region and
+// the periodic image shifts under which it overlaps the cell.
+class FrameAtomFilter{
+public:
+    FrameAtomFilter(const LammpsParser::AtomFilter& filter, const SimulationCell& cell);
+
+    bool isActive() const{ return _active; }
+
+    bool accepts(const Point3& pos, int type) const{
+        if(!_types.empty() && !std::binary_search(_types.begin(), _types.end(), type)) return false;
+        if(_shifts.empty()) return true;
+        for(const Vector3& shift : _shifts){
+            if(_region.contains(pos + shift)) return true;
+        }
+        return false;
+    }
+
+private:
+    bool _active = false;
+    Box3 _region;
+    std::vector<Vector3> _shifts;
+    std::vector<int> _types;
+};
+
+}
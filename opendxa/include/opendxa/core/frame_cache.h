@@ -0,0 +1,48 @@
+#pragma once
+
+#include <opendxa/core/lammps_parser.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace OpenDXA{
+
+// Opt-in on-disk cache of parsed frames, so analyzing the same dump again
+// skips the text parse entirely.
+//
+// Entries are .dxasnap snapshots named after a key derived from the dump's
+// identity: its size, its mtime and a hash of its first block plus blocks
+// sampled across the file. A hit is therefore a memory-mapped snapshot
+// load. Hits refresh the entry's mtime, and every store evicts the least
+// recently used entries until the directory fits the size cap.
+class FrameCache{
+public:
+    static constexpr std::uint64_t DefaultMaxBytes = std::uint64_t(16) << 30;
+
+    explicit FrameCache(std::string directory, std::uint64_t maxBytes = DefaultMaxBytes);
+
+    // Cache configured through OPENDXA_FRAME_CACHE (directory) and
+    // OPENDXA_FRAME_CACHE_MAX_MB (size cap), or null when it is not enabled.
+    static std::unique_ptr<FrameCache> fromEnvironment();
+
+    // Content key of a dump, or an empty string if it cannot be read.
+    static std::string key(const std::string &filename);
+
+    const std::string& directory() const{ return _directory; }
+
+    // Load the cached parse of the first frame of filename.
+    bool load(const std::string &filename, LammpsParser::Frame &frame) const;
+
+    // Store a freshly parsed first frame of filename. Failures only cost
+    // the cache entry and are logged as warnings.
+    void store(const std::string &filename, const LammpsParser::Frame &frame) const;
+
+private:
+    std::string entryPath(const std::string &key) const;
+    void evict(const std::string &keep) const;
+
+    std::string _directory;
+    std::uint64_t _maxBytes;
+};
+
+}
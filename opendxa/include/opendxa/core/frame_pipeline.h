@@ -0,0 +1,120 @@
+#pragma once
+
+#include <opendxa/core/lammps_parser.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpenDXA{
+
+// Runs a trajectory reader (LammpsParser::TrajectoryReader or
+// LammpsBinaryParser::TrajectoryReader) on a dedicated thread, so the next
+// frame is read and parsed while the caller analyzes the current one.
+//
+// Frames live in a fixed ring of `depth` buffers: with the default of two,
+// one frame is being analyzed while the other is being parsed; three lets
+// the reader run a further frame ahead to absorb uneven parse times. The
+// buffers are handed back to the reader, which resizes them in place, so
+// memory stays bounded by depth frames no matter how long the trajectory.
+template <typename Reader>
+class FramePipeline{
+public:
+    using Frame = LammpsParser::Frame;
+
+    explicit FramePipeline(Reader& reader, size_t depth = 2)
+        : _reader(reader), _frames(std::max<size_t>(depth, 2)){
+        for(Frame& frame : _frames) _free.push_back(&frame);
+        _reader.setPrefetch(true);
+        _producer = std::thread([this]{ run(); });
+    }
+
+    ~FramePipeline(){
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _cond.notify_all();
+        if(_producer.joinable()) _producer.join();
+    }
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Next frame in file order, or nullptr once the trajectory is exhausted
+    // or a frame failed to parse (see failed()). The frame stays valid until
+    // the following call, which returns its buffer to the reader thread.
+    Frame* next(){
+        std::unique_lock<std::mutex> lock(_mutex);
+        if(_current){
+            _free.push_back(_current);
+            _current = nullptr;
+            _cond.notify_all();
+        }
+        _cond.wait(lock, [this]{ return !_ready.empty() || _done; });
+        if(_ready.empty()) return nullptr;
+        _current = _ready.front();
+        _ready.pop_front();
+        return _current;
+    }
+
+    bool failed() const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _failed;
+    }
+
+private:
+    void run(){
+        for(;;){
+            Frame* frame = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait(lock, [this]{ return !_free.empty() || _stopping; });
+                if(_stopping) break;
+                frame = _free.front();
+                _free.pop_front();
+            }
+
+            bool parsed = false;
+            bool failed = false;
+            try{
+                parsed = _reader.next(*frame);
+                failed = !parsed && _reader.failed();
+            }catch(const std::exception& e){
+                spdlog::error("Frame pipeline: {}", e.what());
+                failed = true;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!parsed){
+                _free.push_back(frame);
+                _failed = failed;
+                break;
+            }
+            _ready.push_back(frame);
+            _cond.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done = true;
+        }
+        _cond.notify_all();
+    }
+
+    Reader& _reader;
+    std::vector<Frame> _frames;
+    std::deque<Frame*> _free;
+    std::deque<Frame*> _ready;
+    Frame* _current = nullptr;
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    std::thread _producer;
+    bool _stopping = false;
+    bool _done = false;
+    bool _failed = false;
+};
+
+}
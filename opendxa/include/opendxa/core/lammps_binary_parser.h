@@ -0,0 +1,101 @@
+#pragma once
+
+#include <opendxa/core/lammps_parser.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace OpenDXA{
+
+class MappedFile;
+
+// Reader for LAMMPS "dump custom" (and "dump atom") files written in binary
+// mode. Produces the same Frame as LammpsParser, including the requested
+// extra columns. A frame may be split into several chunks, one per MPI rank
+// that wrote it; chunks are gathered in file order and decoded in parallel.
+class LammpsBinaryParser{
+public:
+    using Frame = LammpsParser::Frame;
+    using ColumnRequest = LammpsParser::ColumnRequest;
+    using AtomFilter = LammpsParser::AtomFilter;
+
+    LammpsBinaryParser(){}
+
+    // True if the file does not start like a text dump: either the magic
+    // string header of current LAMMPS versions or the raw int64 timestep
+    // of older ones.
+    static bool isBinaryDump(const std::string &filename);
+
+    void setRequestedColumns(std::vector<ColumnRequest> columns){
+        _requestedColumns = std::move(columns);
+    }
+
+    void setAtomFilter(AtomFilter filter){
+        _atomFilter = std::move(filter);
+    }
+
+    // Column names for files written before LAMMPS stored them in the
+    // header (format revision < 2). Ignored when the header has them.
+    void setColumnNames(std::vector<std::string> names){
+        _columnNames = std::move(names);
+    }
+
+    bool parseFile(const std::string &filename, Frame &frame);
+    bool parseFile(const std::string &filename, size_t frameIndex, Frame &frame);
+
+    class TrajectoryReader{
+    public:
+        explicit TrajectoryReader(const std::string &filename);
+        ~TrajectoryReader();
+
+        TrajectoryReader(const TrajectoryReader&) = delete;
+        TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+        bool isOpen() const;
+        bool next(Frame &frame);
+        void rewind();
+
+        // Frame headers carry their own sizes, so seeking walks them
+        // without touching any atom data.
+        bool seek(size_t frameIndex);
+
+        void setRequestedColumns(std::vector<ColumnRequest> columns){
+            _requestedColumns = std::move(columns);
+        }
+
+        void setColumnNames(std::vector<std::string> names){
+            _columnNames = std::move(names);
+        }
+
+        void setAtomFilter(AtomFilter filter){
+            _atomFilter = std::move(filter);
+        }
+
+        // Advise the kernel to read the next frame ahead while the current
+        // one is processed. Off by default; FramePipeline turns it on.
+        void setPrefetch(bool prefetch){
+            _prefetch = prefetch;
+        }
+
+        bool failed() const{ return _failed; }
+        size_t framesRead() const{ return _framesRead; }
+
+    private:
+        std::unique_ptr<MappedFile> _mapped;
+        std::vector<ColumnRequest> _requestedColumns;
+        std::vector<std::string> _columnNames;
+        AtomFilter _atomFilter;
+        const char* _cursor = nullptr;
+        const char* _released = nullptr;
+        size_t _framesRead = 0;
+        bool _failed = false;
+        bool _prefetch = false;
+    };
+
+private:
+    std::vector<ColumnRequest> _requestedColumns;
+    std::vector<std::string> _columnNames;
+    AtomFilter _atomFilter;
+};
+
+}
@@ -2,26 +2,162 @@
 
 #include <opendxa/core/opendxa.h>
 #include <opendxa/core/simulation_cell.h>
+#include <opendxa/core/frame_index.h>
+#include <opendxa/core/particle_property.h>
 #include <opendxa/math/lin_alg.h>
 #include <fstream>
+#include <map>
+#include <memory>
 
 namespace OpenDXA{
 
+class MappedFile;
+
 class LammpsParser{
 public:
     LammpsParser(){}
 
     struct Frame{
-        int timestep;
-        int natoms;
+        std::int64_t timestep;
+        // Signed like LAMMPS bigint; loaders reject counts above MaxAtomCount.
+        std::int64_t natoms;
         SimulationCell simulationCell;
         std::vector<Point3> positions;
         std::vector<int> types;
-        std::vector<int> ids;
+        std::vector<AtomId> ids;
+        // Extra per-atom columns requested through setRequestedColumns(),
+        // keyed by their name in the ITEM: ATOMS header.
+        std::map<std::string, std::shared_ptr<Particles::ParticleProperty>> properties;
+        // Positions as a ParticleProperty when the loader already has them in
+        // that form (snapshot columns mapped from disk). The positions vector
+        // is left empty then. Null for dump parsers.
+        std::shared_ptr<Particles::ParticleProperty> positionProperty;
+        // Row of each stored atom in the dump when an AtomFilter dropped
+        // atoms during loading, so per-atom results can be scattered back.
+        // Empty for unfiltered frames.
+        std::vector<std::size_t> sourceIndices;
+
+        // Positions of all natoms atoms, from whichever of positionProperty
+        // and positions holds them. Null if neither does.
+        const Point3* positionData() const;
+    };
+
+    // Restricts the atoms a parse keeps. Rows are tested while the atom
+    // section is tokenized and rejected ones are never stored, so the frame
+    // and every later stage scale with the selection instead of the box.
+    struct AtomFilter{
+        // Cartesian region of interest, grown by padding on every side so
+        // atoms near its boundary keep complete neighbor shells. Periodic
+        // images of atoms across a periodic boundary count as inside. An
+        // empty box disables the spatial test.
+        Box3 region;
+        double padding = 0.0;
+        // Atom types to keep; empty keeps every type.
+        std::vector<int> types;
+
+        bool isActive() const{
+            return !region.isEmpty() || !types.empty();
+        }
+    };
+
+    // A dump column to ingest besides id/type/positions. With DataType::Void
+    // the type is inferred from the name: integer LAMMPS attributes (mol,
+    // proc, ix/iy/iz, i_*) become Int, everything else Double. The name "*"
+    // requests every extra column of the frame.
+    struct ColumnRequest{
+        std::string name;
+        Particles::DataType dataType = Particles::DataType::Void;
     };
 
+    void setRequestedColumns(std::vector<ColumnRequest> columns){
+        _requestedColumns = std::move(columns);
+    }
+
+    const std::vector<ColumnRequest>& requestedColumns() const{
+        return _requestedColumns;
+    }
+
+    void setAtomFilter(AtomFilter filter){
+        _atomFilter = std::move(filter);
+    }
+
+    const AtomFilter& atomFilter() const{
+        return _atomFilter;
+    }
+
+    // Cell matrix for LAMMPS box bounds; lo/hi are the bounding box of a
+    // tilted cell as written to dumps.
+    static AffineTransformation boxMatrix(const double lo[3], const double hi[3], const double tilt[3]);
+
+    // False for empty frames and for counts above MaxAtomCount, which are
+    // reported once with a hint about the 64-bit index build.
+    static bool acceptAtomCount(std::int64_t natoms);
+
+    // The frame's positions as a ParticleProperty. Returns positionProperty
+    // as is when the loader provided it, otherwise a copy of the positions
+    // vector. Null if the frame holds no positions.
+    static std::shared_ptr<Particles::ParticleProperty> createPositionProperty(const Frame &frame);
+
     bool parseFile(const std::string &filename, Frame &frame);
 
+    // Parse only the frameIndex-th frame of a multi-frame dump, locating it
+    // through the persistent FrameIndex sidecar instead of rescanning.
+    bool parseFile(const std::string &filename, size_t frameIndex, Frame &frame);
+
+    // Iterates over every ITEM: TIMESTEP block of a multi-frame dump
+    // without splitting it. The file is mapped once and frames are parsed
+    // in order into a caller-owned Frame whose buffers are reused.
+    class TrajectoryReader{
+    public:
+        explicit TrajectoryReader(const std::string &filename);
+        ~TrajectoryReader();
+
+        TrajectoryReader(const TrajectoryReader&) = delete;
+        TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+        bool isOpen() const;
+        bool next(Frame &frame);
+
+        void setRequestedColumns(std::vector<ColumnRequest> columns){
+            _requestedColumns = std::move(columns);
+        }
+        void setAtomFilter(AtomFilter filter){
+            _atomFilter = std::move(filter);
+        }
+        void rewind();
+
+        // Random access through the frame index, which is loaded from or
+        // written to the dump's sidecar on first use. Only available for
+        // memory-mapped files.
+        size_t frameCount();
+        bool seek(size_t frameIndex);
+
+        // Advise the kernel to read the next frame ahead while the current
+        // one is processed. Off by default; FramePipeline turns it on.
+        void setPrefetch(bool prefetch){
+            _prefetch = prefetch;
+        }
+
+        bool failed() const{ return _failed; }
+        size_t framesRead() const{ return _framesRead; }
+
+    private:
+        std::unique_ptr<MappedFile> _mapped;
+        std::string _path;
+        std::vector<ColumnRequest> _requestedColumns;
+        AtomFilter _atomFilter;
+        std::ifstream _stream;
+        FrameIndex _index;
+        bool _indexed = false;
+        const char* _cursor = nullptr;
+        const char* _released = nullptr;
+        size_t _framesRead = 0;
+        bool _failed = false;
+        bool _prefetch = false;
+
+        bool ensureIndex();
+    };
+
 private:
     bool parseStream(std::istream &in, Frame &frame);
     bool readHeader(std::istream &in, Frame &f);
@@ -31,6 +167,9 @@ private:
     std::vector<std::string> parseColumns(const std::string &line);
 
     int findColumn(const std::vector<std::string> &cols, const std::string &name);
+
+    std::vector<ColumnRequest> _requestedColumns;
+    AtomFilter _atomFilter;
 };
 
 }
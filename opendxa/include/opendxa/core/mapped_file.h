@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace OpenDXA{
+
+// Read-only memory mapping of a whole file. On platforms without mmap
+// the mapping is never valid and callers fall back to stream parsing.
+class MappedFile{
+public:
+    // When prefetch is set the whole file is advised as WILLNEED, which
+    // is what single-frame parsing wants. Streaming readers over files
+    // larger than RAM should leave it off and rely on sequential readahead.
+    // A copy-on-write mapping is also writable; writes stay private to the
+    // process and never reach the file.
+    explicit MappedFile(const std::string& filename, bool prefetch = true, bool copyOnWrite = false);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const{ return _valid; }
+    const char* data() const{ return _data; }
+    char* writableData() const{ return _copyOnWrite ? const_cast<char*>(_data) : nullptr; }
+    size_t size() const{ return _size; }
+
+    // Hint that [begin, end) will not be read again so the kernel can
+    // drop those pages. Only whole pages inside the range are released.
+    void release(const char* begin, const char* end) const;
+
+    // Hint that [begin, end) will be read soon.
+    void willNeed(const char* begin, const char* end) const;
+
+private:
+    int _fd = -1;
+    const char* _data = nullptr;
+    size_t _size = 0;
+    bool _valid = false;
+    bool _copyOnWrite = false;
+};
+
+}
@@ -50,6 +50,32 @@ namespace OpenDXA::Particles{
 namespace OpenDXA{
 	using namespace OpenDXA::Particles;
 
+	// LAMMPS atom identifier (tagint). 64-bit so ids from -DLAMMPS_BIGBIG
+	// builds and sparse atom_modify map arrays above INT_MAX survive loading.
+	using AtomId = std::int64_t;
+
+	// Index of an atom within a frame. 32-bit by default, which keeps
+	// per-atom index arrays compact; configure with OPENDXA_64BIT_INDICES=ON
+	// to load frames with more than 2^31 - 1 atoms.
+#ifdef OPENDXA_64BIT_INDICES
+	using AtomIndex = std::int64_t;
+#else
+	using AtomIndex = std::int32_t;
+#endif
+
+	// Largest atom count loaders accept in this build.
+	inline constexpr std::size_t MaxAtomCount = static_cast<std::size_t>(std::numeric_limits<AtomIndex>::max());
+
+	// Floating-point type of the coordinate columns the neighbor finders scan.
+	// Single halves the bytes streamed per candidate and doubles the SIMD width
+	// of the distance tests. Since the finders keep no copy of the positions
+	// beyond these columns (query points are wrapped from the input on demand),
+	// it also cuts their per-atom memory roughly in half.
+	enum class SearchPrecision{
+		Double,
+		Single
+	};
+
 	class NearestNeighborFinder;
 	class StructurePattern;
 	class BurgersVectorFamily;
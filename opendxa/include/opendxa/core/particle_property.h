@@ -67,6 +67,14 @@ public:
                      size_t              stride,
                      bool                initializeMemory);
 
+    ParticleProperty(void*               externalData,
+                     size_t              particleCount,
+                     DataType            dataType,
+                     size_t              componentCount,
+                     size_t              stride,
+                     std::shared_ptr<const void> keepAlive,
+                     Type                type = UserProperty);
+
     ParticleProperty(const ParticleProperty& other);
 
     Type type() const { return _type; }
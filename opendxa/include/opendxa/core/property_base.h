@@ -20,6 +20,10 @@ enum class DataType : int{
     Int64= 7 
 };
 
+// Element type of properties that hold atom indices, such as the neighbor
+// lists of the structure identification.
+inline constexpr DataType AtomIndexDataType = sizeof(AtomIndex) == sizeof(std::int64_t) ? DataType::Int64 : DataType::Int;
+
 class PropertyBase{
 public:
     PropertyBase();
@@ -28,9 +32,22 @@ public:
                 std::size_t componentCount,
                 std::size_t stride,
                 bool initializeMemory);
+    // Wraps memory owned elsewhere, e.g. a column of a mapped snapshot,
+    // without copying it. keepAlive holds the owner for the lifetime of
+    // the property; a resize moves the data into owned storage.
+    PropertyBase(void* externalData,
+                std::size_t count,
+                DataType dataType,
+                std::size_t componentCount,
+                std::size_t stride,
+                std::shared_ptr<const void> keepAlive);
     PropertyBase(const PropertyBase& other);
     ~PropertyBase();
 
+    [[nodiscard]] bool isExternal() const noexcept{
+        return _externalData != nullptr;
+    }
+
     [[nodiscard]] std::size_t size() const noexcept{
         return _numElements;
     }
@@ -67,12 +84,33 @@ public:
     void setInt64Component(std::size_t index, std::size_t componentIndex, std::int64_t v){
         dataInt64()[index * _componentCount + componentIndex] = v;
     }
+
+    [[nodiscard]] const AtomIndex* constDataAtomIndex() const noexcept{
+        assert(_dataType == AtomIndexDataType);
+        return reinterpret_cast<const AtomIndex*>(constData());
+    }
+
+    AtomIndex* dataAtomIndex() noexcept{
+        assert(_dataType == AtomIndexDataType);
+        return reinterpret_cast<AtomIndex*>(data());
+    }
+
+    AtomIndex getAtomIndexComponent(std::size_t index, std::size_t componentIndex) const{
+        assert(index < _numElements && componentIndex < _componentCount);
+        return constDataAtomIndex()[index * _componentCount + componentIndex];
+    }
+
+    void setAtomIndexComponent(std::size_t index, std::size_t componentIndex, AtomIndex v){
+        assert(index < _numElements && componentIndex < _componentCount);
+        dataAtomIndex()[index * _componentCount + componentIndex] = v;
+    }
+
     [[nodiscard]] std::size_t componentCount() const noexcept{
         return _componentCount;
     }
 
     [[nodiscard]] const void* constData() const noexcept{
-        return _data.get();
+        return _externalData ? _externalData : _data.get();
     }
 
     [[nodiscard]] const int* constDataInt() const noexcept{
@@ -96,7 +134,7 @@ public:
     }
 
     void* data() noexcept{
-        return _data.get();
+        return _externalData ? _externalData : _data.get();
     }
 
     int* dataInt() noexcept{
@@ -203,6 +241,8 @@ protected:
     std::size_t _stride = 0;
     std::size_t _componentCount = 0;
     std::unique_ptr<std::uint8_t[]> _data;
+    std::uint8_t* _externalData = nullptr;
+    std::shared_ptr<const void> _keepAlive;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,301 @@
+#pragma once
+
+// Vectorised tokenizer for whitespace separated numeric text such as the
+// atom section of a LAMMPS dump. Input is classified 64 bytes at a time
+// into separator and newline bitmasks (AVX2 or SSE2 when the target has
+// them, a scalar loop otherwise) and token boundaries are found with bit
+// scans instead of per-character branches. Numbers in the plain fixed or
+// exponent notation LAMMPS writes take an exact fast path; anything else
+// falls back to fast_float.
+//
+// Self-contained C++17 so the server's native addons can vendor this
+// header next to their copy of fast_float.h.
+
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#if __has_include(<fast_float/fast_float.h>)
+#include <fast_float/fast_float.h>
+#else
+#include "fast_float.h"
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace OpenDXA::Tokenizer{
+
+struct BlockMasks{
+    // Bit i is set when byte i is <= ' ' (space, tab, CR, LF, NUL...).
+    std::uint64_t separator;
+    // Bit i is set when byte i is '\n'.
+    std::uint64_t newline;
+};
+
+// Classify 64 readable bytes starting at p.
+inline BlockMasks classify64(const char* p){
+#if defined(__AVX2__)
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    // Unsigned x <= ' ' <=> max(x, ' ') == ' '.
+    const std::uint64_t sepLo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, space), space)));
+    const std::uint64_t sepHi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(hi, space), space)));
+    const std::uint64_t nlLo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, lf)));
+    const std::uint64_t nlHi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, lf)));
+    return { sepLo | (sepHi << 32), nlLo | (nlHi << 32) };
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i lf = _mm_set1_epi8('\n');
+    std::uint64_t separator = 0;
+    std::uint64_t newline = 0;
+    for(int i = 0; i < 4; ++i){
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+        const std::uint64_t sep = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, space), space)));
+        const std::uint64_t nl = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)));
+        separator |= sep << (16 * i);
+        newline |= nl << (16 * i);
+    }
+    return { separator, newline };
+#else
+    std::uint64_t separator = 0;
+    std::uint64_t newline = 0;
+    for(int i = 0; i < 64; ++i){
+        const unsigned char c = static_cast<unsigned char>(p[i]);
+        separator |= static_cast<std::uint64_t>(c <= ' ') << i;
+        newline |= static_cast<std::uint64_t>(c == '\n') << i;
+    }
+    return { separator, newline };
+#endif
+}
+
+inline int countTrailingZeros(std::uint64_t v){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while(!(v & 1)){ v >>= 1; ++n; }
+    return n;
+#endif
+}
+
+inline bool anyBit(std::uint64_t v){
+    return v != 0;
+}
+
+struct Token{
+    const char* begin;
+    const char* end;
+    // True when at least one '\n' lies between the previous token and
+    // this one, i.e. the token starts a new line.
+    bool newline;
+};
+
+// Streams the tokens of [begin, end). Bytes past end are never read: the
+// final partial block is classified from a copy padded with spaces.
+class TokenScanner{
+public:
+    TokenScanner(const char* begin, const char* end)
+        : _block(begin), _end(end){
+        load();
+    }
+
+    bool next(Token& token){
+        bool newline = false;
+
+        // Find the first non-separator at or after the cursor.
+        std::uint64_t live = ~_masks.separator & fromBit(_bit);
+        while(!anyBit(live)){
+            newline |= anyBit(_masks.newline & fromBit(_bit));
+            if(!advance()) return false;
+            live = ~_masks.separator;
+        }
+        const int start = countTrailingZeros(live);
+        newline |= anyBit(_masks.newline & fromBit(_bit) & belowBit(start));
+        token.begin = _block + start;
+        token.newline = newline;
+
+        // Then the separator that ends the token, which may lie in a
+        // following block for tokens that straddle a block boundary.
+        std::uint64_t stop = _masks.separator & fromBit(start);
+        while(!anyBit(stop)){
+            if(!advance()){
+                token.end = _end;
+                return true;
+            }
+            stop = _masks.separator;
+        }
+        const int finish = countTrailingZeros(stop);
+        token.end = _block + finish;
+        _bit = finish;
+        return true;
+    }
+
+private:
+    static std::uint64_t fromBit(int bit){
+        return bit >= 64 ? 0 : (~std::uint64_t(0) << bit);
+    }
+
+    static std::uint64_t belowBit(int bit){
+        return bit >= 64 ? ~std::uint64_t(0) : ((std::uint64_t(1) << bit) - 1);
+    }
+
+    bool advance(){
+        if(_end - _block <= 64){
+            // Exhausted: leave an all-separator block so later calls stop.
+            _block = _end;
+            _masks = { ~std::uint64_t(0), 0 };
+            _bit = 64;
+            return false;
+        }
+        _block += 64;
+        load();
+        return true;
+    }
+
+    void load(){
+        _bit = 0;
+        if(_end - _block >= 64){
+            _masks = classify64(_block);
+        }else{
+            char padded[64];
+            const std::size_t tail = _end > _block ? static_cast<std::size_t>(_end - _block) : 0;
+            std::memset(padded, ' ', sizeof(padded));
+            std::memcpy(padded, _block, tail);
+            _masks = classify64(padded);
+        }
+    }
+
+    const char* _block;
+    const char* _end;
+    BlockMasks _masks{};
+    int _bit = 0;
+};
+
+inline bool isDigit(char c){
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// SWAR check and conversion of eight ASCII digits loaded little-endian.
+inline bool isEightDigits(std::uint64_t v){
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+inline std::uint32_t parseEightDigits(std::uint64_t v){
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return static_cast<std::uint32_t>(v);
+}
+#define OPENDXA_TOKENIZER_SWAR 1
+#endif
+
+// Parse a complete token as a double. The exact path covers decimal and
+// exponent notation whose significand fits in 53 bits and whose decimal
+// exponent is within +-22: both operands are then exact doubles and one
+// IEEE multiply or divide rounds correctly (Clinger's fast path).
+inline bool parseDouble(const char* begin, const char* end, double& out){
+    static constexpr double Pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* p = begin;
+    bool negative = false;
+    if(p < end && *p == '-'){
+        negative = true;
+        ++p;
+    }
+
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    while(p < end && isDigit(*p)){
+        mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+        ++p;
+        ++digits;
+    }
+    if(p < end && *p == '.'){
+        ++p;
+        const char* fraction = p;
+#ifdef OPENDXA_TOKENIZER_SWAR
+        while(end - p >= 8 && digits + (p - fraction) + 8 <= 19){
+            std::uint64_t chunk;
+            std::memcpy(&chunk, p, sizeof(chunk));
+            if(!isEightDigits(chunk)) break;
+            mantissa = mantissa * 100000000ULL + parseEightDigits(chunk);
+            p += 8;
+        }
+#endif
+        while(p < end && isDigit(*p) && digits + (p - fraction) < 19){
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            ++p;
+        }
+        if(p < end && isDigit(*p)) goto fallback;
+        digits += static_cast<int>(p - fraction);
+        exponent = -static_cast<int>(p - fraction);
+    }
+    if(digits == 0 || digits > 19) goto fallback;
+
+    if(p < end && (*p == 'e' || *p == 'E')){
+        ++p;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+')){
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+        int value = 0;
+        const char* expDigits = p;
+        while(p < end && isDigit(*p) && p - expDigits < 4){
+            value = value * 10 + (*p - '0');
+            ++p;
+        }
+        if(p == expDigits) goto fallback;
+        exponent += negativeExponent ? -value : value;
+    }
+    if(p != end) goto fallback;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+    // Extended precision intermediates (x87) would round twice.
+    goto fallback;
+#endif
+    if(mantissa > (std::uint64_t(1) << 53) || exponent < -22 || exponent > 22) goto fallback;
+
+    {
+        double value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / Pow10[-exponent] : value * Pow10[exponent];
+        out = negative ? -value : value;
+        return true;
+    }
+
+fallback:
+    auto result = fast_float::from_chars(begin, end, out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Number of '\n' bytes in [p, end).
+inline std::size_t countNewlines(const char* p, const char* end){
+    std::size_t count = 0;
+    while(end - p >= 64){
+        const std::uint64_t newline = classify64(p).newline;
+#if defined(__GNUC__) || defined(__clang__)
+        count += static_cast<std::size_t>(__builtin_popcountll(newline));
+#else
+        for(std::uint64_t v = newline; v; v &= v - 1) ++count;
+#endif
+        p += 64;
+    }
+    for(; p < end; ++p){
+        count += (*p == '\n');
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <opendxa/core/lammps_parser.h>
+#include <cstdint>
+#include <string>
+
+namespace OpenDXA{
+
+// Columnar binary snapshot of a single frame (".dxasnap").
+//
+// Layout: a fixed header with timestep, atom count, cell matrix and PBC
+// flags, followed by a column directory and one contiguous array per
+// column, each starting on a 64-byte boundary. The "position" (3 doubles),
+// "id" (int64) and "type" (int) columns are always present, frames loaded
+// through an AtomFilter add "source_index" (int64), and every entry of
+// Frame::properties is stored under its own name.
+//
+// Loading maps the file copy-on-write. Positions and extra columns are
+// wrapped in ParticleProperty objects that point straight into the
+// mapping (Frame::positionProperty, Frame::properties) and are not
+// copied; Frame::positions stays empty. The id, type and source_index
+// columns are copied into their Frame vectors, which own their storage.
+// Core columns with an unexpected type or stride are rejected.
+class Snapshot{
+public:
+    static constexpr const char* Extension = ".dxasnap";
+    static constexpr std::uint32_t FormatVersion = 1;
+    static constexpr std::size_t Alignment = 64;
+
+    static bool isSnapshot(const std::string &filename);
+
+    static bool write(const std::string &filename, const LammpsParser::Frame &frame);
+    static bool read(const std::string &filename, LammpsParser::Frame &frame);
+};
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <opendxa/core/lammps_parser.h>
+#include <cstddef>
+#include <vector>
+
+namespace OpenDXA{
+
+// Optional stage between loading a frame and analyzing it that stores the
+// atoms in Morton (Z-order) order of their reduced cell coordinates. Dumps
+// list atoms by processor and id, so neighbors end up scattered across
+// every per-atom array; after sorting, atoms that are close in space are
+// close in memory for the neighbor finders and all per-atom properties.
+//
+// Every per-atom member of the frame is permuted together, and
+// Frame::sourceIndices records the dump row of each stored atom so the
+// exporters can write results back in the original order (see
+// exportOrder()).
+class SpatialSort{
+public:
+    // Whether OPENDXA_SPATIAL_SORT asks for the stage.
+    static bool enabledFromEnvironment();
+
+    static void reorder(LammpsParser::Frame &frame);
+
+    // Stored atom to export at each position so that per-atom output follows
+    // the dump: order[k] is the k-th atom in file order. Empty when the
+    // stored order already is the file order.
+    static std::vector<std::size_t> exportOrder(const LammpsParser::Frame &frame);
+};
+
+}
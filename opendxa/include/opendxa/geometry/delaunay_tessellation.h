@@ -143,7 +143,7 @@ public:
 
     [[nodiscard]] std::optional<bool> alphaTest(CellHandle cell, double alpha) const;
 
-    [[nodiscard]] int vertexIndex(VertexHandle vertex) const{
+    [[nodiscard]] AtomIndex vertexIndex(VertexHandle vertex) const{
         assert(vertex < _particleIndices.size());
         return _particleIndices[vertex];
     }
@@ -28,7 +28,7 @@ public:
 	struct DefaultPrepareMeshFaceFunc{
 		void operator()(
 			typename HalfEdgeStructureType::Face*, 
-			const std::array<int, 3>&, 
+			const std::array<AtomIndex, 3>&, 
 			const std::array<DelaunayTessellation::VertexHandle, 3>&, 
 			DelaunayTessellation::CellHandle
 		){}
@@ -153,10 +153,10 @@ private:
 
                 std::array<typename HalfEdgeStructureType::Vertex*,3> facetVertices;
                 std::array<DelaunayTessellation::VertexHandle,3> vertexHandles;
-                std::array<int,3> vertexIndices;
+                std::array<AtomIndex, 3> vertexIndices;
                 for(int v = 0; v < 3; v++){
                     vertexHandles[v] = _tessellation.cellVertex(cell, DelaunayTessellation::cellFacetVertexIndex(f, FlipOrientation ? (2-v) : v));
-                    int idx = vertexIndices[v] = _tessellation.vertexIndex(vertexHandles[v]);
+                    AtomIndex idx = vertexIndices[v] = _tessellation.vertexIndex(vertexHandles[v]);
                     
                     if(vertexMap[idx] == nullptr){
                         vertexMap[idx] = _mesh.createVertex(_positions->getPoint3(idx));
@@ -250,7 +250,7 @@ private:
 		if(_tessellation.getCellIndex(cell) != -1){
 			return _tetrahedraFaceList[_tessellation.getCellIndex(cell)][facet.second];
 		}
-		std::array<int,3> faceVerts;
+		std::array<AtomIndex, 3> faceVerts;
 		for(std::size_t i = 0; i < 3; ++i){
 			int idx = DelaunayTessellation::cellFacetVertexIndex(facet.second, FlipOrientation ? (2-i) : i);
 			faceVerts[i] = _tessellation.vertexIndex(_tessellation.cellVertex(cell, idx));
@@ -260,7 +260,7 @@ private:
 		return (it != _faceLookupMap.end()) ? it->second : nullptr;
 	}
 
-	static void reorderFaceVertices(std::array<int,3>& vertexIndices){
+	static void reorderFaceVertices(std::array<AtomIndex, 3>& vertexIndices){
 		std::rotate(
 			vertexIndices.begin(), 
 			std::min_element(vertexIndices.begin(), vertexIndices.end()), 
@@ -275,7 +275,7 @@ private:
 	ParticleProperty* _positions;
 	HalfEdgeStructureType& _mesh;
 	std::vector<std::array<typename HalfEdgeStructureType::Face*, 4>> _tetrahedraFaceList;
-    tbb::concurrent_unordered_map<std::array<int,3>, typename HalfEdgeStructureType::Face*, boost::hash<std::array<int, 3>>> _faceLookupMap;
+    tbb::concurrent_unordered_map<std::array<AtomIndex, 3>, typename HalfEdgeStructureType::Face*, boost::hash<std::array<AtomIndex, 3>>> _faceLookupMap;
     tbb::spin_mutex _mutex;
 };
 
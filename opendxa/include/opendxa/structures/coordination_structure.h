@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <opendxa/math/lin_alg.h>
 #include <opendxa/structures/crystal_structure_types.h>
@@ -49,12 +50,16 @@ void bitmapSort(iterator begin, iterator end, int max){
 // commonNeighbors[i][0 ... 1] can store up to two neighbor indices that
 // are shared between this atom and neighbor i, helping to accelerate
 // some toplogy checks without recomputing bitmasks.
+// neighborClasses[i] is the class key of neighbor i used by the CNA neighbor
+// matcher, and neighborClassSizes[i] the number of neighbors sharing it.
 struct CoordinationStructure{
     int numNeighbors;
     std::vector<Vector3> latticeVectors;
     NeighborBondArray neighborArray;
     int cnaSignatures[MAX_NEIGHBORS];
     int commonNeighbors[MAX_NEIGHBORS][2];
+    std::uint64_t neighborClasses[MAX_NEIGHBORS];
+    int neighborClassSizes[MAX_NEIGHBORS];
 };
 
 }
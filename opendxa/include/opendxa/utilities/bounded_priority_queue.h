@@ -4,11 +4,103 @@
 #include <array>
 #include <algorithm>
 #include <functional>
+#include <type_traits>
 
 namespace OpenDXA{
-    
-template <typename T, typename Compare = std::less<T>, int QUEUE_SIZE_LIMIT = 32>
+
+// Queues with a compile-time limit up to this size keep their elements in a
+// sorted array instead of a heap (see SortedQueueOrder below).
+constexpr int SortedQueueSizeLimit = 32;
+
+// Insertion strategy of large queues: the elements form a binary max-heap
+// with the largest at the front, and sort() orders them ascending.
+struct HeapQueueOrder{
+    static int topIndex(int) noexcept{
+        return 0;
+    }
+
+    template <typename T, typename Compare>
+    static void insert(T* data, int& count, int maxSize, const T& x, const Compare& comp){
+        T* data1 = data - 1;
+        if(count == maxSize){
+            if(comp(x, data[0])){
+                int j = 1;
+                int k = 2;
+                while(k <= count){
+                    T* z = &data1[k];
+                    if(k < count && comp(*z, data1[k + 1])){
+                        z = &data1[++k];
+                    }
+
+                    if(comp(*z, x)) break;
+                    data1[j] = *z;
+                    j = k;
+                    k = j << 1;
+                }
+
+                data1[j] = x;
+            }
+        }else{
+            int i = ++count;
+            int j;
+            while(i >= 2){
+                j = i >> 1;
+                T& y = data1[j];
+                if(comp(x, y)) break;
+                data1[i] = y;
+                i = j;
+            }
+
+            data1[i] = x;
+        }
+    }
+
+    template <typename T, typename Compare>
+    static void sort(T* data, int count, const Compare& comp){
+        std::sort(data, data + count, comp);
+    }
+};
+
+// For the small limits of the nearest-neighbor queries (k = 12..18 for CNA
+// and PTM) the elements are kept in ascending order at all times. An insertion
+// shifts the larger elements up by one slot, which for a dozen entries is a
+// short, predictable loop over contiguous memory, while the heap jumps between
+// levels with a data-dependent branch at each. The top is the last element and
+// sort() has nothing left to do.
+struct SortedQueueOrder{
+    static int topIndex(int count) noexcept{
+        return count - 1;
+    }
+
+    template <typename T, typename Compare>
+    static void insert(T* data, int& count, int maxSize, const T& x, const Compare& comp){
+        int i;
+        if(count == maxSize){
+            if(!comp(x, data[count - 1])) return;
+            // The current largest element drops out.
+            i = count - 1;
+        }else{
+            i = count++;
+        }
+        while(i > 0 && comp(x, data[i - 1])){
+            data[i] = data[i - 1];
+            i--;
+        }
+        data[i] = x;
+    }
+
+    template <typename T, typename Compare>
+    static void sort(T*, int, const Compare&) noexcept{}
+};
+
+// Keeps the maxSize smallest elements inserted so far; top() is the largest
+// of them and sort() orders them ascending. How the elements are arranged in
+// between is up to the insertion strategy, which is the sorted array for
+// limits up to SortedQueueSizeLimit and the heap above.
+template <typename T, typename Compare = std::less<T>, int QUEUE_SIZE_LIMIT = 32, bool SORTED = (QUEUE_SIZE_LIMIT <= SortedQueueSizeLimit)>
 class BoundedPriorityQueue{
+    using Order = std::conditional_t<SORTED, SortedQueueOrder, HeapQueueOrder>;
+
 public:
     using value_type = T;
     using const_iterator = const value_type*;
@@ -22,6 +114,10 @@ public:
         return _count;
     }
 
+    [[nodiscard]] int maxSize() const noexcept{
+        return _maxSize;
+    }
+
     void clear() noexcept{
         _count = 0;
     }
@@ -36,42 +132,11 @@ public:
 
     [[nodiscard]] const value_type& top() const{
         assert(!empty());
-        return _data[0];
+        return _data[Order::topIndex(_count)];
     }
 
     void insert(const value_type &x){
-        value_type* data1 = &_data[0] - 1;
-        if(full()){
-            if(_comp(x, top())){
-                int j = 1;
-                int k = 2;
-                while(k <= _count){
-                    value_type* z = &data1[k];
-                    if(k < _count && _comp(*z, data1[k + 1])){
-                        z = &data1[++k];
-                    }
-
-                    if(_comp(*z, x)) break;
-                    data1[j] = *z;
-                    j = k;
-                    k = j << 1;
-                }
-
-                data1[j] = x;
-            }
-        }else{
-            int i = ++_count;
-            int j;
-            while(i >= 2){
-                j = i >> 1;
-                value_type& y = data1[j];
-                if(_comp(x, y)) break;
-                data1[i] = y;
-                i = j;
-            }
-
-            data1[i] = x;
-        }
+        Order::insert(_data.data(), _count, _maxSize, x, _comp);
     }
 
     [[nodiscard]] const_iterator begin() const noexcept{
@@ -88,7 +153,7 @@ public:
     }
 
     void sort(){
-        std::sort(_data.begin(), _data.begin() + _count, _comp);
+        Order::sort(_data.data(), _count, _comp);
     }
 
 protected:
@@ -98,4 +163,4 @@ protected:
     Compare _comp;
 };
 
-}
\ No newline at end of file
+}
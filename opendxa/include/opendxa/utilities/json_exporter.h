@@ -52,7 +52,7 @@ public:
 
     json getCentroSymmetryData(
         const CentroSymmetryAnalysis::Engine& engine,
-        const std::vector<int>& ids
+        const std::vector<AtomId>& ids
     );
 
     json exportClusterGraphToJson(const ClusterGraph* graph);
@@ -68,7 +68,7 @@ public:
 
     json getDisplacementsData(
         const ComputeDisplacements& engine,
-        const std::vector<int>& ids
+        const std::vector<AtomId>& ids
     );
 
     json getInterfaceMeshData(
@@ -78,16 +78,16 @@ public:
     );
     
     json getAtomsData(const LammpsParser::Frame& frame, const BurgersLoopBuilder* tracer, const std::vector<int>* structureTypes = nullptr);
-    json getAtomicStrainData(const AtomicStrainModifier::AtomicStrainEngine& engine, const std::vector<int>& ids);
-    json getElasticStrainData(const ElasticStrainEngine& engine, const std::vector<int>& ids);
-    json getPTMData(const AnalysisContext& context, const std::vector<int>& ids);
-    void exportPTMData(const AnalysisContext& context, const std::vector<int>& ids, const std::string& outputFilename);
+    json getAtomicStrainData(const AtomicStrainModifier::AtomicStrainEngine& engine, const std::vector<AtomId>& ids);
+    json getElasticStrainData(const ElasticStrainEngine& engine, const std::vector<AtomId>& ids);
+    json getPTMData(const AnalysisContext& context, const std::vector<AtomId>& ids);
+    void exportPTMData(const AnalysisContext& context, const std::vector<AtomId>& ids, const std::string& outputFilename);
     json getProcessingTime();
     json getMetadata();
 
     json getClusterAnalysisData(
         const ClusterAnalysis::ClusterAnalysisEngine& engine,
-        const std::vector<int>& ids
+        const std::vector<AtomId>& ids
     );
     
     json getNetworkStatistics(const DislocationNetwork* network, double cellVolume);
@@ -133,9 +133,21 @@ public:
         const std::string& filePath
     );
 
+    // Order in which per-atom records are written: row k is stored atom
+    // order[k] (see SpatialSort::exportOrder). Empty writes atoms in storage
+    // order.
+    void setAtomOrder(std::vector<size_t> order){
+        _atomOrder = std::move(order);
+    }
+
+    size_t atomAt(size_t row) const{
+        return _atomOrder.empty() ? row : _atomOrder[row];
+    }
+
 private:
     std::string _filename;
     std::chrono::high_resolution_clock::time_point _startTime;
+    std::vector<size_t> _atomOrder;
 
 
     
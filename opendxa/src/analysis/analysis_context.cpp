@@ -31,6 +31,7 @@ AnalysisContext::AnalysisContext(
 
     atomClusters = std::make_shared<ParticleProperty>(numAtoms, DataType::Int, 1, 0, true);
     atomSymmetryPermutations = std::make_shared<ParticleProperty>(numAtoms, DataType::Int, 1, 0, false);
+    neighborCache = std::make_shared<NeighborListCache>(positions, simCell);
 
     if(numAtoms > 0){
         std::fill(
@@ -42,37 +42,36 @@ AtomicStrainModifier::AtomicStrainEngine::AtomicStrainEngine(
 }
 
 void AtomicStrainModifier::AtomicStrainEngine::perform(){
-    std::vector<int> currentToRefIndexMap(positions()->size());
-    std::vector<int> refToCurrentIndexMap(refPositions()->size());
+    if(positions()->size() > MaxAtomCount || refPositions()->size() > MaxAtomCount)
+        throw std::runtime_error("Cannot calculate atomic strain. Too many particles for the atom index type of this build.");
+
+    std::vector<AtomIndex> currentToRefIndexMap(positions()->size());
+    std::vector<AtomIndex> refToCurrentIndexMap(refPositions()->size());
 
     if(_identifiers && _refIdentifiers){
         assert(_identifiers->size()    == positions()->size());
         assert(_refIdentifiers->size() == refPositions()->size());
 
-        std::map<int,int> refMap;
-        int index = 0;
-        for(int id : _refIdentifiers->constIntRange()){
-            if(!refMap.insert(std::make_pair(id,index)).second)
+        std::map<AtomId,AtomIndex> refMap;
+        for(std::size_t index = 0; index < _refIdentifiers->size(); ++index){
+            if(!refMap.insert(std::make_pair(_refIdentifiers->getInt64(index), static_cast<AtomIndex>(index))).second)
                 throw std::runtime_error("Particles with duplicate identifiers detected in reference configuration.");
-            ++index;
         }
 
-        std::map<int,int> currentMap;
-        index = 0;
-        for(int id : _identifiers->constIntRange()){
-            if(!currentMap.insert(std::make_pair(id,index)).second)
+        std::map<AtomId,AtomIndex> currentMap;
+        for(std::size_t index = 0; index < _identifiers->size(); ++index){
+            if(!currentMap.insert(std::make_pair(_identifiers->getInt64(index), static_cast<AtomIndex>(index))).second)
                 throw std::runtime_error("Particles with duplicate identifiers detected in current configuration.");
-            ++index;
         }
 
-        const int* id = _identifiers->constDataInt();
+        const AtomId* id = _identifiers->constDataInt64();
         for(auto& mappedIndex : currentToRefIndexMap){
             auto it = refMap.find(*id);
             mappedIndex = (it != refMap.end()) ? it->second : -1;
             ++id;
         }
 
-        id = _refIdentifiers->constDataInt();
+        id = _refIdentifiers->constDataInt64();
         for(auto& mappedIndex : refToCurrentIndexMap){
             auto it = currentMap.find(*id);
             mappedIndex = (it != currentMap.end()) ? it->second : -1;
@@ -81,8 +80,8 @@ void AtomicStrainModifier::AtomicStrainEngine::perform(){
     }else{
         if(positions()->size() != refPositions()->size())
             throw std::runtime_error("Cannot calculate displacements. Numbers of particles in reference configuration and current configuration do not match.");
-        std::iota(refToCurrentIndexMap.begin(),   refToCurrentIndexMap.end(),   0);
-        std::iota(currentToRefIndexMap.begin(),   currentToRefIndexMap.end(),   0);
+        std::iota(refToCurrentIndexMap.begin(),   refToCurrentIndexMap.end(),   AtomIndex(0));
+        std::iota(currentToRefIndexMap.begin(),   currentToRefIndexMap.end(),   AtomIndex(0));
     }
 
     _simCellRef.setPbcFlags(_simCell.pbcFlags());
@@ -128,13 +127,13 @@ void AtomicStrainModifier::AtomicStrainEngine::perform(){
 bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
     std::size_t                 particleIndex,
     CutoffNeighborFinder&       neighborFinder,
-    const std::vector<int>&     refToCurrentIndexMap,
-    const std::vector<int>&     currentToRefIndexMap){
+    const std::vector<AtomIndex>& refToCurrentIndexMap,
+    const std::vector<AtomIndex>& currentToRefIndexMap){
     Matrix_3<double> V = Matrix_3<double>::Zero();
     Matrix_3<double> W = Matrix_3<double>::Zero();
     int numNeighbors = 0;
 
-    int particleIndexReference = currentToRefIndexMap[particleIndex];
+    AtomIndex particleIndexReference = currentToRefIndexMap[particleIndex];
 
     if(particleIndexReference != -1){
         const Point3 x = positions()->getPoint3(particleIndex);
@@ -142,7 +141,7 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
         for(CutoffNeighborFinder::Query neighQuery(neighborFinder, particleIndexReference);
             !neighQuery.atEnd(); neighQuery.next()){
             const Vector3& r0 = neighQuery.delta();
-            int neighborIndexCurrent = refToCurrentIndexMap[neighQuery.current()];
+            AtomIndex neighborIndexCurrent = refToCurrentIndexMap[neighQuery.current()];
             if(neighborIndexCurrent == -1) continue;
 
             Vector3 r = positions()->getPoint3(neighborIndexCurrent) - x;
@@ -220,7 +219,7 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
             !neighQuery.atEnd(); neighQuery.next())
         {
             const Vector3& r0 = neighQuery.delta();
-            int neighborIndexCurrent = refToCurrentIndexMap[neighQuery.current()];
+            AtomIndex neighborIndexCurrent = refToCurrentIndexMap[neighQuery.current()];
             if(neighborIndexCurrent == -1) continue;
 
             Vector3 r = positions()->getPoint3(neighborIndexCurrent) - x;
@@ -113,6 +113,7 @@ void ClusterAnalysis::ClusterAnalysisEngine::doClusteringCutoff(std::vector<Poin
     const std::size_t n = _positions->size();
 
     CutoffNeighborFinder neighFinder;
+    neighFinder.setPrecision(_precision);
     if(!neighFinder.prepare(_cutoff, _positions, _simCell)) return;
 
     const Point3* pos = _positions->constDataPoint3();
@@ -17,7 +17,7 @@ ClusterConnector::ClusterConnector(
     _neighborMutexes = std::make_unique<tbb::spin_mutex[]>(1024);
 }
 
-void ClusterConnector::connectClusterNeighbors(int atomIndex, Cluster* cluster1){
+void ClusterConnector::connectClusterNeighbors(AtomIndex atomIndex, Cluster* cluster1){
     int structureType = _context.structureTypes->getInt(atomIndex);
     const LatticeStructure& latticeStructure = CoordinationStructures::getLatticeStruct(structureType);
     const CoordinationStructure& coordStructure = CoordinationStructures::getCoordStruct(structureType);
@@ -26,14 +26,14 @@ void ClusterConnector::connectClusterNeighbors(int atomIndex, Cluster* cluster1)
 
     const int nn = _sa.numberOfNeighbors(atomIndex); 
     for(int ni = 0; ni < nn; ++ni){
-        int neighbor = _sa.getNeighbor(atomIndex, ni);
+        AtomIndex neighbor = _sa.getNeighbor(atomIndex, ni);
         if(neighbor < 0 || neighbor == atomIndex) continue;
         processNeighborConnection(atomIndex, neighbor, ni, cluster1, structureType);
     }
 }
 
 // Groups atoms with the same structure (FCC, BCC, HCP, etc.).
-Cluster* ClusterConnector::startNewCluster(int atomIndex, int structureType){
+Cluster* ClusterConnector::startNewCluster(AtomIndex atomIndex, int structureType){
     Cluster* cluster = _sa.clusterGraph().createCluster(structureType);
     assert(cluster->id > 0);
     
@@ -57,14 +57,14 @@ Matrix3 ClusterConnector::quaternionToMatrix(const Quaternion& q)  {
     return R;
 }
 
-Quaternion ClusterConnector::getPTMAtomOrientation(int atom) const{
-    const double *qdata = _context.ptmOrientation->dataDouble() + atom * 4;
+Quaternion ClusterConnector::getPTMAtomOrientation(AtomIndex atom) const{
+    const double *qdata = _context.ptmOrientation->dataDouble() + static_cast<size_t>(atom) * 4;
     Quaternion quat(qdata[0], qdata[1], qdata[2], qdata[3]);
     quat.normalize();
     return quat;
 }
 
-bool ClusterConnector::areOrientationsCompatible(int atom1, int atom2, int structureType){  
+bool ClusterConnector::areOrientationsCompatible(AtomIndex atom1, AtomIndex atom2, int structureType){  
     Quaternion q1 = getPTMAtomOrientation(atom1);
     Quaternion q2 = getPTMAtomOrientation(atom2);
     Quaternion quatDiff = q1.inverse() * q2;
@@ -101,7 +101,7 @@ bool ClusterConnector::areOrientationsCompatible(int atom1, int atom2, int struc
     return false;
 }
 
-bool ClusterConnector::calculateMisorientation(int atomIndex, int neighbor, int neighborIndex, Matrix3& outTransition){
+bool ClusterConnector::calculateMisorientation(AtomIndex atomIndex, AtomIndex neighbor, int neighborIndex, Matrix3& outTransition){
     int structureType = _context.structureTypes->getInt(atomIndex);
     const LatticeStructure& latticeStructure = CoordinationStructures::getLatticeStruct(structureType);
     const CoordinationStructure& coordStructure = CoordinationStructures::getCoordStruct(structureType);
@@ -142,7 +142,7 @@ bool ClusterConnector::calculateMisorientation(int atomIndex, int neighbor, int
 
     Matrix3 tm1, tm2;
     for (int i = 0; i < 3; i++){
-        int ai;
+        AtomIndex ai;
         if(i != 2){
             int cnIdx = coordStructure.commonNeighbors[neighborIndex][i];
             if(cnIdx < 0) return false;
@@ -177,7 +177,7 @@ bool ClusterConnector::calculateMisorientation(int atomIndex, int neighbor, int
     return true;
 }
 
-void ClusterConnector::createNewClusterTransition(int atomIndex, int neighbor, int neighborIndex, Cluster* cluster1, Cluster* cluster2){
+void ClusterConnector::createNewClusterTransition(AtomIndex atomIndex, AtomIndex neighbor, int neighborIndex, Cluster* cluster1, Cluster* cluster2){
     Matrix3 transition;
     if(!calculateMisorientation(atomIndex, neighbor, neighborIndex, transition)) return;
     if(!transition.isOrthogonalMatrix()) return;
@@ -188,15 +188,15 @@ void ClusterConnector::createNewClusterTransition(int atomIndex, int neighbor, i
     }
 }
 
-void ClusterConnector::addReverseNeighbor(int neighbor, int atomIndex){
+void ClusterConnector::addReverseNeighbor(AtomIndex neighbor, AtomIndex atomIndex){
     tbb::spin_mutex::scoped_lock lock(_neighborMutexes[neighbor & 1023]);
     int otherListCount = _sa.numberOfNeighbors(neighbor);
     if(otherListCount < _context.neighborLists->componentCount()){
-        _context.neighborLists->setIntComponent(neighbor, otherListCount, atomIndex);
+        _context.neighborLists->setAtomIndexComponent(neighbor, otherListCount, atomIndex);
     }
 }
 
-void ClusterConnector::processNeighborConnection(int atomIndex, int neighbor, int neighborIndex, Cluster* cluster1, int structureType){
+void ClusterConnector::processNeighborConnection(AtomIndex atomIndex, AtomIndex neighbor, int neighborIndex, Cluster* cluster1, int structureType){
     if (neighbor < 0 || static_cast<size_t>(neighbor) >= _context.atomCount()) return; 
 
     int neighborClusterId = _context.atomClusters->getInt(neighbor);
@@ -384,21 +384,21 @@ void ClusterConnector::buildClustersForPTM(){
         cluster->symmetryTransformation = 0; 
         _context.atomSymmetryPermutations->setInt(seedAtomIndex, 0);
 
-        std::deque<int> atomsToVisit{ int(seedAtomIndex) };
+        std::deque<AtomIndex> atomsToVisit{ AtomIndex(seedAtomIndex) };
         growClusterPTM(cluster, atomsToVisit, structureType);
     }
 
     reorientAtomsToAlignClusters();
 }
 
-void ClusterConnector::growClusterPTM(Cluster* cluster, std::deque<int>& atomsToVisit, int structureType){
+void ClusterConnector::growClusterPTM(Cluster* cluster, std::deque<AtomIndex>& atomsToVisit, int structureType){
     while(!atomsToVisit.empty()){
-        int currentAtom = atomsToVisit.front();
+        AtomIndex currentAtom = atomsToVisit.front();
         atomsToVisit.pop_front();
 
         int numNeighbors = _sa.numberOfNeighbors(currentAtom);
         for(int ni = 0; ni < numNeighbors; ++ni){
-            int neighbor = _sa.getNeighbor(currentAtom, ni);
+            AtomIndex neighbor = _sa.getNeighbor(currentAtom, ni);
             if(neighbor < 0 || neighbor == currentAtom) continue;
             if(_context.atomClusters->getInt(neighbor) != 0) continue;
             if(_context.structureTypes->getInt(neighbor) != structureType) continue;
@@ -429,7 +429,7 @@ void ClusterConnector::baseBuildClusters(){
 
         Matrix_3<double> orientationV = Matrix_3<double>::Zero();
         Matrix_3<double> orientationW = Matrix_3<double>::Zero();
-        std::deque<int> atomsToVisit(1, seedAtomIndex);
+        std::deque<AtomIndex> atomsToVisit(1, AtomIndex(seedAtomIndex));
 
         growCluster(cluster, atomsToVisit, orientationV, orientationW, structureType);
         cluster->orientation = Matrix3(orientationW * orientationV.inverse());
@@ -444,7 +444,7 @@ void ClusterConnector::baseBuildClusters(){
 
 void ClusterConnector::growCluster(
     Cluster* cluster,
-    std::deque<int>& atomsToVisit,
+    std::deque<AtomIndex>& atomsToVisit,
     Matrix_3<double>& orientationV,
     Matrix_3<double>& orientationW,
     int structureType
@@ -453,14 +453,14 @@ void ClusterConnector::growCluster(
     const LatticeStructure& latticeStructure = CoordinationStructures::getLatticeStruct(structureType);
 
     while(!atomsToVisit.empty()){
-        int currentAtomIndex = atomsToVisit.front();
+        AtomIndex currentAtomIndex = atomsToVisit.front();
         atomsToVisit.pop_front();
 
         int symmetryPermutationIndex = _context.atomSymmetryPermutations->getInt(static_cast<size_t>(currentAtomIndex));
         const auto& permutation = latticeStructure.permutations[symmetryPermutationIndex].permutation;
 
         for(int neighborIndex = 0; neighborIndex < coordStructure.numNeighbors; neighborIndex++){
-            int neighborAtomIndex = _sa.getNeighbor(currentAtomIndex, neighborIndex);
+            AtomIndex neighborAtomIndex = _sa.getNeighbor(currentAtomIndex, neighborIndex);
             //assert(neighborAtomIndex != currentAtomIndex);
 
             const Vector3& latticeVector = latticeStructure.latticeVectors[permutation[neighborIndex]];
@@ -482,7 +482,7 @@ void ClusterConnector::growCluster(
             bool properOverlap = true;
 
             for(int i = 0; i < 3; i++){
-                int atomIndex;
+                AtomIndex atomIndex;
                 if(i != 2){
                     atomIndex = _sa.getNeighbor(currentAtomIndex, coordStructure.commonNeighbors[neighborIndex][i]);
                     tm1.column(i) = latticeStructure.latticeVectors[permutation[coordStructure.commonNeighbors[neighborIndex][i]]] -
@@ -578,7 +578,7 @@ void ClusterConnector::reorientAtomsToAlignClusters(){
     );
 }
 
-bool ClusterConnector::alreadyProcessedAtom(int index){
+bool ClusterConnector::alreadyProcessedAtom(AtomIndex index){
     return _context.atomClusters->getInt(index) != 0 || _context.structureTypes->getInt(index) == StructureType::OTHER;
 }
 
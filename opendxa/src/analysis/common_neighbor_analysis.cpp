@@ -17,16 +17,45 @@ int CommonNeighborAnalysis::findCommonNeighbors(
 	return __builtin_popcount(commonNeighbors);
 }
 
-// Find a permutation of neighbor that matches a reference coordination structure.
-// Given a candidate ordering of neighbor indices (neighborMapping), this routine
-// attempts to reorder them so that each neighbor's CNA signature and mutual bond 
-// topology matches exactly the expected pattern in coordinationStructures[coordinationType].
-// It iterates though mismatches, incrementally swapping neighbors (using next_permutation)
-// until a perfect match is found or all permutations are exhausted.
+// Labels every neighbor with a class that any neighbor matched to it in the
+// reference structure must share: its own CNA signature plus the number of
+// bonded neighbors in the shell with each signature. Class keys pack the
+// signature into the low 8 bits and one 5-bit count per signature value above.
+void CommonNeighborAnalysis::computeNeighborClasses(
+    const NeighborBondArray& neighborArray,
+    const int* cnaSignatures,
+    int coordinationNumber,
+    std::uint64_t* neighborClasses
+){
+    for(int ni1 = 0; ni1 < coordinationNumber; ni1++){
+        std::uint64_t key = static_cast<std::uint64_t>(cnaSignatures[ni1]);
+        unsigned int bonded = neighborArray.neighborArray[ni1];
+        while(bonded){
+            const int ni2 = __builtin_ctz(bonded);
+            bonded &= bonded - 1;
+            if(ni2 >= coordinationNumber) break;
+            key += std::uint64_t(1) << (8 + 5 * cnaSignatures[ni2]);
+        }
+        neighborClasses[ni1] = key;
+    }
+}
+
+// Find a permutation of neighbors that matches a reference coordination structure.
+// On return neighborMapping[i] is the neighbor matched to reference neighbor i,
+// such that every neighbor has the CNA signature of its reference neighbor and
+// every pair is bonded exactly when the reference pair is.
+//
+// The neighbors are first sorted into classes (see computeNeighborClasses()),
+// and the class sizes must agree with the reference table built by
+// CoordinationStructures::initializeStructures(). The reference positions are
+// then filled in order by a depth-first search that only tries neighbors of the
+// matching class whose bonds to the positions filled so far agree, all tested
+// at once on bitmasks. Candidates are tried in ascending order, so the result is
+// the lexicographically first matching permutation, the one a search through
+// all permutations in next_permutation order would return.
 bool CommonNeighborAnalysis::findMatchingNeighborPermutation(
     CoordinationStructureType coordinationType,
     int* neighborMapping,
-    int* previousMapping,
     int coordinationNumber,
     const int* cnaSignatures,
     const NeighborBondArray& neighborArray,
@@ -34,47 +63,48 @@ bool CommonNeighborAnalysis::findMatchingNeighborPermutation(
 ){
     const CoordinationStructure& coordStructure = coordinationStructures[coordinationType];
 
-    for(;;){
-        int ni1 = 0;
-
-        // Skip over positions that haven't changed since last time
-        while(neighborMapping[ni1] == previousMapping[ni1]){
-            ni1++;
-            assert(ni1 < coordinationNumber);
-        }
-
-        // Attempt to advance the permutation at index ni1
-        for(; ni1 < coordinationNumber; ni1++){
-            int atomNeighborIndex1 = neighborMapping[ni1];
-            previousMapping[ni1] = atomNeighborIndex1;
-
-            // Check CNA signature match
-            if(cnaSignatures[atomNeighborIndex1] != coordStructure.cnaSignatures[ni1]){
-                break;
-            }
+    std::uint64_t neighborClasses[MAX_NEIGHBORS];
+    computeNeighborClasses(neighborArray, cnaSignatures, coordinationNumber, neighborClasses);
 
-            // Check that bond connectivity matches
-            int ni2;
-            for(ni2 = 0; ni2 < ni1; ni2++){
-                int atomNeighborIndex2 = neighborMapping[ni2];
-                if(neighborArray.neighborBond(atomNeighborIndex1, atomNeighborIndex2) !=
-                   coordStructure.neighborArray.neighborBond(ni1, ni2)){
-                    break;
-                }
+    // Neighbors that may fill each reference position
+    unsigned int classMembers[MAX_NEIGHBORS];
+    for(int ni = 0; ni < coordinationNumber; ni++){
+        unsigned int members = 0;
+        for(int n = 0; n < coordinationNumber; n++){
+            if(neighborClasses[n] == coordStructure.neighborClasses[ni]){
+                members |= 1u << n;
             }
+        }
+        if(__builtin_popcount(members) != coordStructure.neighborClassSizes[ni]) return false;
+        classMembers[ni] = members;
+    }
 
-            if(ni2 != ni1) break;
+    // candidates[ni] holds the neighbors not yet tried at position ni.
+    unsigned int candidates[MAX_NEIGHBORS];
+    unsigned int used = 0;
+    int ni = 0;
+    candidates[0] = classMembers[0];
+    for(;;){
+        if(!candidates[ni]){
+            // Backtrack
+            if(ni == 0) return false;
+            ni--;
+            used &= ~(1u << neighborMapping[ni]);
+            continue;
         }
 
-        // If all positions matched, we succeeded
-        if(ni1 == coordinationNumber) return true;
+        const int n = __builtin_ctz(candidates[ni]);
+        candidates[ni] &= candidates[ni] - 1;
+        neighborMapping[ni] = n;
+        used |= 1u << n;
+        if(++ni == coordinationNumber) return true;
 
-        // Otherwise generate the next permutation and retry
-        bitmapSort(neighborMapping + ni1 + 1, neighborMapping + coordinationNumber, coordinationNumber);
-        if(!std::next_permutation(neighborMapping, neighborMapping + coordinationNumber)){
-            assert(false);
-            return false;
+        unsigned int next = classMembers[ni] & ~used;
+        for(int nj = 0; nj < ni; nj++){
+            const unsigned int bonded = neighborArray.neighborArray[neighborMapping[nj]];
+            next &= coordStructure.neighborArray.neighborBond(ni, nj) ? bonded : ~bonded;
         }
+        candidates[ni] = next;
     }
 }
 
@@ -82,130 +112,152 @@ bool CommonNeighborAnalysis::findMatchingNeighborPermutation(
 // Examines each neighbor's common-neighbor count and bond topology, builds 
 // sinagure counters, and returns the matched CoordinationStructureType.
 // If no known pattern matches, returns COORD_OTHER.
+// The input lattice is a template parameter, so every loop below runs over a
+// compile-time number of neighbors.
+template<LatticeStructureType Lattice>
 CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType(
     const NeighborBondArray& neighborArray,
-    int coordinationNumber,
     int* cnaSignatures,
-    LatticeStructureType inputCrystalType,
     bool identifyPlanarDefects
 ) {
-    CoordinationStructureType coordinationType = COORD_OTHER;
+    if constexpr(Lattice == LATTICE_FCC || Lattice == LATTICE_HCP){
+        constexpr int coordinationNumber = 12;
 
-    switch(inputCrystalType){
-        case LATTICE_FCC:
-        case LATTICE_HCP: {
-            // Count 4-2-1 vs 4-2-2 signatures among the 12 neighbors to distinguish FCC vs HCP
-            int n421 = 0;
-            int n422 = 0;
-            for(int neighborIndex = 0; neighborIndex < coordinationNumber; neighborIndex++){
-                unsigned int commonNeighbors;
-                int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
-                if(numCommonNeighbors != 4) break;
-
-                CNAPairBond neighborBonds[MAX_NEIGHBORS * MAX_NEIGHBORS];
-                int numNeighborBonds = findNeighborBonds(neighborArray, commonNeighbors, coordinationNumber, neighborBonds);
-                if(numNeighborBonds != 2) break;
-
-                int maxChainLength = calcMaxChainLength(neighborBonds, numNeighborBonds);
-
-                if(maxChainLength == 1){
-                    n421++;
-                    cnaSignatures[neighborIndex] = 0;
-                }else if(maxChainLength == 2){
-                    n422++;
-                    cnaSignatures[neighborIndex] = 1;
-                }else{
-                    break;
-                }
-            }
+        // Count 4-2-1 vs 4-2-2 signatures among the 12 neighbors to distinguish FCC vs HCP
+        int n421 = 0;
+        int n422 = 0;
+        for(int neighborIndex = 0; neighborIndex < coordinationNumber; neighborIndex++){
+            unsigned int commonNeighbors;
+            int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
+            if(numCommonNeighbors != 4) break;
 
-            if(n421 == 12 && (identifyPlanarDefects || inputCrystalType == LATTICE_FCC)){
-                coordinationType = COORD_FCC;
-            }else if(n421 == 6 && n422 == 6 && (identifyPlanarDefects || inputCrystalType == LATTICE_HCP)){
-                coordinationType = COORD_HCP;
-            }
-            break;
-        }
+            CNAPairBond neighborBonds[MAX_NEIGHBORS * MAX_NEIGHBORS];
+            int numNeighborBonds = findNeighborBonds(neighborArray, commonNeighbors, coordinationNumber, neighborBonds);
+            if(numNeighborBonds != 2) break;
 
-        case LATTICE_BCC: {
-            // Count 4-4-4 vs 6-6-6 signatures among up to 14 neighbors for BCC
-            int n444 = 0;
-            int n666 = 0;
-            for(int neighborIndex = 0; neighborIndex < coordinationNumber; neighborIndex++){
-                unsigned int commonNeighbors;
-                int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, 14);
-                if(numCommonNeighbors != 4 && numCommonNeighbors != 6) break;
-
-                CNAPairBond neighborBonds[MAX_NEIGHBORS * MAX_NEIGHBORS];
-                int numNeighborBonds = findNeighborBonds(neighborArray, commonNeighbors, 14, neighborBonds);
-                if(numNeighborBonds != 4 && numNeighborBonds != 6) break;
-
-                int maxChainLength = calcMaxChainLength(neighborBonds, numNeighborBonds);
-
-                if(numCommonNeighbors == 4 && numNeighborBonds == 4 && maxChainLength == 4){
-                    n444++;
-                    cnaSignatures[neighborIndex] = 1;
-                }else if(numCommonNeighbors == 6 && numNeighborBonds == 6 && maxChainLength == 6){
-                    n666++;
-                    cnaSignatures[neighborIndex] = 0;
-                }else{
-                    break;
-                }
-            }
+            int maxChainLength = calcMaxChainLength(neighborBonds, numNeighborBonds);
 
-            if(n666 == 8 && n444 == 6){
-                coordinationType = COORD_BCC;
+            if(maxChainLength == 1){
+                n421++;
+                cnaSignatures[neighborIndex] = 0;
+            }else if(maxChainLength == 2){
+                n422++;
+                cnaSignatures[neighborIndex] = 1;
+            }else{
+                break;
             }
-            break;
         }
 
-        case LATTICE_CUBIC_DIAMOND:
-        case LATTICE_HEX_DIAMOND: {
-            // Check first four for 3-coordination, then next twelve for 5-4-3 vs 5-4-4 patterns
-            for(int neighborIndex = 0; neighborIndex < 4; neighborIndex++){
+        if(n421 == 12 && (identifyPlanarDefects || Lattice == LATTICE_FCC)){
+            return COORD_FCC;
+        }else if(n421 == 6 && n422 == 6 && (identifyPlanarDefects || Lattice == LATTICE_HCP)){
+            return COORD_HCP;
+        }
+        return COORD_OTHER;
+    }else if constexpr(Lattice == LATTICE_BCC){
+        constexpr int coordinationNumber = 14;
+
+        // Count 4-4-4 vs 6-6-6 signatures among up to 14 neighbors for BCC
+        int n444 = 0;
+        int n666 = 0;
+        for(int neighborIndex = 0; neighborIndex < coordinationNumber; neighborIndex++){
+            unsigned int commonNeighbors;
+            int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
+            if(numCommonNeighbors != 4 && numCommonNeighbors != 6) break;
+
+            CNAPairBond neighborBonds[MAX_NEIGHBORS * MAX_NEIGHBORS];
+            int numNeighborBonds = findNeighborBonds(neighborArray, commonNeighbors, coordinationNumber, neighborBonds);
+            if(numNeighborBonds != 4 && numNeighborBonds != 6) break;
+
+            int maxChainLength = calcMaxChainLength(neighborBonds, numNeighborBonds);
+
+            if(numCommonNeighbors == 4 && numNeighborBonds == 4 && maxChainLength == 4){
+                n444++;
+                cnaSignatures[neighborIndex] = 1;
+            }else if(numCommonNeighbors == 6 && numNeighborBonds == 6 && maxChainLength == 6){
+                n666++;
                 cnaSignatures[neighborIndex] = 0;
-                unsigned int commonNeighbors;
-                int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
-                if(numCommonNeighbors != 3) return COORD_OTHER;
+            }else{
+                break;
             }
+        }
 
-            int n543 = 0;
-            int n544 = 0;
-            for(int neighborIndex = 4; neighborIndex < coordinationNumber; neighborIndex++){
-                unsigned int commonNeighbors;
-                int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
-                if(numCommonNeighbors != 5) break;
-
-                CNAPairBond neighborBonds[MAX_NEIGHBORS * MAX_NEIGHBORS];
-                int numNeighborBonds = findNeighborBonds(neighborArray, commonNeighbors, coordinationNumber, neighborBonds);
-                if(numNeighborBonds != 4) break;
-
-                int maxChainLength = calcMaxChainLength(neighborBonds, numNeighborBonds);
-
-                if(maxChainLength == 3){
-                    n543++;
-                    cnaSignatures[neighborIndex] = 1;
-                }else if(maxChainLength == 4){
-                    n544++;
-                    cnaSignatures[neighborIndex] = 2;
-                }else{
-                    break;
-                }
-            }
+        if(n666 == 8 && n444 == 6){
+            return COORD_BCC;
+        }
+        return COORD_OTHER;
+    }else if constexpr(Lattice == LATTICE_CUBIC_DIAMOND || Lattice == LATTICE_HEX_DIAMOND){
+        constexpr int coordinationNumber = 16;
+
+        // Check first four for 3-coordination, then next twelve for 5-4-3 vs 5-4-4 patterns
+        for(int neighborIndex = 0; neighborIndex < 4; neighborIndex++){
+            cnaSignatures[neighborIndex] = 0;
+            unsigned int commonNeighbors;
+            int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
+            if(numCommonNeighbors != 3) return COORD_OTHER;
+        }
 
-            if(n543 == 12 && (identifyPlanarDefects || inputCrystalType == LATTICE_CUBIC_DIAMOND)){
-                coordinationType = COORD_CUBIC_DIAMOND;
-            }else if(n543 == 6 && n544 == 6 && (identifyPlanarDefects || inputCrystalType == LATTICE_HEX_DIAMOND)){
-                coordinationType = COORD_HEX_DIAMOND;
+        int n543 = 0;
+        int n544 = 0;
+        for(int neighborIndex = 4; neighborIndex < coordinationNumber; neighborIndex++){
+            unsigned int commonNeighbors;
+            int numCommonNeighbors = findCommonNeighbors(neighborArray, neighborIndex, commonNeighbors, coordinationNumber);
+            if(numCommonNeighbors != 5) break;
+
+            CNAPairBond neighborBonds[MAX_NEIGHBORS * MAX_NEIGHBORS];
+            int numNeighborBonds = findNeighborBonds(neighborArray, commonNeighbors, coordinationNumber, neighborBonds);
+            if(numNeighborBonds != 4) break;
+
+            int maxChainLength = calcMaxChainLength(neighborBonds, numNeighborBonds);
+
+            if(maxChainLength == 3){
+                n543++;
+                cnaSignatures[neighborIndex] = 1;
+            }else if(maxChainLength == 4){
+                n544++;
+                cnaSignatures[neighborIndex] = 2;
+            }else{
+                break;
             }
-            break;
         }
 
-        default:
-            break;
+        if(n543 == 12 && (identifyPlanarDefects || Lattice == LATTICE_CUBIC_DIAMOND)){
+            return COORD_CUBIC_DIAMOND;
+        }else if(n543 == 6 && n544 == 6 && (identifyPlanarDefects || Lattice == LATTICE_HEX_DIAMOND)){
+            return COORD_HEX_DIAMOND;
+        }
+        return COORD_OTHER;
+    }else{
+        return COORD_OTHER;
     }
+}
+
+template CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType<LATTICE_FCC>(const NeighborBondArray&, int*, bool);
+template CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType<LATTICE_HCP>(const NeighborBondArray&, int*, bool);
+template CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType<LATTICE_BCC>(const NeighborBondArray&, int*, bool);
+template CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType<LATTICE_CUBIC_DIAMOND>(const NeighborBondArray&, int*, bool);
+template CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType<LATTICE_HEX_DIAMOND>(const NeighborBondArray&, int*, bool);
 
-    return coordinationType;
+CoordinationStructureType CommonNeighborAnalysis::computeCoordinationType(
+    const NeighborBondArray& neighborArray,
+    int* cnaSignatures,
+    LatticeStructureType inputCrystalType,
+    bool identifyPlanarDefects
+) {
+    switch(inputCrystalType){
+        case LATTICE_FCC:
+            return computeCoordinationType<LATTICE_FCC>(neighborArray, cnaSignatures, identifyPlanarDefects);
+        case LATTICE_HCP:
+            return computeCoordinationType<LATTICE_HCP>(neighborArray, cnaSignatures, identifyPlanarDefects);
+        case LATTICE_BCC:
+            return computeCoordinationType<LATTICE_BCC>(neighborArray, cnaSignatures, identifyPlanarDefects);
+        case LATTICE_CUBIC_DIAMOND:
+            return computeCoordinationType<LATTICE_CUBIC_DIAMOND>(neighborArray, cnaSignatures, identifyPlanarDefects);
+        case LATTICE_HEX_DIAMOND:
+            return computeCoordinationType<LATTICE_HEX_DIAMOND>(neighborArray, cnaSignatures, identifyPlanarDefects);
+        default:
+            return COORD_OTHER;
+    }
 }
 
 // Extract all bonds between the common neighbor of one atom.
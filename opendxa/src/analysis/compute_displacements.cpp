@@ -56,11 +56,11 @@ void ComputeDisplacements::buildParticleMapping(
         }
 
         // Map ID -> index (reference)
-        std::unordered_map<int, std::size_t> refMap;
+        std::unordered_map<AtomId, std::size_t> refMap;
         refMap.reserve(nRef * 2);
 
         for(std::size_t i = 0; i < nRef; i++){
-            const int id = _refIdentifiers->getInt(i);
+            const AtomId id = _refIdentifiers->getInt64(i);
             auto [it, inserted] = refMap.emplace(id, i);
             if(!inserted){
                 throw std::runtime_error("ComputeDisplacements: duplicate particle identifier in reference configuration.");
@@ -68,11 +68,11 @@ void ComputeDisplacements::buildParticleMapping(
         }
 
         // Check duplicates in current + build currentMap
-        std::unordered_map<int, std::size_t> currMap;
+        std::unordered_map<AtomId, std::size_t> currMap;
         currMap.reserve(nCurr * 2);
 
         for(std::size_t i = 0; i < nCurr; i++){
-            const int id = _identifiers->getInt(i);
+            const AtomId id = _identifiers->getInt64(i);
             auto [it, inserted] = currMap.emplace(id, i);
             if(!inserted) {
                 throw std::runtime_error("ComputeDisplacements: duplicate particle identifier in current configuration.");
@@ -81,7 +81,7 @@ void ComputeDisplacements::buildParticleMapping(
 
         // Build current -> ref
         for(std::size_t i = 0; i < nCurr; i++){
-            const int id = _identifiers->getInt(i);
+            const AtomId id = _identifiers->getInt64(i);
             auto it = refMap.find(id);
             if(it != refMap.end()){
                 currentToRefIndexMap[i] = it->second;
@@ -94,7 +94,7 @@ void ComputeDisplacements::buildParticleMapping(
 
         // Build ref -> current
         for(std::size_t i = 0; i < nRef; i++){
-            const int id = _refIdentifiers->getInt(i);
+            const AtomId id = _refIdentifiers->getInt64(i);
             auto it = currMap.find(id);
             if(it != currMap.end()){
                 refToCurrentIndexMap[i] = it->second;
@@ -4,12 +4,24 @@ namespace OpenDXA{
 
 // Performs the actual computation. 
 void CoordinationNumber::CoordinationAnalysisEngine::perform(){
+    if(_neighborList){
+        computeCoordination(*_neighborList);
+        return;
+    }
+
     // Prepare the neighbor list
     CutoffNeighborFinder neighborListBuilder;
+    neighborListBuilder.setPrecision(_precision);
     if(!neighborListBuilder.prepare(_cutoff, positions(), cell())){
         return;
     }
+    computeCoordination(neighborListBuilder);
+}
 
+// Counts the neighbors of every particle and accumulates the RDF histogram.
+// Works with any neighbor list that provides a CutoffNeighborFinder-style Query.
+template <typename NeighborList>
+void CoordinationNumber::CoordinationAnalysisEngine::computeCoordination(const NeighborList& neighborListBuilder){
     size_t particleCount = positions()->size();
 
     // Perform analysis on each particle in parallel
@@ -30,7 +42,7 @@ void CoordinationNumber::CoordinationAnalysisEngine::perform(){
             std::vector<size_t> threadLocalRDF(_rdfHistogram.size(), 0);
             for(size_t i = startIndex; i < endIndex;){
                 int coordNumber = 0;
-                for(CutoffNeighborFinder::Query neighQuery(neighborListBuilder, i); !neighQuery.atEnd(); neighQuery.next()){
+                for(typename NeighborList::Query neighQuery(neighborListBuilder, i); !neighQuery.atEnd(); neighQuery.next()){
                     coordNumber++;
                     size_t rdfInterval = (size_t)(sqrt(neighQuery.distanceSquared()) / rdfBinSize);
                     threadLocalRDF[rdfInterval]++;
@@ -6,7 +6,7 @@ namespace OpenDXA{
 // Finds an atom-to-atom path from atom 1 to atom 2 that lies entirely in the good
 // crystal region. Returns true if a path could be found and stores the corresponding ideal
 // vector and the cluster transition in the provided pass-by-reference variables.
-std::optional<ClusterVector> CrystalPathFinder::findPath(int atomIndex1, int atomIndex2){
+std::optional<ClusterVector> CrystalPathFinder::findPath(AtomIndex atomIndex1, AtomIndex atomIndex2){
     assert(atomIndex1 != atomIndex2);
 
     auto* cluster1 = structureAnalysis().atomCluster(atomIndex1);
@@ -42,7 +42,7 @@ std::optional<ClusterVector> CrystalPathFinder::findPath(int atomIndex1, int ato
     std::optional<ClusterVector> result;
 
     for(PathNode* cur = &start; cur && !result; cur = cur->nextToProcess){
-        int a = cur->atomIndex;
+        AtomIndex a = cur->atomIndex;
         assert(a != atomIndex2);
         assert(_visitedAtoms.test(a));
 
@@ -50,7 +50,7 @@ std::optional<ClusterVector> CrystalPathFinder::findPath(int atomIndex1, int ato
         int nbors = structureAnalysis().numberOfNeighbors(a);
 
         for(int i = 0; i < nbors; ++i){
-            int nb = structureAnalysis().getNeighbor(a, i);
+            AtomIndex nb = structureAnalysis().getNeighbor(a, i);
             if(_visitedAtoms.test(nb)){
                 continue;
 			}
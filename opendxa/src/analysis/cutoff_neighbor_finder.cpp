@@ -1,4 +1,9 @@
 #include <opendxa/analysis/cutoff_neighbor_finder.h>
+#include <opendxa/analysis/distance_kernels.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <atomic>
 
 namespace OpenDXA{
 
@@ -15,7 +20,10 @@ bool CutoffNeighborFinder::prepare(double cutoffRadius, ParticleProperty* positi
         throw std::runtime_error("Invalid input data: Simulation cell is degenerate.");
     }
 
-    AffineTransformation binCell;
+    if(positions->size() > MaxAtomCount){
+        throw std::runtime_error("Invalid input data: Too many particles for the atom index type of this build.");
+    }
+
     binCell.translation() = simCell.matrix().translation();
     std::array<Vector3, 3> planeNormals;
 
@@ -49,7 +57,7 @@ bool CutoffNeighborFinder::prepare(double cutoffRadius, ParticleProperty* positi
     reciprocalBinCell = binCell.inverse();
 
     // This helper functions computes the shortest distance between a point and a bin cell located at the origin
-	auto shortestCellCellDistance = [binCell, planeNormals](const Vector3I& d) {
+	auto shortestCellCellDistance = [this, planeNormals](const Vector3I& d) {
         Vector3 p = binCell * Vector3(d);
         // Compute distance from point to corner
         double distSq = p.squaredLength();
@@ -80,6 +88,7 @@ bool CutoffNeighborFinder::prepare(double cutoffRadius, ParticleProperty* positi
         return distSq;
     };
 
+    stencil.clear();
     for(int stencilRadius = 0; stencilRadius < 100; stencilRadius++){
         size_t oldCount = stencil.size();
         for(int ix = -stencilRadius; ix <= stencilRadius; ix++){
@@ -109,60 +118,138 @@ bool CutoffNeighborFinder::prepare(double cutoffRadius, ParticleProperty* positi
         if(stencil.size() == oldCount) break;
     }
 
-    // An 3d array of cubic bins.
-    // Each bin is a linked list of particles
-    bins.resize(binCount, nullptr);
-
-    // Sort particles into bins
-    particles.resize(positions->size());
-    const Point3* p = positions->constDataPoint3();
-    for(size_t pindex = 0; pindex < particles.size(); pindex++, ++p){
-        NeighborListParticle& a = particles[pindex];
-        a.pos = *p;
-        a.pbcShift.setZero();
-
-        // Determine the bin the atom is located in
-        Point3 rp = reciprocalBinCell * (*p);
-        Point3I binLocation;
-        for(size_t k = 0; k < 3; k++){
-            binLocation[k] = (int)floor(rp[k]);
-            if(simCell.pbcFlags()[k]){
-                if(binLocation[k] < 0 || binLocation[k] >= binDim[k]){
-                    int shift;
-                    if(binLocation[k] < 0){
-                        shift = -(binLocation[k] + 1) / binDim[k] + 1;
-                    }else{
-                        shift = -binLocation[k] / binDim[k];
+    // Determine the bin and the periodic wrapping of each particle.
+    const size_t particleCount = positions->size();
+    _positions = positions->constDataPoint3();
+    pbcShifts.resize(particleCount);
+    std::vector<uint32_t> particleBins(particleCount);
+    const Point3* p = _positions;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, particleCount), [&](const tbb::blocked_range<size_t>& r){
+        for(size_t pindex = r.begin(); pindex < r.end(); pindex++){
+            Vector_3<int8_t>& pbcShift = pbcShifts[pindex];
+            pbcShift.setZero();
+
+            // Determine the bin the atom is located in
+            Point3 rp = reciprocalBinCell * p[pindex];
+            Point3I binLocation;
+            for(size_t k = 0; k < 3; k++){
+                binLocation[k] = (int)floor(rp[k]);
+                if(simCell.pbcFlags()[k]){
+                    if(binLocation[k] < 0 || binLocation[k] >= binDim[k]){
+                        int shift;
+                        if(binLocation[k] < 0){
+                            shift = -(binLocation[k] + 1) / binDim[k] + 1;
+                        }else{
+                            shift = -binLocation[k] / binDim[k];
+                        }
+                        pbcShift[k] = (int8_t)shift;
+                        binLocation[k] = SimulationCell::modulo(binLocation[k], binDim[k]);
                     }
-					a.pbcShift[k] = (int8_t)shift;
-					a.pos += (double)shift * simCell.matrix().column(k);
-					binLocation[k] = SimulationCell::modulo(binLocation[k], binDim[k]);
+                }else if(binLocation[k] < 0){
+                    binLocation[k] = 0;
+                }else if(binLocation[k] >= binDim[k]){
+                    binLocation[k] = binDim[k] - 1;
                 }
-            }else if(binLocation[k] < 0){
-                binLocation[k] = 0;
-            }else if(binLocation[k] >= binDim[k]){
-                binLocation[k] = binDim[k] - 1;
+                assert(binLocation[k] >= 0 && binLocation[k] < binDim[k]);
             }
-            assert(binLocation[k] >= 0 && binLocation[k] < binDim[k]);
+
+            particleBins[pindex] = (uint32_t)(binLocation[0] + binLocation[1] * binDim[0] + binLocation[2] * binDim[0] * binDim[1]);
+        }
+    });
+
+    // Counting sort of the particles by bin: histogram, prefix sum, scatter.
+    std::vector<std::atomic<size_t>> binCursor(binCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, particleCount), [&](const tbb::blocked_range<size_t>& r){
+        for(size_t pindex = r.begin(); pindex < r.end(); pindex++){
+            binCursor[particleBins[pindex]].fetch_add(1, std::memory_order_relaxed);
         }
+    });
 
-        // Put particle into its bin
-        size_t binIndex = binLocation[0] + binLocation[1] * binDim[0] + binLocation[2] * binDim[0] * binDim[1];
-        a.nextInBin = bins[binIndex];
-        bins[binIndex] = &a;
+    binStart.resize(binCount + 1);
+    binStart[0] = 0;
+    for(int bin = 0; bin < binCount; bin++){
+        binStart[bin + 1] = binStart[bin] + binCursor[bin].load(std::memory_order_relaxed);
+        binCursor[bin].store(binStart[bin], std::memory_order_relaxed);
     }
 
+    binParticles.resize(particleCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, particleCount), [&](const tbb::blocked_range<size_t>& r){
+        for(size_t pindex = r.begin(); pindex < r.end(); pindex++){
+            binParticles[binCursor[particleBins[pindex]].fetch_add(1, std::memory_order_relaxed)] = static_cast<AtomIndex>(pindex);
+        }
+    });
+
+    const bool single = _precision == SearchPrecision::Single;
+    if(single){
+        std::vector<double>().swap(binX);
+        std::vector<double>().swap(binY);
+        std::vector<double>().swap(binZ);
+        binXf.resize(particleCount);
+        binYf.resize(particleCount);
+        binZf.resize(particleCount);
+    }else{
+        std::vector<float>().swap(binXf);
+        std::vector<float>().swap(binYf);
+        std::vector<float>().swap(binZf);
+        binX.resize(particleCount);
+        binY.resize(particleCount);
+        binZ.resize(particleCount);
+    }
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, binCount), [&](const tbb::blocked_range<int>& r){
+        for(int bin = r.begin(); bin < r.end(); bin++){
+            // The scatter order within a bin depends on thread scheduling; sort each
+            // bin by particle index so neighbors are always visited in the same order.
+            std::sort(binParticles.begin() + binStart[bin], binParticles.begin() + binStart[bin + 1]);
+            const Point3 origin = binOrigin(bin);
+            for(size_t slot = binStart[bin]; slot < binStart[bin + 1]; slot++){
+                const Point3 pos = wrappedPosition(binParticles[slot]);
+                if(single){
+                    binXf[slot] = static_cast<float>(pos.x() - origin.x());
+                    binYf[slot] = static_cast<float>(pos.y() - origin.y());
+                    binZf[slot] = static_cast<float>(pos.z() - origin.z());
+                }else{
+                    binX[slot] = pos.x();
+                    binY[slot] = pos.y();
+                    binZ[slot] = pos.z();
+                }
+            }
+        }
+    });
+
     return true;
 }
 
+// Position of the given particle wrapped at the periodic boundaries. The cell
+// vectors are added in the same order for every caller, so a particle always
+// gets the same coordinates.
+Point3 CutoffNeighborFinder::wrappedPosition(size_t index) const{
+    Point3 pos = _positions[index];
+    const Vector_3<int8_t>& shift = pbcShifts[index];
+    for(size_t k = 0; k < 3; k++){
+        if(shift[k]) pos += (double)shift[k] * simCell.matrix().column(k);
+    }
+    return pos;
+}
+
+// Position of the lower corner of the given bin
+Point3 CutoffNeighborFinder::binOrigin(size_t bin) const{
+    const size_t bx = bin % binDim[0];
+    const size_t by = (bin / binDim[0]) % binDim[1];
+    const size_t bz = bin / ((size_t)binDim[0] * binDim[1]);
+    return binCell * Point3(bx, by, bz);
+}
+
 CutoffNeighborFinder::Query::Query(const CutoffNeighborFinder& finder, size_t particleIndex)
     : _builder(finder), _centerIndex(particleIndex){
-    assert(particleIndex < _builder.particles.size());
+    assert(particleIndex < _builder.pbcShifts.size());
     
 	_stencilIter = _builder.stencil.begin();
-	_neighbor = nullptr;
+	_binIter = _binEnd = 0;
+	_batchMask = 0;
+	_batchBase = 0;
 	_atEnd = false;
-	_center = _builder.particles[particleIndex].pos;
+	_center = _builder.wrappedPosition(particleIndex);
 	_neighborIndex = std::numeric_limits<size_t>::max();
 
     // Determine the bin the central particle is located in
@@ -180,14 +267,36 @@ void CutoffNeighborFinder::Query::next(){
     assert(!_atEnd);
     
     for(;;){
-        while(_neighbor){
-            _delta = _neighbor->pos - _shiftedCenter;
-			_neighborIndex = _neighbor - _builder.particles.data();
-			_neighbor = _neighbor->nextInBin;
+        while(_batchMask){
+            const size_t slot = _batchBase + DistanceKernels::lowestBit(_batchMask);
+            _batchMask &= _batchMask - 1;
+            if(_builder._precision == SearchPrecision::Single){
+                _delta = Point3(_builder.binXf[slot], _builder.binYf[slot], _builder.binZf[slot]) - _binCenter;
+            }else{
+                _delta = Point3(_builder.binX[slot], _builder.binY[slot], _builder.binZ[slot]) - _shiftedCenter;
+            }
+			_neighborIndex = _builder.binParticles[slot];
 			_distSq = _delta.squaredLength();
 			if(_distSq <= _builder._cutoffRadiusSquared && (_neighborIndex != _centerIndex || _pbcShift != Vector_3<int8_t>::Zero())) return;
         }
 
+        // Test the next batch of the current bin.
+        if(_binIter != _binEnd){
+            const size_t count = std::min(DistanceKernels::MaxBatch, _binEnd - _binIter);
+            if(_builder._precision == SearchPrecision::Single){
+                _batchMask = DistanceKernels::withinMask(
+                    _builder.binXf.data() + _binIter, _builder.binYf.data() + _binIter, _builder.binZf.data() + _binIter,
+                    count, _binCenter, _builder._cutoffRadiusSquared);
+            }else{
+                _batchMask = DistanceKernels::withinMask(
+                    _builder.binX.data() + _binIter, _builder.binY.data() + _binIter, _builder.binZ.data() + _binIter,
+                    count, _shiftedCenter, _builder._cutoffRadiusSquared);
+            }
+            _batchBase = _binIter;
+            _binIter += count;
+            continue;
+        }
+
         for(;;){
             if(_stencilIter == _builder.stencil.end()){
                 _atEnd = true;
@@ -230,7 +339,16 @@ void CutoffNeighborFinder::Query::next(){
 
             ++_stencilIter;
             if(!skipBin){
-				_neighbor = _builder.bins[_currentBin[0] + _currentBin[1] * _builder.binDim[0] + _currentBin[2] * _builder.binDim[0] * _builder.binDim[1]];
+				size_t bin = _currentBin[0] + _currentBin[1] * _builder.binDim[0] + _currentBin[2] * _builder.binDim[0] * _builder.binDim[1];
+				_binIter = _builder.binStart[bin];
+				_binEnd = _builder.binStart[bin + 1];
+				if(_builder._precision == SearchPrecision::Single){
+					const Point3 origin = _builder.binOrigin(bin);
+					_binCenter = Point3(
+						static_cast<float>(_shiftedCenter.x() - origin.x()),
+						static_cast<float>(_shiftedCenter.y() - origin.y()),
+						static_cast<float>(_shiftedCenter.z() - origin.z()));
+				}
                 break;
             }
         }
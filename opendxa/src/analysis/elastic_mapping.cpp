@@ -29,7 +29,7 @@ static constexpr std::array<std::pair<int, int>, 6> tetraEdgeVertices{{
 // (edges arriving), so that we can later traverse all edges adjacent to any given vertex.
 void ElasticMapping::generateTessellationEdges(){
     struct TempEdge {
-        int v1, v2;
+        AtomIndex v1, v2;
         bool operator<(const TempEdge& other) const {
             if(v1 != other.v1) return v1 < other.v1;
             return v2 < other.v2;
@@ -48,8 +48,8 @@ void ElasticMapping::generateTessellationEdges(){
             if(tessellation().isGhostCell(cellIdx)) continue;
 
             for(auto [vi, vj] : tetraEdgeVertices){
-                int v1 = tessellation().vertexIndex(tessellation().cellVertex(cellIdx, vi));
-                int v2 = tessellation().vertexIndex(tessellation().cellVertex(cellIdx, vj));
+                AtomIndex v1 = tessellation().vertexIndex(tessellation().cellVertex(cellIdx, vi));
+                AtomIndex v2 = tessellation().vertexIndex(tessellation().cellVertex(cellIdx, vj));
 
                 if(v1 == v2) continue;
 
@@ -58,8 +58,8 @@ void ElasticMapping::generateTessellationEdges(){
 
                 if(simCell.isWrappedVector(p1 - p2)) continue;
 
-                int minV = std::min(v1, v2);
-                int maxV = std::max(v1, v2);
+                AtomIndex minV = std::min(v1, v2);
+                AtomIndex maxV = std::max(v1, v2);
                 potentialEdges.push_back({minV, maxV});
             }
         }
@@ -81,7 +81,7 @@ void ElasticMapping::generateTessellationEdges(){
         }
     }
 
-    _edgeCount = static_cast<int>(uniqueEdges.size());
+    _edgeCount = uniqueEdges.size();
     for(const auto& te : uniqueEdges){
         TessellationEdge* e = _edgePool.construct(te.v1, te.v2);
         
@@ -109,7 +109,7 @@ void ElasticMapping::assignVerticesToClusters(){
     // Initial assignment (can be parallel since each vertex is independent)
     #pragma omp parallel for schedule(static) 
     for(size_t i = 0; i < vertex_count; ++i){
-        _vertexClusters[i] = structureAnalysis().atomCluster(int(i));
+        _vertexClusters[i] = structureAnalysis().atomCluster(AtomIndex(i));
     }
 
     // Propagate cluster assignments sequentially for determinism
@@ -201,8 +201,8 @@ bool ElasticMapping::isElasticMappingCompatible(DelaunayTessellation::CellHandle
     std::array<std::pair<Vector3, ClusterTransition*>, 6> edgeVecs;
     for(int i = 0; i < 6; ++i){
         auto [vi, vj] = tetraEdgeVertices[i];
-        int v1 = tessellation().vertexIndex(tessellation().cellVertex(cell, vi));
-        int v2 = tessellation().vertexIndex(tessellation().cellVertex(cell, vj));
+        AtomIndex v1 = tessellation().vertexIndex(tessellation().cellVertex(cell, vi));
+        AtomIndex v2 = tessellation().vertexIndex(tessellation().cellVertex(cell, vj));
         auto* te = findEdge(v1, v2);
 
         // Every edge must exist and have a stored vector
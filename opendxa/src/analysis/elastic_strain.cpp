@@ -76,7 +76,7 @@ void ElasticStrainEngine::perform(){
     for(long idx = 0; idx < static_cast<long>(N); ++idx){
         std::size_t particleIndex = static_cast<std::size_t>(idx);
 
-        Cluster* localCluster = _structureAnalysis.atomCluster(static_cast<int>(particleIndex));
+        Cluster* localCluster = _structureAnalysis.atomCluster(static_cast<AtomIndex>(particleIndex));
         if(!localCluster || localCluster->id == 0){
             _volumetricStrains->setDouble(particleIndex, 0.0);
             if(_strainTensors){
@@ -127,12 +127,12 @@ void ElasticStrainEngine::perform(){
         Matrix_3<double> orientationV = Matrix_3<double>::Zero();
         Matrix_3<double> orientationW = Matrix_3<double>::Zero();
 
-        int numneighs = _structureAnalysis.numberOfNeighbors(static_cast<int>(particleIndex));
+        int numneighs = _structureAnalysis.numberOfNeighbors(static_cast<AtomIndex>(particleIndex));
         for(int n = 0; n < numneighs; ++n){
-            int neighborAtomIndex = _structureAnalysis.getNeighbor(static_cast<int>(particleIndex), n);
+            AtomIndex neighborAtomIndex = _structureAnalysis.getNeighbor(static_cast<AtomIndex>(particleIndex), n);
 
             Vector3 latticeVector =
-                idealUnitCellTM * _structureAnalysis.neighborLatticeVector(static_cast<int>(particleIndex), n);
+                idealUnitCellTM * _structureAnalysis.neighborLatticeVector(static_cast<AtomIndex>(particleIndex), n);
 
             const Vector3& spatialVector =
                 _context.simCell.wrapVector(
@@ -1,22 +1,45 @@
 #include <opendxa/analysis/nearest_neighbor_finder.h>
+#include <opendxa/analysis/distance_kernels.h>
 #include <opendxa/core/particle_property.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <algorithm>
+#include <cmath>
 
 namespace OpenDXA{
 
-// Returns the stored 3D position of the atom at the given index.
-// Ensures index is in bounds and then references the pre-loaded atom list.
-const Point3& NearestNeighborFinder::particlePos(size_t index) const{
-    //assert(index >= 0 && index < atoms.size());
-    return atoms[index].pos;
+// Maps a position into the cell along the periodic dimensions and stores its
+// reduced coordinates in "reduced".
+Point3 NearestNeighborFinder::wrapPosition(const Point3& pos, Point3& reduced) const{
+    Point3 wrapped = pos;
+    reduced = simCell.absoluteToReduced(pos);
+    for(size_t k = 0; k < 3; k++){
+        if(simCell.pbcFlags()[k]){
+            if(double s = floor(reduced[k])){
+                reduced[k] -= s;
+                wrapped -= s * simCell.matrix().column(k);
+            }
+        }
+    }
+    return wrapped;
+}
+
+// Returns the wrapped 3D position of the atom at the given index. It is
+// recomputed from the input positions, which the finder does not copy.
+Point3 NearestNeighborFinder::particlePos(size_t index) const{
+    assert(index < numInputPositions);
+    Point3 reduced;
+    return wrapPosition(inputPositions[index], reduced);
 }
 
 // Computes the squared minimum possible distance from "query_point" to any point
 // inside the axis-aligned bounding box of "node". This is used to cull tree branches
 // whose entire regions lies farther than our current furthest neighbor.
-double NearestNeighborFinder::minimumDistance(TreeNode* node, const Point3& query_point) const{
+double NearestNeighborFinder::minimumDistance(const TreeNode& node, const Point3& query_point) const{
 	// Delta to box min and max corners
-    Vector3 p1 = node->bounds.minc - query_point;
-    Vector3 p2 = query_point - node->bounds.maxc;
+    Vector3 p1 = node.bounds.minc - query_point;
+    Vector3 p2 = query_point - node.bounds.maxc;
 
     double minDistance = 0;
     // For each axis, if query_point is outside the slab, dot against face normal
@@ -37,13 +60,33 @@ double NearestNeighborFinder::minimumDistance(TreeNode* node, const Point3& quer
 template<int MAX_NEIGHBORS_LIMIT>
 void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::findNeighbors(const Point3& query_point, bool includeSelf){
     queue.clear();
+    const TreeNode& root = t.nodes.front();
+
+    if(t.ghostPadding > 0){
+        // Wrap the query point into the cell, where the ghost atoms stand in for
+        // every periodic image closer than the padding.
+        q = t.wrapPosition(query_point, qr);
+        visitGhosts = true;
+        visitNode(root, includeSelf);
+        visitGhosts = false;
+
+        // Images that are not in the tree are farther away than the padding, so
+        // the result is exact unless the k-th neighbor lies beyond it. Sparse
+        // regions fall back to the image loop below.
+        if(queue.full() && queue.top().distanceSq <= t.ghostPadding * t.ghostPadding){
+            queue.sort();
+            return;
+        }
+        queue.clear();
+    }
+
 	// Try every periodic image shift
     for(const Vector3& pbcShift : t.pbcImages){
         q = query_point - pbcShift;
 		// Only descend into the tree if there's any hope of finding a closer point
-        if(!queue.full() || queue.top().distanceSq > t.minimumDistance(t.root, q)){
+        if(!queue.full() || queue.top().distanceSq > t.minimumDistance(root, q)){
             qr = t.simCell.absoluteToReduced(q);
-            visitNode(t.root, includeSelf);
+            visitNode(root, includeSelf);
         }
     }
 
@@ -57,140 +100,88 @@ void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::findNeighbors(size_t par
     findNeighbors(t.particlePos(particleIndex), includeSelf);
 }
 
-// Recursive tree-walk. At a leaf, test every atom; otherwise choose the nearer
-// child first and prune the farther child if its box is too far.
-template<int MAX_NEIGHBORS_LIMIT>
-void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::visitNode(TreeNode* node, bool includeSelf){
-    if(node->isLeaf()){
-		// Check every atom in this bucket
-        for(NeighborListAtom* atom = node->atoms; atom != nullptr; atom = atom->nextInBin){
-            Neighbor n;
-            n.delta = atom->pos - q;
-            n.distanceSq = n.delta.squaredLength();
-            // Optionally skip zero-distance self hits
-            if(includeSelf || n.distanceSq != 0){
-                n.atom = atom;
-                n.index = atom - &t.atoms.front();
-                queue.insert(n);
-            }
-        }
-    }else{
-		// Determine which child region is closer on split axis
-        TreeNode* cnear;
-        TreeNode* cfar;
-        if(qr[node->splitDim] < node->splitPos){
-            cnear = node->children[0];
-            cfar  = node->children[1];
-        }else{
-            cnear = node->children[1];
-            cfar  = node->children[0];
-        }
-        visitNode(cnear, includeSelf); 
-
-		// Only descend into the far child if it could hot a nearer point
-        if(!queue.full() || queue.top().distanceSq > t.minimumDistance(cfar, q)){
-            visitNode(cfar, includeSelf); 
-        }
-    }
-}
-
-// Convert all bounding boxes in the three from reduced (0-1) to actual coordinates
-// once every point has been inserted.
-void NearestNeighborFinder::TreeNode::convertToAbsoluteCoordinates(const SimulationCell& cell){
-    bounds.minc = cell.reducedToAbsolute(bounds.minc);
-    bounds.maxc = cell.reducedToAbsolute(bounds.maxc);
-    if(!isLeaf()){
-        children[0]->convertToAbsoluteCoordinates(cell);
-        children[1]->convertToAbsoluteCoordinates(cell);
-    }
-}
-
-// A node is leaf it it hasn't been split (splitDim == -1)
-bool NearestNeighborFinder::TreeNode::isLeaf() const{
-    return splitDim == -1;
-}
-
 template<int MAX_NEIGHBORS_LIMIT>
 void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::findNeighbors(const Point3& query_point){
-    queue.clear();
-    for(const Vector3& pbcShift : t.pbcImages){
-        q = query_point - pbcShift;
-        if(!queue.full() || queue.top().distanceSq > t.minimumDistance(t.root, q)){
-            qr = t.simCell.absoluteToReduced(q);
-            visitNode(t.root);
-        }
-    }
-    queue.sort();
+    findNeighbors(query_point, false);
 }
 
 template<int MAX_NEIGHBORS_LIMIT>
 void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::findNeighbors(size_t particleIndex){
-    findNeighbors(t.particlePos(particleIndex));
+    findNeighbors(t.particlePos(particleIndex), false);
 }
 
+// Scans the slots [begin, end) of one leaf, whose columns hold coordinates
+// relative to origin. Doubles are stored absolute and get a zero origin. For
+// floats the query is rounded the same way the stored offsets were, so the
+// query atom itself lands at distance zero.
 template<int MAX_NEIGHBORS_LIMIT>
-void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::visitNode(TreeNode* node){
-    if(node->isLeaf()){
-        for(NeighborListAtom* atom = node->atoms; atom != nullptr; atom = atom->nextInBin){
+template<typename Coordinate>
+void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::scanLeaf(const Coordinate* x, const Coordinate* y, const Coordinate* z, size_t begin, size_t end, const Point3& origin, bool includeSelf){
+    const Point3 qo(
+        static_cast<Coordinate>(q.x() - origin.x()),
+        static_cast<Coordinate>(q.y() - origin.y()),
+        static_cast<Coordinate>(q.z() - origin.z()));
+    for(size_t base = begin; base < end; base += DistanceKernels::MaxBatch){
+        // Test a batch of candidates against the current worst neighbor at once,
+        // then insert only those that passed.
+        const size_t count = std::min(DistanceKernels::MaxBatch, end - base);
+        const double limitSq = queue.full() ? queue.top().distanceSq : DOUBLE_MAX;
+        std::uint64_t mask = DistanceKernels::withinMask(x + base, y + base, z + base, count, qo, limitSq);
+        while(mask){
+            const size_t i = base + DistanceKernels::lowestBit(mask);
+            mask &= mask - 1;
+
+            const double dx = x[i] - qo.x();
+            const double dy = y[i] - qo.y();
+            const double dz = z[i] - qo.z();
+            const double distanceSq = dx * dx + dy * dy + dz * dz;
+            // Optionally skip zero-distance self hits
+            if(!includeSelf && distanceSq == 0) continue;
+            if(queue.full() && !(distanceSq < queue.top().distanceSq)) continue;
+
             Neighbor n;
-            n.delta = atom->pos - q;
-            n.distanceSq = n.delta.squaredLength();
-            if(n.distanceSq != 0){
-                n.atom = atom;
-                n.index = atom - &t.atoms.front();
-                queue.insert(n);
-            }
+            n.delta = Vector3(dx, dy, dz);
+            n.distanceSq = distanceSq;
+            n.index = t.leafIndex[i];
+            queue.insert(n);
         }
-    }else{
-        TreeNode* cnear;
-        TreeNode* cfar;
-        if(qr[node->splitDim] < node->splitPos){
-            cnear = node->children[0];
-            cfar  = node->children[1];
+    }
+}
+
+// Recursive tree-walk. At a leaf, scan its contiguous slice of the leaf arrays;
+// otherwise choose the nearer child first and prune the farther child if its
+// box is too far.
+template<int MAX_NEIGHBORS_LIMIT>
+void NearestNeighborFinder::Query<MAX_NEIGHBORS_LIMIT>::visitNode(const TreeNode& node, bool includeSelf){
+    if(node.isLeaf()){
+        const size_t end = visitGhosts ? node.end : node.ghostBegin;
+        if(t.precision == SearchPrecision::Single){
+            scanLeaf(t.leafXf.data(), t.leafYf.data(), t.leafZf.data(), node.begin, end, node.bounds.minc, includeSelf);
         }else{
-            cnear = node->children[1];
-            cfar  = node->children[0];
+            scanLeaf(t.leafX.data(), t.leafY.data(), t.leafZ.data(), node.begin, end, Point3::Origin(), includeSelf);
         }
-        visitNode(cnear);
+    }else{
+		// Determine which child region is closer on split axis
+        const TreeNode* children = &t.nodes[node.firstChild];
+        const bool nearIsLeft = qr[node.splitDim] < node.splitPos;
+        const TreeNode& cnear = children[nearIsLeft ? 0 : 1];
+        const TreeNode& cfar = children[nearIsLeft ? 1 : 0];
+        visitNode(cnear, includeSelf);
 
+		// Only descend into the far child if it could hold a nearer point
         if(!queue.full() || queue.top().distanceSq > t.minimumDistance(cfar, q)){
-            visitNode(cfar);
+            visitNode(cfar, includeSelf);
         }
     }
 }
 
-// Inserts a single atom into the bounding-volume tree. Splits a leaf
-// if its bucket overflows, choosing the largest box dimension to cut in half.
-void NearestNeighborFinder::insertParticle(NeighborListAtom* atom, const Point3& p, TreeNode* node, int depth){
-	if(node->isLeaf()){
-		// Add to thist leaf's linked list
-		//assert(node->bounds.classifyPoint(p) != -1);
-		atom->nextInBin = node->atoms;
-		node->atoms = atom;
-		node->numAtoms++;
-		if(depth > maxTreeDepth) maxTreeDepth = depth;
-
-		// If too many atoms, split this leaf on its longest axis
-		if(node->numAtoms > bucketSize && depth < TREE_DEPTH_LIMIT){
-			splitLeafNode(node, determineSplitDirection(node));
-		}
-	}else{
-		// Recurse into the appropiate child
-		if(p[node->splitDim] < node->splitPos){
-			insertParticle(atom, p, node->children[0], depth+1);
-		}else{
-			insertParticle(atom, p, node->children[1], depth+1);
-		}
-	}
-}
-
 // Chooses the split axis by comparing physical box sizes in each dimension,
 // scaled by the simulation cell basis vectors.
-int NearestNeighborFinder::determineSplitDirection(TreeNode* node){
+int NearestNeighborFinder::determineSplitDirection(const TreeNode& node) const{
 	double dmax = 0.0;
 	int dmax_dim = -1;
 	for(int dim = 0; dim < 3; dim++){
-		double d = simCell.matrix().column(dim).squaredLength() * node->bounds.size(dim) * node->bounds.size(dim);
+		double d = simCell.matrix().column(dim).squaredLength() * node.bounds.size(dim) * node.bounds.size(dim);
 		if(d > dmax){
 			dmax = d;
 			dmax_dim = dim;
@@ -200,40 +191,384 @@ int NearestNeighborFinder::determineSplitDirection(TreeNode* node){
 	return dmax_dim;
 }
 
-// Splits a leaf node into two children along "splitDim" at the midpoint.
-// Re-distributes all atoms in this leaf into the two new child leaves.
-void NearestNeighborFinder::splitLeafNode(TreeNode* node, int splitDim){
-	NeighborListAtom* atom = node->atoms;
-
-	// Allocate children
-	node->splitDim = splitDim;
-	node->splitPos = (node->bounds.minc[splitDim] + node->bounds.maxc[splitDim]) * 0.5;
-	node->children[0] = nodePool.construct();
-	node->children[1] = nodePool.construct();
-	node->children[0]->bounds = node->bounds;
-	node->children[1]->bounds = node->bounds;
-	node->children[0]->bounds.maxc[splitDim] = node->children[1]->bounds.minc[splitDim] = node->splitPos;
-
-	// Redistribute atoms to child nodes.
-	while(atom != nullptr){
-		NeighborListAtom* next = atom->nextInBin;
-		double p = simCell.inverseMatrix().prodrow(atom->pos, splitDim);
-		if(p < node->splitPos){
-			atom->nextInBin = node->children[0]->atoms;
-			node->children[0]->atoms = atom;
-		}else{
-			atom->nextInBin = node->children[1]->atoms;
-			node->children[1]->atoms = atom;
+namespace {
+
+// Below this many entries a partition or loop stays on the calling thread.
+constexpr size_t ParallelGrain = size_t(1) << 15;
+
+// Width of the ghost layer in units of the expected distance of the k-th
+// nearest neighbor.
+constexpr double GhostPaddingFactor = 1.5;
+
+// In Auto mode ghost atoms are used when a periodic dimension of the cell is
+// less than this many paddings thick, so that nearly every query would descend
+// again for the images on both sides. In thicker cells the extra descents are
+// pruned near the root and cost less than the larger tree.
+constexpr double GhostThicknessRatio = 2.0;
+
+// Stable partition of data[0, count) by pred, using scratch[0, count) as
+// the staging buffer; returns the number of entries for which pred holds.
+// Being stable, the result is the same regardless of the number of threads,
+// so the tree and hence every query result are independent of it too.
+template <typename Pred>
+size_t stablePartition(size_t* data, size_t count, size_t* scratch, const Pred& pred){
+	if(count < ParallelGrain){
+		size_t numTrue = 0;
+		size_t numFalse = 0;
+		for(size_t i = 0; i < count; ++i){
+			if(pred(data[i])){
+				data[numTrue++] = data[i];
+			}else{
+				scratch[numFalse++] = data[i];
+			}
+		}
+		std::copy(scratch, scratch + numFalse, data + numTrue);
+		return numTrue;
+	}
+
+	// Count per chunk, turn the counts into output offsets, then scatter.
+	const size_t numChunks = (count + ParallelGrain - 1) / ParallelGrain;
+	std::vector<size_t> trueOffsets(numChunks + 1, 0);
+	tbb::parallel_for(size_t(0), numChunks, [&](size_t chunk){
+		const size_t end = std::min(count, (chunk + 1) * ParallelGrain);
+		size_t n = 0;
+		for(size_t i = chunk * ParallelGrain; i < end; ++i){
+			if(pred(data[i])) n++;
+		}
+		trueOffsets[chunk + 1] = n;
+	});
+	for(size_t chunk = 0; chunk < numChunks; ++chunk){
+		trueOffsets[chunk + 1] += trueOffsets[chunk];
+	}
+
+	const size_t numTrue = trueOffsets[numChunks];
+	tbb::parallel_for(size_t(0), numChunks, [&](size_t chunk){
+		const size_t begin = chunk * ParallelGrain;
+		const size_t end = std::min(count, begin + ParallelGrain);
+		size_t t = trueOffsets[chunk];
+		size_t f = numTrue + begin - trueOffsets[chunk];
+		for(size_t i = begin; i < end; ++i){
+			if(pred(data[i])){
+				scratch[t++] = data[i];
+			}else{
+				scratch[f++] = data[i];
+			}
 		}
-		atom = next;
+	});
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, count, ParallelGrain), [&](const tbb::blocked_range<size_t>& r){
+		std::copy(scratch + r.begin(), scratch + r.end(), data + r.begin());
+	});
+	return numTrue;
+}
+
+}
+
+// Splits a planned inner node into the two children at firstChild along its
+// split plane, partitioning its slice of atoms between them.
+void NearestNeighborFinder::splitNode(size_t nodeIndex, const std::vector<Point3>& reduced, std::vector<size_t>& entries, std::vector<size_t>& scratch){
+	const TreeNode& node = nodes[nodeIndex];
+	const int splitDim = node.splitDim;
+	const double splitPos = node.splitPos;
+
+	const size_t numLeft = stablePartition(
+		entries.data() + node.begin, node.end - node.begin, scratch.data() + node.begin,
+		[&](size_t index){ return reduced[index][splitDim] < splitPos; });
+
+	TreeNode& left = nodes[node.firstChild];
+	left.bounds = node.bounds;
+	left.bounds.maxc[splitDim] = splitPos;
+	left.begin = node.begin;
+	left.end = node.begin + numLeft;
+
+	TreeNode& right = nodes[node.firstChild + 1];
+	right.bounds = node.bounds;
+	right.bounds.minc[splitDim] = splitPos;
+	right.begin = left.end;
+	right.end = node.end;
+}
+
+// Returns the width of the ghost layer to build, or zero to handle periodic
+// boundaries with image shifts only. The expected distance of the k-th
+// neighbor is the radius of the sphere (the circle in 2D cells) that holds
+// numNeighbors atoms at the mean density of the selected atoms.
+double NearestNeighborFinder::chooseGhostPadding(size_t selectedCount) const{
+	if(periodicMode == PeriodicMode::Images || selectedCount == 0) return 0;
+
+	double minThickness = DOUBLE_MAX;
+	for(size_t k = 0; k < 3; k++){
+		if(!simCell.pbcFlags()[k]) continue;
+		minThickness = std::min(minThickness, std::abs(planeNormals[k].dot(simCell.matrix().column(k))));
+	}
+	if(minThickness == DOUBLE_MAX) return 0;
+
+	double radius;
+	if(simCell.is2D()){
+		const double area = simCell.matrix().column(0).cross(simCell.matrix().column(1)).length();
+		radius = std::sqrt(numNeighbors * area / (M_PI * selectedCount));
+	}else{
+		radius = std::cbrt(3.0 * numNeighbors * simCell.volume3D() / (4.0 * M_PI * selectedCount));
 	}
 
-	numLeafNodes++;
+	// Only the directly adjacent images are ever searched, so the layer
+	// cannot be thicker than the cell.
+	const double padding = std::min(GhostPaddingFactor * radius, minThickness);
+	if(periodicMode == PeriodicMode::Auto && minThickness >= GhostThicknessRatio * padding) return 0;
+	return padding;
+}
+
+// Wraps the given positions into the cell and builds the tree over the selected
+// ones. The tree is refined one breadth-first level at a time: the first three
+// levels always split along X, Y and Z, below that a leaf is split on its longest
+// axis while it holds more than bucketSize atoms. Each level is planned serially,
+// which fixes the node numbering, and then partitioned in parallel: the nodes of
+// a level own disjoint slices, and the few huge slices near the root are each
+// partitioned in parallel chunks. Once the shape is fixed, the leaf atoms are
+// copied into the x/y/z columns in tree order.
+//
+// With a ghost layer, the copies of the atoms near the periodic faces are
+// added as extra entries before the tree is refined; they extend the root box
+// beyond the cell by the padding and end up behind the real atoms of their
+// leaf.
+void NearestNeighborFinder::buildTree(const Point3* points, size_t count, const int* selection){
+	// Determine reduced-space bounding box if any PBC is off
+	Box3 boundingBox(Point3(0,0,0), Point3(1,1,1));
+	if(simCell.pbcFlags()[0] == false || simCell.pbcFlags()[1] == false || simCell.pbcFlags()[2] == false){
+		boundingBox = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, count, ParallelGrain), boundingBox,
+			[&](const tbb::blocked_range<size_t>& r, Box3 box){
+				for(size_t i = r.begin(); i < r.end(); ++i){
+					Point3 reducedp = simCell.absoluteToReduced(points[i]);
+					for(size_t k = 0; k < 3; k++){
+						if(simCell.pbcFlags()[k]) continue;
+						if(reducedp[k] < box.minc[k]){
+							box.minc[k] = reducedp[k];
+						}else if(reducedp[k] > box.maxc[k]){
+							box.maxc[k] = reducedp[k];
+						}
+					}
+				}
+				return box;
+			},
+			[](Box3 a, const Box3& b){
+				for(size_t k = 0; k < 3; k++){
+					a.minc[k] = std::min(a.minc[k], b.minc[k]);
+					a.maxc[k] = std::max(a.maxc[k], b.maxc[k]);
+				}
+				return a;
+			});
+	}
+
+	// Only the reduced coordinates of the wrapped positions are kept for the
+	// build; the real-space ones are recomputed from the input when the leaf
+	// columns are filled. The tree is built over size_t entries, which leave
+	// room for the ghost numbers past count; the leaf index column keeps only
+	// the particle indices.
+	inputPositions = points;
+	numInputPositions = count;
+	std::vector<Point3> reduced(count);
+	std::vector<size_t> entries(count);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, count, ParallelGrain), [&](const tbb::blocked_range<size_t>& r){
+		for(size_t i = r.begin(); i < r.end(); ++i){
+			wrapPosition(points[i], reduced[i]);
+			entries[i] = i;
+		}
+	});
+
+	std::vector<size_t> scratch(count);
+
+	// TODO: remove selections
+	if(selection){
+		entries.resize(stablePartition(entries.data(), count, scratch.data(),
+			[selection](size_t index){ return selection[index] != 0; }));
+	}
+
+	// Entries from count on are ghosts. They are counted and filled per atom,
+	// so their order, and with it the tree, does not depend on the threads.
+	ghostPadding = chooseGhostPadding(entries.size());
+	std::vector<Point3> ghostPositions;
+	std::vector<size_t> ghostSource;
+	if(ghostPadding > 0){
+		double pad[3] = { 0, 0, 0 };
+		for(size_t k = 0; k < 3; k++){
+			if(!simCell.pbcFlags()[k]) continue;
+			pad[k] = ghostPadding / std::abs(planeNormals[k].dot(simCell.matrix().column(k)));
+			boundingBox.minc[k] = -pad[k];
+			boundingBox.maxc[k] = 1 + pad[k];
+		}
+
+		// Cell shifts along dimension k at which an atom has a copy; the first
+		// one is the atom itself.
+		auto imageShifts = [&](const Point3& rp, size_t k, int* shifts){
+			int n = 0;
+			shifts[n++] = 0;
+			if(simCell.pbcFlags()[k]){
+				if(rp[k] < pad[k]) shifts[n++] = 1;
+				if(rp[k] >= 1 - pad[k]) shifts[n++] = -1;
+			}
+			return n;
+		};
+
+		const size_t selected = entries.size();
+		std::vector<size_t> ghostStart(selected + 1, 0);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, selected, ParallelGrain), [&](const tbb::blocked_range<size_t>& r){
+			int shifts[3];
+			for(size_t i = r.begin(); i < r.end(); ++i){
+				const Point3& rp = reduced[entries[i]];
+				ghostStart[i + 1] = imageShifts(rp, 0, shifts) * imageShifts(rp, 1, shifts) * imageShifts(rp, 2, shifts) - 1;
+			}
+		});
+		for(size_t i = 0; i < selected; ++i){
+			ghostStart[i + 1] += ghostStart[i];
+		}
+
+		const size_t numGhosts = ghostStart[selected];
+		ghostPositions.resize(numGhosts);
+		ghostSource.resize(numGhosts);
+		reduced.resize(count + numGhosts);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, selected, ParallelGrain), [&](const tbb::blocked_range<size_t>& r){
+			int shifts[3][3];
+			int numShifts[3];
+			Point3 rp;
+			for(size_t i = r.begin(); i < r.end(); ++i){
+				const size_t index = entries[i];
+				const Point3 pos = wrapPosition(points[index], rp);
+				for(size_t k = 0; k < 3; k++){
+					numShifts[k] = imageShifts(rp, k, shifts[k]);
+				}
+				size_t g = ghostStart[i];
+				for(int a = 0; a < numShifts[0]; a++){
+					for(int b = 0; b < numShifts[1]; b++){
+						for(int c = 0; c < numShifts[2]; c++){
+							if(a == 0 && b == 0 && c == 0) continue;
+							const Vector3 shift(shifts[0][a], shifts[1][b], shifts[2][c]);
+							reduced[count + g] = rp + shift;
+							ghostPositions[g] = pos + simCell.matrix() * shift;
+							ghostSource[g] = index;
+							g++;
+						}
+					}
+				}
+			}
+		});
+
+		entries.resize(selected + numGhosts);
+		for(size_t g = 0; g < numGhosts; ++g){
+			entries[selected + g] = count + g;
+		}
+		scratch.resize(std::max(count, entries.size()));
+	}
+
+	nodes.clear();
+	TreeNode root;
+	root.bounds = boundingBox;
+	root.end = entries.size();
+	nodes.push_back(root);
+	numLeafNodes = 1;
+	maxTreeDepth = 1;
+
+	std::vector<size_t> splits;
+	size_t levelBegin = 0;
+	for(int depth = 0; levelBegin < nodes.size(); ++depth){
+		const size_t levelEnd = nodes.size();
+
+		splits.clear();
+		for(size_t n = levelBegin; n < levelEnd; ++n){
+			TreeNode& node = nodes[n];
+			int splitDim = -1;
+			if(depth < 3){
+				splitDim = depth;
+			}else if(node.end - node.begin > static_cast<size_t>(bucketSize) && depth < TREE_DEPTH_LIMIT){
+				splitDim = determineSplitDirection(node);
+			}
+			if(splitDim < 0) continue;
+
+			node.splitDim = splitDim;
+			node.splitPos = (node.bounds.minc[splitDim] + node.bounds.maxc[splitDim]) * 0.5;
+			node.firstChild = static_cast<int>(levelEnd + 2 * splits.size());
+			splits.push_back(n);
+		}
+		if(splits.empty()) break;
+
+		nodes.resize(levelEnd + 2 * splits.size());
+		tbb::parallel_for(size_t(0), splits.size(), [&](size_t i){
+			splitNode(splits[i], reduced, entries, scratch);
+		});
+
+		numLeafNodes += static_cast<int>(splits.size());
+		maxTreeDepth = std::max(maxTreeDepth, depth + 1);
+		levelBegin = levelEnd;
+	}
+
+	// Move the ghosts of each leaf behind its real atoms, so that the image
+	// loop can skip them.
+	tbb::parallel_for(size_t(0), nodes.size(), [&](size_t n){
+		TreeNode& node = nodes[n];
+		node.ghostBegin = node.end;
+		if(ghostPositions.empty() || !node.isLeaf()) return;
+		auto first = entries.begin() + node.begin;
+		auto ghosts = std::stable_partition(first, entries.begin() + node.end, [count](size_t entry){ return entry < count; });
+		node.ghostBegin = node.begin + (ghosts - first);
+	});
+
+	const size_t numEntries = entries.size();
+	const bool single = precision == SearchPrecision::Single;
+	std::vector<Point3> entryPositions(single ? numEntries : 0);
+	if(single){
+		std::vector<double>().swap(leafX);
+		std::vector<double>().swap(leafY);
+		std::vector<double>().swap(leafZ);
+		leafXf.resize(numEntries);
+		leafYf.resize(numEntries);
+		leafZf.resize(numEntries);
+	}else{
+		std::vector<float>().swap(leafXf);
+		std::vector<float>().swap(leafYf);
+		std::vector<float>().swap(leafZf);
+		leafX.resize(numEntries);
+		leafY.resize(numEntries);
+		leafZ.resize(numEntries);
+	}
+	leafIndex.resize(numEntries);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, numEntries, ParallelGrain), [&](const tbb::blocked_range<size_t>& r){
+		Point3 rp;
+		for(size_t i = r.begin(); i < r.end(); ++i){
+			const size_t entry = entries[i];
+			const Point3 pos = entry < count ? wrapPosition(points[entry], rp) : ghostPositions[entry - count];
+			if(single){
+				entryPositions[i] = pos;
+			}else{
+				leafX[i] = pos.x();
+				leafY[i] = pos.y();
+				leafZ[i] = pos.z();
+			}
+			leafIndex[i] = static_cast<AtomIndex>(entry < count ? entry : ghostSource[entry - count]);
+		}
+	});
+
+	// Switch all node bounds into real coordinates for later distance tests
+	for(TreeNode& node : nodes){
+		node.bounds.minc = simCell.reducedToAbsolute(node.bounds.minc);
+		node.bounds.maxc = simCell.reducedToAbsolute(node.bounds.maxc);
+	}
+
+	// Float columns hold offsets from the lower corner of the leaf box, which
+	// is only known in real coordinates now.
+	if(single){
+		tbb::parallel_for(size_t(0), nodes.size(), [&](size_t n){
+			const TreeNode& node = nodes[n];
+			if(!node.isLeaf()) return;
+			const Point3& origin = node.bounds.minc;
+			for(size_t i = node.begin; i < node.end; ++i){
+				leafXf[i] = static_cast<float>(entryPositions[i].x() - origin.x());
+				leafYf[i] = static_cast<float>(entryPositions[i].y() - origin.y());
+				leafZf[i] = static_cast<float>(entryPositions[i].z() - origin.z());
+			}
+		});
+	}
 }
 
 // Builds the entire tree from a flat list of particle positions and an optional
 // selection mask. Handles periodic boundaries by generating a short list of image
-// shifts, sorting them nearest-first and inserting every selected atom into the three.
+// shifts, sorting them nearest-first and building the tree over every selected atom.
 bool NearestNeighborFinder::prepare(
     ParticleProperty* posProperty, 
     const SimulationCell& cellData, 
@@ -255,12 +590,17 @@ bool NearestNeighborFinder::prepare(
 		throw std::runtime_error("Simulation cell is degenerate.");
 	}
 
+	if(posProperty->size() > MaxAtomCount){
+		throw std::runtime_error("Too many particles for the atom index type of this build.");
+	}
+
 	// Compute normal vectors of simulation cell faces.
 	planeNormals[0] = simCell.cellNormalVector(0);
 	planeNormals[1] = simCell.cellNormalVector(1);
 	planeNormals[2] = simCell.cellNormalVector(2);
 
 	// Create list of periodic image shift vectors.
+	pbcImages.clear();
 	int nx = simCell.pbcFlags()[0] ? 1 : 0;
 	int ny = simCell.pbcFlags()[1] ? 1 : 0;
 	int nz = simCell.pbcFlags()[2] ? 1 : 0;
@@ -278,80 +618,8 @@ bool NearestNeighborFinder::prepare(
 		return a.squaredLength() < b.squaredLength();
 	});
 
-	// Determine reduced-space bounding box if any PBC is off
-	Box3 boundingBox(Point3(0,0,0), Point3(1,1,1));
-	if(simCell.pbcFlags()[0] == false || simCell.pbcFlags()[1] == false || simCell.pbcFlags()[2] == false){
-		for(const Point3& p : posProperty->constPoint3Range()){
-			Point3 reducedp = simCell.absoluteToReduced(p);
-			if(simCell.pbcFlags()[0] == false){
-				if(reducedp.x() < boundingBox.minc.x()){
-					boundingBox.minc.x() = reducedp.x();
-				}else if(reducedp.x() > boundingBox.maxc.x()){
-					boundingBox.maxc.x() = reducedp.x();
-				}
-			}
-			if(simCell.pbcFlags()[1] == false){
-				if(reducedp.y() < boundingBox.minc.y()){
-					boundingBox.minc.y() = reducedp.y();
-				}else if(reducedp.y() > boundingBox.maxc.y()){
-					boundingBox.maxc.y() = reducedp.y();
-				}
-			}
-			if(simCell.pbcFlags()[2] == false){
-				if(reducedp.z() < boundingBox.minc.z()){
-					boundingBox.minc.z() = reducedp.z();
-				}else if(reducedp.z() > boundingBox.maxc.z()){
-					boundingBox.maxc.z() = reducedp.z();
-				}
-			}
-		}
-	}
-
-	// Create root node.
-	root = nodePool.construct();
-	root->bounds = boundingBox;
-	numLeafNodes++;
-
-	// Create first level of child nodes by splitting in X direction.
-	splitLeafNode(root, 0);
-
-	// Create second level of child nodes by splitting in Y direction.
-	splitLeafNode(root->children[0], 1);
-	splitLeafNode(root->children[1], 1);
-
-	// Create third level of child nodes by splitting in Z direction.
-	splitLeafNode(root->children[0]->children[0], 2);
-	splitLeafNode(root->children[0]->children[1], 2);
-	splitLeafNode(root->children[1]->children[0], 2);
-	splitLeafNode(root->children[1]->children[1], 2);
-
-	// Insert particles into tree structure. Refine tree as needed.
-	const Point3* p = posProperty->constDataPoint3();
 	const int* sel = selectionProperty ? selectionProperty->constDataInt() : nullptr;
-	atoms.resize(posProperty->size());
-
-	for(NeighborListAtom& a : atoms){
-		a.pos = *p;
-		// Wrap atomic positions back into simulation box.
-		Point3 rp = simCell.absoluteToReduced(a.pos);
-		for(size_t k = 0; k < 3; k++){
-			if(simCell.pbcFlags()[k]){
-				if(double s = floor(rp[k])){
-					rp[k] -= s;
-					a.pos -= s * simCell.matrix().column(k);
-				}
-			}
-		}
-
-		// TODO: remove selections
-		if(!sel || *sel++){
-			insertParticle(&a, rp, root, 0);
-		}
-		++p;
-	}
-
-	// Switch all node bounds into real coordinates for later distance tests
-	root->convertToAbsoluteCoordinates(simCell);
+	buildTree(posProperty->constDataPoint3(), posProperty->size(), sel);
 	return true;
 }
 
@@ -0,0 +1,55 @@
+#include <opendxa/analysis/neighbor_list_cache.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string_view>
+
+namespace OpenDXA{
+
+namespace {
+
+std::string_view selectionBytes(const ParticleProperty* selection){
+    if(!selection) return {};
+    return std::string_view(static_cast<const char*>(selection->constData()), selection->size() * selection->stride());
+}
+
+}
+
+std::shared_ptr<const NearestNeighborFinder> NeighborListCache::nearestNeighbors(int numNeighbors, ParticleProperty* selection){
+    const bool hasSelection = selection != nullptr;
+    const std::string_view bytes = selectionBytes(selection);
+    const size_t hash = std::hash<std::string_view>{}(bytes);
+    auto sameSelection = [&](const Entry& entry){
+        return entry.hasSelection == hasSelection && entry.selectionHash == hash &&
+            std::string_view(entry.selectionBytes.data(), entry.selectionBytes.size()) == bytes;
+    };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(const Entry& entry : _entries){
+        if(sameSelection(entry) && entry.numNeighbors >= numNeighbors){
+            return entry.finder;
+        }
+    }
+
+    auto finder = std::make_shared<NearestNeighborFinder>(numNeighbors);
+    finder->setPrecision(_precision);
+    if(!finder->prepare(_positions, _simCell, selection)){
+        throw std::runtime_error("Error in NearestNeighborFinder::prepare(...)");
+    }
+
+    // The new tree serves every request the smaller ones over the same
+    // selection did.
+    std::erase_if(_entries, sameSelection);
+    _entries.push_back({numNeighbors, hasSelection, hash, std::vector<char>(bytes.begin(), bytes.end()), finder});
+    _buildCount++;
+    spdlog::debug("Built nearest-neighbor tree for {} neighbors ({} trees so far)", numNeighbors, _buildCount);
+    return finder;
+}
+
+void NeighborListCache::setPrecision(SearchPrecision precision){
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(precision == _precision) return;
+    _precision = precision;
+    _entries.clear();
+}
+
+}
@@ -73,7 +73,8 @@ int PTM::Kernel::cacheNeighbors(size_t particleIndex, uint64_t* res){
 bool PTM::prepare(
     const Point3* positions,
     size_t particleCount,
-    const SimulationCell& cellData
+    const SimulationCell& cellData,
+    std::shared_ptr<const NearestNeighborFinder> sharedFinder
 ){
     //assert(positions);
     _particleCount = particleCount;
@@ -82,6 +83,9 @@ bool PTM::prepare(
     if(simCell.volume3D() <= EPSILON){
         throw std::runtime_error("Simulation cell is degenerated.");
     }
+
+    _sharedFinder = std::move(sharedFinder);
+    if(_sharedFinder) return true;
  
     planeNormals[0] = simCell.cellNormalVector(0);
     planeNormals[1] = simCell.cellNormalVector(1);
@@ -104,74 +108,13 @@ bool PTM::prepare(
         return a.squaredLength() < b.squaredLength();
     });
 
-    Box3 boundingBox(Point3(0, 0, 0), Point3(1, 1, 1));
-    if(!simCell.pbcFlags()[0] || !simCell.pbcFlags()[1] || !simCell.pbcFlags()[2]){
-        for(size_t i = 0; i < particleCount; ++i){
-            const Point3& p = positions[i];
-            Point3 reducedp = simCell.absoluteToReduced(p);
-            if(!simCell.pbcFlags()[0]){
-                if(reducedp.x() < boundingBox.minc.x()){
-                    boundingBox.minc.x() = reducedp.x();
-                }else if(reducedp.x() > boundingBox.maxc.x()){
-                    boundingBox.maxc.x() = reducedp.x();
-                }
-            }
-
-            if(!simCell.pbcFlags()[1]){
-                if(reducedp.y() < boundingBox.minc.y()){
-                    boundingBox.minc.y() = reducedp.y();
-                }else if(reducedp.y() > boundingBox.maxc.y()){
-                    boundingBox.maxc.y() = reducedp.y();
-                }
-            }
-
-            if(!simCell.pbcFlags()[2]){
-                if(reducedp.z() < boundingBox.minc.z()){
-                    boundingBox.minc.z() = reducedp.z();
-                }else if(reducedp.z() > boundingBox.maxc.z()){
-                    boundingBox.maxc.z() = reducedp.z();
-                }
-            }
-        }
-    }
-
-    root = nodePool.construct();
-    root->bounds = boundingBox;
-    numLeafNodes = 1;
-    
-    splitLeafNode(root, 0);
-    splitLeafNode(root->children[0], 1);
-    splitLeafNode(root->children[1], 1);
-    splitLeafNode(root->children[0]->children[0], 2);
-    splitLeafNode(root->children[0]->children[1], 2);
-    splitLeafNode(root->children[1]->children[0], 2);
-    splitLeafNode(root->children[1]->children[1], 2);
-
-    atoms.resize(particleCount);
-
-    for(size_t i = 0; i < particleCount; ++i){
-        NeighborListAtom& a = atoms[i];
-        a.pos = positions[i];
-        
-        Point3 rp = simCell.absoluteToReduced(a.pos);
-        for(size_t k = 0; k < 3; k++){
-            if(simCell.pbcFlags()[k]){
-                if(double s = floor(rp[k])){
-                    rp[k] -= s;
-                    a.pos -= s * simCell.matrix().column(k);
-                }
-            }
-        }
-        insertParticle(&a, rp, root, 0);
-    }
-
-    root->convertToAbsoluteCoordinates(simCell);
+    buildTree(positions, particleCount, nullptr);
     return true;
 }
 
 // Allocates and initializes the per-thread PTM state needed by the C library
 PTM::Kernel::Kernel(const PTM& algorithm) 
-    : NeighborQuery(algorithm)
+    : NeighborQuery(algorithm.neighborFinder(), MAX_INPUT_NEIGHBORS)
     , _algorithm(algorithm)
     , _structureType(StructureType::OTHER){
     _handle = ptm_initialize_local();
@@ -194,22 +137,31 @@ Quaternion PTM::Kernel::orientation() const{
 }
 
 struct ptmnbrdata_t{
-    const PTM* neighFinder;
+    const NearestNeighborFinder* neighFinder;
     const int* particleTypes;
     const std::vector<uint64_t>* cachedNeighbors;
+    // Shells gathered by identifyTile(); atoms outside it are searched
+    const PTM::Tile* tile = nullptr;
 };
 
-static int getNeighbors(void* vdata, size_t, size_t atomIndex, int numRequested, ptm_atomicenv_t* env){
-    auto* neighborData = static_cast<ptmnbrdata_t*>(vdata);
-    const PTM* finder = neighborData->neighFinder;
-    const int* particleTypes = neighborData->particleTypes;
-    const auto& cachedNeighbors = *neighborData->cachedNeighbors;
-
-    NearestNeighborFinder::Query<PTM::MAX_INPUT_NEIGHBORS> query(*finder);
-    query.findNeighbors(atomIndex, false);
-    const auto &results = query.results();
+// Structures the kernels look for
+// TODO: Segmentation fault with ICO & SC & GRAPHENE
+static constexpr int32_t identificationFlags = PTM_CHECK_SC | PTM_CHECK_FCC | PTM_CHECK_HCP | PTM_CHECK_BCC | PTM_CHECK_DCUB | PTM_CHECK_DHEX;
+
+// Fills a PTM environment from the neighbor shell of an atom in distance order
+static int fillEnvironment(
+    const ptmnbrdata_t& neighborData,
+    size_t atomIndex,
+    int numResults,
+    const size_t* indices,
+    const double (*points)[3],
+    int numRequested,
+    ptm_atomicenv_t* env
+){
+    const int* particleTypes = neighborData.particleTypes;
+    const auto& cachedNeighbors = *neighborData.cachedNeighbors;
 
-    int numNeighbors = std::min(numRequested - 1, static_cast<int>(results.size()));
+    int numNeighbors = std::min(numRequested - 1, numResults);
 
     int dummy = 0;
     ptm_decode_correspondences(
@@ -222,7 +174,7 @@ static int getNeighbors(void* vdata, size_t, size_t atomIndex, int numRequested,
     );
 
     // Central
-    env->atom_indices[0] = static_cast<int>(atomIndex);
+    env->atom_indices[0] = atomIndex;
     env->points[0][0] = 0.0;
     env->points[0][1] = 0.0;
     env->points[0][2] = 0.0;
@@ -230,12 +182,11 @@ static int getNeighbors(void* vdata, size_t, size_t atomIndex, int numRequested,
     // Neighbors by correpondences
     for(int i = 0; i < numNeighbors; ++i){
         int p = env->correspondences[i + 1] - 1;
-        if(p < 0 || p >= static_cast<int>(results.size())) continue;
-        const auto& nb = results[p];
-        env->atom_indices[i + 1] = nb.index;
-        env->points[i + 1][0] = nb.delta.x();
-        env->points[i + 1][1] = nb.delta.y();
-        env->points[i + 1][2] = nb.delta.z();
+        if(p < 0 || p >= numResults) continue;
+        env->atom_indices[i + 1] = indices[p];
+        env->points[i + 1][0] = points[p][0];
+        env->points[i + 1][1] = points[p][1];
+        env->points[i + 1][2] = points[p][2];
     }
 
     // Types
@@ -243,8 +194,8 @@ static int getNeighbors(void* vdata, size_t, size_t atomIndex, int numRequested,
         env->numbers[0] = particleTypes[atomIndex];
         for(int i = 0; i < numNeighbors; ++i){
             int p = env->correspondences[i + 1] - 1;
-            if(p < 0 || p >= static_cast<int>(results.size())) continue;
-            env->numbers[i + 1] = particleTypes[results[p].index];
+            if(p < 0 || p >= numResults) continue;
+            env->numbers[i + 1] = particleTypes[indices[p]];
         }  
     }else{
         for(int i = 0; i < numNeighbors + 1; ++i) env->numbers[i] = 0;
@@ -254,28 +205,53 @@ static int getNeighbors(void* vdata, size_t, size_t atomIndex, int numRequested,
     return env->num;
 }
 
+static int getNeighbors(void* vdata, size_t, size_t atomIndex, int numRequested, ptm_atomicenv_t* env){
+    auto* neighborData = static_cast<ptmnbrdata_t*>(vdata);
+
+    const PTM::Tile* tile = neighborData->tile;
+    if(tile && atomIndex >= tile->begin && atomIndex < tile->begin + tile->count){
+        const size_t a = atomIndex - tile->begin;
+        return fillEnvironment(*neighborData, atomIndex, tile->numNeighbors[a], tile->neighborIndices[a], tile->neighborPoints[a], numRequested, env);
+    }
+
+    NearestNeighborFinder::Query<PTM::MAX_INPUT_NEIGHBORS> query(*neighborData->neighFinder, PTM::MAX_INPUT_NEIGHBORS);
+    query.findNeighbors(atomIndex, false);
+    const auto &results = query.results();
+
+    size_t indices[PTM::MAX_INPUT_NEIGHBORS];
+    double points[PTM::MAX_INPUT_NEIGHBORS][3];
+    for(int i = 0; i < results.size(); i++){
+        indices[i] = results[i].index;
+        points[i][0] = results[i].delta.x();
+        points[i][1] = results[i].delta.y();
+        points[i][2] = results[i].delta.z();
+    }
+    return fillEnvironment(*neighborData, atomIndex, results.size(), indices, points, numRequested, env);
+}
+
 StructureType PTM::Kernel::identifyStructure(size_t particleIndex, const std::vector<uint64_t>& cachedNeighbors, Quaternion*){
     findNeighbors(particleIndex, false); 
     ptmnbrdata_t nbrdata;
-    nbrdata.neighFinder = &_algorithm; 
+    nbrdata.neighFinder = &_algorithm.neighborFinder();
     nbrdata.particleTypes = _algorithm._identifyOrdering ? _algorithm._particleTypes : nullptr;
     nbrdata.cachedNeighbors = &cachedNeighbors;
 
-    // TODO: Segmentation fault with ICO & SC & GRAPHENE
-    int32_t flags = PTM_CHECK_SC | PTM_CHECK_FCC | PTM_CHECK_HCP | PTM_CHECK_BCC | PTM_CHECK_DCUB | PTM_CHECK_DHEX;
-
     ptm_result_t result;
     int errorCode = ptm_index(
         _handle, 
         particleIndex, 
         getNeighbors, 
         (void*)&nbrdata, 
-        flags, 
+        identificationFlags, 
         _algorithm._calculateDefGradient, 
         &result, 
         &_env
     );
 
+    return storeResult(result);
+}
+
+StructureType PTM::Kernel::storeResult(const ptm_result_t& result){
     _orderingType = result.ordering_type;
     _scale = result.scale;
     _rmsd = result.rmsd;
@@ -314,6 +290,66 @@ StructureType PTM::Kernel::identifyStructure(size_t particleIndex, const std::ve
     return _structureType;
 }
 
+void PTM::Kernel::identifyTile(Tile& tile, size_t begin, size_t end, const std::vector<uint64_t>& cachedNeighbors, double rmsdLimit){
+    assert(end - begin <= TileSize);
+    tile.begin = begin;
+    tile.count = end - begin;
+
+    // Gather all shells of the tile before matching any of them
+    for(size_t a = 0; a < tile.count; a++){
+        findNeighbors(begin + a, false);
+        const int numNeighbors = results().size();
+        tile.numNeighbors[a] = numNeighbors;
+        for(int j = 0; j < numNeighbors; j++){
+            tile.neighborIndices[a][j] = results()[j].index;
+            tile.neighborPoints[a][j][0] = results()[j].delta.x();
+            tile.neighborPoints[a][j][1] = results()[j].delta.y();
+            tile.neighborPoints[a][j][2] = results()[j].delta.z();
+        }
+    }
+
+    ptmnbrdata_t nbrdata;
+    nbrdata.neighFinder = &_algorithm.neighborFinder();
+    nbrdata.particleTypes = _algorithm._identifyOrdering ? _algorithm._particleTypes : nullptr;
+    nbrdata.cachedNeighbors = &cachedNeighbors;
+    nbrdata.tile = &tile;
+
+    for(size_t a = 0; a < tile.count; a++){
+        ptm_result_t result;
+        ptm_index(_handle, begin + a, getNeighbors, (void*)&nbrdata, identificationFlags, _algorithm._calculateDefGradient, &result, &_env);
+        storeResult(result);
+
+        tile.rmsd[a] = _rmsd;
+        tile.correspondences[a] = _corrCode;
+        std::fill_n(tile.templateNeighbors[a], MAX_OUTPUT_NEIGHBORS, -1);
+        if(_structureType == StructureType::OTHER || _rmsd > rmsdLimit){
+            tile.structureTypes[a] = StructureType::OTHER;
+            tile.templateIndices[a] = 0;
+            std::fill_n(tile.orientations[a], 4, 0.0);
+            std::fill_n(tile.deformationGradients[a], 9, 0.0);
+            continue;
+        }
+
+        tile.structureTypes[a] = _structureType;
+        tile.templateIndices[a] = _bestTemplateIndex;
+        // Stored as (x, y, z, w)
+        tile.orientations[a][0] = _quaternion[1];
+        tile.orientations[a][1] = _quaternion[2];
+        tile.orientations[a][2] = _quaternion[3];
+        tile.orientations[a][3] = _quaternion[0];
+        std::copy_n(_F.elements(), 9, tile.deformationGradients[a]);
+
+        // Same mapping as getTemplateNeighbor(), with the gathered shell
+        // standing in for the query results.
+        const int numTemplateNeighbors = this->numTemplateNeighbors();
+        assert(numTemplateNeighbors <= MAX_OUTPUT_NEIGHBORS);
+        for(int j = 0; j < numTemplateNeighbors; j++){
+            const int mappedIndex = _env.correspondences[j + 1] - 1;
+            tile.templateNeighbors[a][j] = static_cast<AtomIndex>(tile.neighborIndices[a][mappedIndex]);
+        }
+    }
+}
+
 // Returns how many "template" neighbors (ideal lattice points) PTM will give us
 int PTM::Kernel::numTemplateNeighbors() const{
     int ptmType = toPtmStructureType(_structureType);
@@ -90,7 +90,7 @@ void PTMNeighborFinder::Query::getNeighbors(size_t particleIndex, int ptmType){
     const auto& correspondencesArray = *_finder._correspondencesArray;
 
     // Let the internal NearestNeighborFinder determine the list of nearest particles
-    NeighborQuery neighborQuery(_finder);
+    NeighborQuery neighborQuery(_finder.neighborFinder(), _finder.maxNeighbors());
     neighborQuery.findNeighbors(particleIndex);
 
     int numNeighbors = static_cast<int>(neighborQuery.results().size());
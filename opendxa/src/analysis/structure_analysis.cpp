@@ -10,6 +10,7 @@
 #include <execution>
 #include <ranges>
 #include <numeric>
+#include <limits>
 
 namespace OpenDXA {
 
@@ -50,7 +51,7 @@ StructureAnalysis::StructureAnalysis(
         _context.atomCount(), DataType::Int, 1, 0, true);
 
     _context.neighborLists = std::make_shared<ParticleProperty>(
-        _context.atomCount(), DataType::Int,
+        _context.atomCount(), AtomIndexDataType,
         static_cast<size_t>(requestedMaxNeighbors),
         0, false
     );
@@ -58,21 +59,29 @@ StructureAnalysis::StructureAnalysis(
     _context.templateIndex = std::make_shared<ParticleProperty>(
         _context.atomCount(), DataType::Int, 1, 0, true);
 
-    std::fill(_context.neighborLists->dataInt(),
-              _context.neighborLists->dataInt() + _context.neighborLists->size()*_context.neighborLists->componentCount(),
-              -1);
+    std::fill(_context.neighborLists->dataAtomIndex(),
+              _context.neighborLists->dataAtomIndex() + _context.neighborLists->size()*_context.neighborLists->componentCount(),
+              AtomIndex(-1));
     std::fill(_context.structureTypes->dataInt(),
               _context.structureTypes->dataInt() + _context.structureTypes->size(),
               LATTICE_OTHER);
 }
 
+bool StructureAnalysis::checkAtomCount(std::int64_t natoms, json& result){
+    if(natoms >= 0 && static_cast<std::uint64_t>(natoms) <= MaxAtomCount) return true;
+    result["is_failed"] = true;
+    result["error"] = "Structure identification supports at most " + std::to_string(MaxAtomCount) + " atoms in this build";
+    return false;
+}
+
 json StructureAnalysis::getAtomsData(
     const LammpsParser::Frame &frame,
     const std::vector<int>* structureTypes
 ){
     std::map<std::string, json> groupedAtoms;
+    const Point3* positions = frame.positionData();
 
-    for(size_t i = 0; i < frame.natoms; ++i){
+    for(size_t i = 0; i < static_cast<size_t>(frame.natoms); ++i){
         int structureType = 0;
         if(structureTypes && i < static_cast<int>(structureTypes->size())){
             structureType = (*structureTypes)[i];
@@ -89,8 +98,8 @@ json StructureAnalysis::getAtomsData(
             //atomJson["ptm_quaternion"] = {quat.x(), quat.y(), quat.z(), quat.w()};
         }
 
-        if(i < static_cast<int>(frame.positions.size())){
-            const auto &pos = frame.positions[i];
+        if(positions){
+            const auto &pos = positions[i];
             atomJson["pos"] = {pos.x(), pos.y(), pos.z()};
         }else{
             atomJson["pos"] = {0.0, 0.0, 0.0};
@@ -110,35 +119,28 @@ bool StructureAnalysis::setupPTM(OpenDXA::PTM& ptm, size_t N){
     ptm.setCalculateDefGradient(true);
     ptm.setRmsdCutoff(std::numeric_limits<double>::infinity());
     
-    return ptm.prepare(_context.positions->constDataPoint3(), N, _context.simCell);
-}
-
-void StructureAnalysis::storeNeighborIndices(const PTM::Kernel& kernel, size_t atomIndex){
-    int numNeighbors = kernel.numTemplateNeighbors();
-    assert(numNeighbors <= _context.neighborLists->componentCount());
-    
-    for(int j = 0; j < numNeighbors; ++j){
-        _context.neighborLists->setIntComponent(atomIndex, j, kernel.getTemplateNeighbor(j).index);
-    }
+    auto neighFinder = _context.neighborCache->nearestNeighbors(PTM::MAX_INPUT_NEIGHBORS);
+    return ptm.prepare(_context.positions->constDataPoint3(), N, _context.simCell, std::move(neighFinder));
 }
 
-void StructureAnalysis::storeOrientationData(const PTM::Kernel& kernel, size_t atomIndex){
-    auto quaternion = kernel.orientation();
-    double* orientation = _context.ptmOrientation->dataDouble() + 4 * atomIndex;
-    
-    orientation[0] = quaternion.x();
-    orientation[1] = quaternion.y();
-    orientation[2] = quaternion.z();
-    orientation[3] = quaternion.w();
-}
-
-void StructureAnalysis::storeDeformationGradient(const PTM::Kernel& kernel, size_t atomIndex) {
-    const auto& F = kernel.deformationGradient();
-    double* F_dest = _context.ptmDeformationGradient->dataDouble() + 9 * atomIndex;
-    const double* F_src = F.elements();
-    
-    for(int k = 0; k < 9; ++k){
-        F_dest[k] = F_src[k];
+// Copies the results of a PTM tile into the per-atom properties, one block
+// per property.
+void StructureAnalysis::storePTMTile(const PTM::Tile& tile){
+    const size_t begin = tile.begin;
+    const size_t count = tile.count;
+
+    std::copy_n(tile.rmsd, count, _context.ptmRmsd->dataDouble() + begin);
+    std::copy_n(tile.correspondences, count, reinterpret_cast<uint64_t*>(_context.correspondencesCode->data()) + begin);
+    std::copy_n(tile.structureTypes, count, _context.structureTypes->dataInt() + begin);
+    std::copy_n(tile.templateIndices, count, _context.templateIndex->dataInt() + begin);
+    std::copy_n(&tile.orientations[0][0], 4 * count, _context.ptmOrientation->dataDouble() + 4 * begin);
+    std::copy_n(&tile.deformationGradients[0][0], 9 * count, _context.ptmDeformationGradient->dataDouble() + 9 * begin);
+
+    const size_t stride = _context.neighborLists->componentCount();
+    const size_t width = std::min<size_t>(stride, PTM::MAX_OUTPUT_NEIGHBORS);
+    AtomIndex* neighborLists = _context.neighborLists->dataAtomIndex() + stride * begin;
+    for(size_t a = 0; a < count; ++a){
+        std::copy_n(tile.templateNeighbors[a], width, neighborLists + stride * a);
     }
 }
 
@@ -188,7 +190,7 @@ void StructureAnalysis::computeMaximumNeighborDistanceFromPTM(){
         [&](size_t i){
             double localMaxDist = 0.0;
             for(int j = 0; j < M; ++j){
-                int nb = _context.neighborLists->getIntComponent(i, j);
+                AtomIndex nb = _context.neighborLists->getAtomIndexComponent(i, j);
                 if(nb < 0) break;
 
                 Vector3 delta = pos[nb] - pos[i];
@@ -230,55 +232,82 @@ void StructureAnalysis::determineLocalStructuresWithPTM() {
     _context.correspondencesCode = std::make_shared<ParticleProperty>(N, DataType::Int64, 1, 0, true);
 
     // Clear arrays for second pass
-    std::fill(_context.neighborLists->dataInt(),
-              _context.neighborLists->dataInt() + _context.neighborLists->size()*_context.neighborLists->componentCount(), -1);
+    std::fill(_context.neighborLists->dataAtomIndex(),
+              _context.neighborLists->dataAtomIndex() + _context.neighborLists->size()*_context.neighborLists->componentCount(), AtomIndex(-1));
     std::fill(_context.structureTypes->dataInt(),
               _context.structureTypes->dataInt() + _context.structureTypes->size(), LATTICE_OTHER);
 
     std::vector<uint64_t> cached(N, 0ull);
 
+    // The diamond templates also read the neighbor ordering of the first
+    // neighbors, so every atom's ordering is computed before any atom is
+    // matched.
     tbb::parallel_for(tbb::blocked_range<size_t>(0, N), [&](const auto &r){
         PTM::Kernel kernel(ptm);
         for(size_t i = r.begin(); i < r.end(); ++i){
             kernel.cacheNeighbors(i, &cached[i]);
-            StructureType type = kernel.identifyStructure(i, cached);
-
-            const double rmsd = kernel.rmsd();
-            _context.ptmRmsd->setDouble(i, rmsd);
-
-            auto* c = reinterpret_cast<uint64_t*>(_context.correspondencesCode->data());
-            c[i] = kernel.correspondencesCode();
-
-            // Only keep atoms whose RMSD <= finalCutoff
-            if(type == StructureType::OTHER || rmsd > _rmsd){
-                continue;
-            }
+        }
+    });
 
-            _context.structureTypes->setInt(i, type);
-            storeNeighborIndices(kernel, i);
-            storeOrientationData(kernel, i);
-            storeDeformationGradient(kernel, i);
-            _context.templateIndex->setInt(i, kernel.bestTemplateIndex());
+    // Atoms are matched in tiles whose results are stored in blocks; only
+    // atoms whose RMSD <= _rmsd keep their structure.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, N, PTM::TileSize), [&](const auto &r){
+        PTM::Kernel kernel(ptm);
+        auto tile = std::make_unique<PTM::Tile>();
+        for(size_t begin = r.begin(); begin < r.end(); begin += PTM::TileSize){
+            const size_t end = std::min(begin + PTM::TileSize, r.end());
+            kernel.identifyTile(*tile, begin, end, cached, _rmsd);
+            storePTMTile(*tile);
         }
     });
 }
 
+// The input lattice is dispatched once per frame; each instantiation runs
+// CNA with the coordination number and shell layout of that lattice fixed
+// at compile time.
 void StructureAnalysis::identifyStructuresCNA(){
     int maxNeighborListSize = std::min((int)_context.neighborLists->componentCount() + 1, (int)MAX_NEIGHBORS);
-    NearestNeighborFinder neighFinder(maxNeighborListSize);
-    if(!neighFinder.prepare(_context.positions, _context.simCell, _context.particleSelection)){
-        throw std::runtime_error("Error in neighFinder.preapre(...)");
+    auto neighFinder = _context.neighborCache->nearestNeighbors(maxNeighborListSize, _context.particleSelection);
+
+    switch(_coordStructures.inputCrystalType()){
+        case LATTICE_FCC:
+            identifyStructuresCNA<LATTICE_FCC>(*neighFinder, maxNeighborListSize);
+            break;
+        case LATTICE_HCP:
+            identifyStructuresCNA<LATTICE_HCP>(*neighFinder, maxNeighborListSize);
+            break;
+        case LATTICE_BCC:
+            identifyStructuresCNA<LATTICE_BCC>(*neighFinder, maxNeighborListSize);
+            break;
+        case LATTICE_CUBIC_DIAMOND:
+            identifyStructuresCNA<LATTICE_CUBIC_DIAMOND>(*neighFinder, maxNeighborListSize);
+            break;
+        case LATTICE_HEX_DIAMOND:
+            identifyStructuresCNA<LATTICE_HEX_DIAMOND>(*neighFinder, maxNeighborListSize);
+            break;
+        default:
+            _maximumNeighborDistance = 0;
+            break;
     }
+}
 
+template<LatticeStructureType Lattice>
+void StructureAnalysis::identifyStructuresCNA(const NearestNeighborFinder& neighFinder, int maxNeighborListSize){
+    // FCC, HCP and BCC shells are classified in blocks. Diamond shells are
+    // gathered from a table of first neighbors, so every atom is queried once
+    // instead of once for itself and once for each of its first neighbors.
+    constexpr bool diamond = Lattice == LATTICE_CUBIC_DIAMOND || Lattice == LATTICE_HEX_DIAMOND;
+    DiamondNeighborTable firstNeighbors;
+    if constexpr(diamond){
+        firstNeighbors = _coordStructures.computeDiamondNeighborTable(neighFinder, maxNeighborListSize);
+    }
     _maximumNeighborDistance = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, _context.atomCount()),
-        0.0, [this, &neighFinder](const tbb::blocked_range<size_t>& r, double max_dist_so_far) -> double {
-            for(size_t index = r.begin(); index != r.end(); ++index){
-                double localMaxDistance = _coordStructures.determineLocalStructure(neighFinder, index, _context.neighborLists);
-                if (localMaxDistance > max_dist_so_far) {
-                    max_dist_so_far = localMaxDistance;
-                }
+        0.0, [this, &neighFinder, &firstNeighbors, maxNeighborListSize](const tbb::blocked_range<size_t>& r, double max_dist_so_far) -> double {
+            if constexpr(diamond){
+                return std::max(max_dist_so_far, _coordStructures.determineLocalStructures<Lattice>(firstNeighbors, r.begin(), r.end(), _context.neighborLists));
+            }else{
+                return std::max(max_dist_so_far, _coordStructures.determineLocalStructures<Lattice>(neighFinder, maxNeighborListSize, r.begin(), r.end(), _context.neighborLists));
             }
-            return max_dist_so_far;
         },
         [](double a, double b) -> double {
             return std::max(a, b);
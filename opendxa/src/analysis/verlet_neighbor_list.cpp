@@ -0,0 +1,189 @@
+#include <opendxa/analysis/verlet_neighbor_list.h>
+#include <opendxa/analysis/cutoff_neighbor_finder.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+namespace OpenDXA{
+
+bool VerletNeighborList::update(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell, const std::vector<AtomId>* ids){
+    if(isValid(cutoffRadius, positions, simCell, ids)){
+        _positions = positions->constDataPoint3();
+        return false;
+    }
+    rebuild(cutoffRadius, positions, simCell, ids);
+    return true;
+}
+
+// Checks whether the stored list still covers every pair within the cutoff.
+// Displacements are measured with the minimum image convention, and the image
+// each particle was wrapped into is recorded so queries can reconstruct the
+// continuous trajectory from the wrapped positions.
+bool VerletNeighborList::isValid(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell, const std::vector<AtomId>* ids){
+    if(_neighborStart.empty() || cutoffRadius != _cutoffRadius || !(simCell == _simCell)) return false;
+    const size_t count = positions->size();
+    if(count != _referencePositions.size()) return false;
+    if(ids && *ids != _ids && !reorder(*ids)) return false;
+
+    const Point3* p = positions->constDataPoint3();
+    const double maxDisplacement = 0.5 * _skin;
+    const double maxDisplacementSquared = maxDisplacement * maxDisplacement;
+    const bool exceeded = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, count), false,
+        [&](const tbb::blocked_range<size_t>& r, bool exceeded){
+            for(size_t i = r.begin(); i < r.end() && !exceeded; i++){
+                Vector3 d = p[i] - _referencePositions[i];
+                Vector_3<int8_t> image = Vector_3<int8_t>::Zero();
+                for(size_t k = 0; k < 3; k++){
+                    if(!simCell.pbcFlags()[k]) continue;
+                    double s = std::round(simCell.inverseMatrix().prodrow(d, k));
+                    if(std::abs(s) > 100){
+                        exceeded = true;
+                        break;
+                    }
+                    image[k] = (int8_t)-s;
+                    d -= s * simCell.matrix().column(k);
+                }
+                _imageShifts[i] = image;
+                if(d.squaredLength() > maxDisplacementSquared) exceeded = true;
+            }
+            return exceeded;
+        },
+        std::logical_or<bool>());
+    return !exceeded;
+}
+
+// Moves the stored rows into the order of ids and renumbers the neighbor
+// indices to match. Returns false if ids holds a different set of particles.
+bool VerletNeighborList::reorder(const std::vector<AtomId>& ids){
+    const size_t count = ids.size();
+    if(_ids.size() != count) return false;
+
+    std::unordered_map<AtomId, size_t> storedRows;
+    storedRows.reserve(count);
+    for(size_t i = 0; i < count; i++){
+        storedRows.emplace(_ids[i], i);
+    }
+    std::vector<size_t> oldRow(count);
+    std::vector<size_t> newRow(count, std::numeric_limits<size_t>::max());
+    for(size_t i = 0; i < count; i++){
+        auto it = storedRows.find(ids[i]);
+        if(it == storedRows.end() || newRow[it->second] != std::numeric_limits<size_t>::max()) return false;
+        oldRow[i] = it->second;
+        newRow[it->second] = i;
+    }
+
+    std::vector<size_t> neighborStart(count + 1, 0);
+    for(size_t i = 0; i < count; i++){
+        neighborStart[i + 1] = neighborStart[i] + _neighborStart[oldRow[i] + 1] - _neighborStart[oldRow[i]];
+    }
+    std::vector<size_t> neighborIndices(_neighborIndices.size());
+    std::vector<Vector_3<int8_t>> neighborShifts(_neighborShifts.size());
+    std::vector<Point3> referencePositions(count);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count), [&](const tbb::blocked_range<size_t>& r){
+        for(size_t i = r.begin(); i < r.end(); i++){
+            size_t entry = neighborStart[i];
+            for(size_t old = _neighborStart[oldRow[i]]; old < _neighborStart[oldRow[i] + 1]; old++, entry++){
+                neighborIndices[entry] = newRow[_neighborIndices[old]];
+                neighborShifts[entry] = _neighborShifts[old];
+            }
+            referencePositions[i] = _referencePositions[oldRow[i]];
+        }
+    });
+
+    _neighborStart.swap(neighborStart);
+    _neighborIndices.swap(neighborIndices);
+    _neighborShifts.swap(neighborShifts);
+    _referencePositions.swap(referencePositions);
+    _ids = ids;
+    return true;
+}
+
+void VerletNeighborList::rebuild(double cutoffRadius, ParticleProperty* positions, const SimulationCell& simCell, const std::vector<AtomId>* ids){
+    CutoffNeighborFinder finder;
+    finder.prepare(cutoffRadius + _skin, positions, simCell);
+
+    const size_t count = positions->size();
+    _neighborStart.assign(count + 1, 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count), [&](const tbb::blocked_range<size_t>& r){
+        for(size_t i = r.begin(); i < r.end(); i++){
+            size_t n = 0;
+            for(CutoffNeighborFinder::Query q(finder, i); !q.atEnd(); q.next()) n++;
+            _neighborStart[i + 1] = n;
+        }
+    });
+    for(size_t i = 0; i < count; i++){
+        _neighborStart[i + 1] += _neighborStart[i];
+    }
+
+    _neighborIndices.resize(_neighborStart[count]);
+    _neighborShifts.resize(_neighborStart[count]);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count), [&](const tbb::blocked_range<size_t>& r){
+        for(size_t i = r.begin(); i < r.end(); i++){
+            size_t entry = _neighborStart[i];
+            for(CutoffNeighborFinder::Query q(finder, i); !q.atEnd(); q.next(), entry++){
+                _neighborIndices[entry] = q.current();
+                _neighborShifts[entry] = q.unwrappedPbcShift();
+            }
+        }
+    });
+
+    const Point3* p = positions->constDataPoint3();
+    _referencePositions.assign(p, p + count);
+    _imageShifts.assign(count, Vector_3<int8_t>::Zero());
+    if(ids){
+        _ids = *ids;
+    }else{
+        _ids.clear();
+    }
+    _positions = p;
+    _simCell = simCell;
+    _cutoffRadius = cutoffRadius;
+    _rebuildCount++;
+}
+
+VerletNeighborList::Query::Query(const VerletNeighborList& list, size_t particleIndex)
+    : _list(list), _centerIndex(particleIndex){
+    assert(particleIndex + 1 < _list._neighborStart.size());
+    _entry = _list._neighborStart[particleIndex];
+    _entryEnd = _list._neighborStart[particleIndex + 1];
+    _atEnd = false;
+    next();
+}
+
+// Advances to the next stored candidate that is within the cutoff at the
+// current positions.
+void VerletNeighborList::Query::next(){
+    assert(!_atEnd);
+
+    const Point3& center = _list._positions[_centerIndex];
+    const Vector_3<int8_t>& centerImage = _list._imageShifts[_centerIndex];
+    const AffineTransformation& cell = _list._simCell.matrix();
+    const double cutoffSquared = _list.cutoffRadiusSquared();
+    while(_entry != _entryEnd){
+        const size_t neighbor = _list._neighborIndices[_entry];
+        const Vector_3<int8_t>& stored = _list._neighborShifts[_entry];
+        const Vector_3<int8_t>& image = _list._imageShifts[neighbor];
+        ++_entry;
+
+        _pbcShift = Vector_3<int8_t>(
+            stored.x() + image.x() - centerImage.x(),
+            stored.y() + image.y() - centerImage.y(),
+            stored.z() + image.z() - centerImage.z());
+        _delta = _list._positions[neighbor] - center + cell * Vector3(_pbcShift.x(), _pbcShift.y(), _pbcShift.z());
+        _distSq = _delta.squaredLength();
+        if(_distSq <= cutoffSquared){
+            _neighborIndex = neighbor;
+            return;
+        }
+    }
+
+    _atEnd = true;
+    _neighborIndex = std::numeric_limits<size_t>::max();
+}
+
+}
@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/atomic_strain.h>
+#include <opendxa/core/spatial_sort.h>
 #include <opendxa/analysis/atomic_strain.h>
 #include <opendxa/utilities/concurrence/parallel_system.h>
 #include <spdlog/spdlog.h>
@@ -41,27 +42,11 @@ void AtomicStrainAnalyzer::setOptions(
 }
 
 std::shared_ptr<ParticleProperty> AtomicStrainAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != frame.natoms){
-        spdlog::error("Failed to allocate ParticleProperty for positions with correct size");
-        return nullptr;
-    }
-
-    Point3* data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer from ParticleProperty");
-        return nullptr;  
-    }
-
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
-
-    return property;
+    return LammpsParser::createPositionProperty(frame);
 }
 
 json AtomicStrainAnalyzer::compute(const LammpsParser::Frame& currentFrame, const std::string &outputFilename){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(currentFrame));
     const LammpsParser::Frame &refFrame = _hasReference ? _referenceFrame : currentFrame;
 
     auto positions = createPositionProperty(currentFrame);
@@ -87,15 +72,9 @@ json AtomicStrainAnalyzer::computeAtomicStrain(
         throw std::runtime_error("Cannot calculate atomic strain. Number of atoms in current and reference frames does not match.");
     }
 
-    auto refPositions = std::make_shared<ParticleProperty>(
-        refFrame.positions.size(),
-        ParticleProperty::PositionProperty,
-        3,
-        false
-    );
-
-    for(std::size_t i = 0; i < refFrame.positions.size(); i++){
-        refPositions->setPoint3(i, refFrame.positions[i]);
+    auto refPositions = createPositionProperty(refFrame);
+    if(!refPositions){
+        throw std::runtime_error("Cannot calculate atomic strain. Reference frame has no positions.");
     }
 
     auto identifiers = std::make_shared<ParticleProperty>(
@@ -113,8 +92,8 @@ json AtomicStrainAnalyzer::computeAtomicStrain(
     );
 
     for(std::size_t i = 0; i < currentFrame.ids.size(); i++){
-        identifiers->setInt(i, currentFrame.ids[i]);
-        refIdentifiers->setInt(i, refFrame.ids[i]);
+        identifiers->setInt64(i, currentFrame.ids[i]);
+        refIdentifiers->setInt64(i, refFrame.ids[i]);
     }
 
     AtomicStrainModifier::AtomicStrainEngine engine(
@@ -143,7 +122,7 @@ json AtomicStrainAnalyzer::computeAtomicStrain(
     auto shear = engine.shearStrains();
     auto volumetric = engine.volumetricStrains();
 
-    size_t n = currentFrame.positions.size();
+    size_t n = static_cast<size_t>(currentFrame.natoms);
     for(size_t i = 0; i < n; i++){
         if(shear){
             double s = shear->getDouble(i);
@@ -179,7 +158,8 @@ json AtomicStrainAnalyzer::computeAtomicStrain(
         auto invalid = engine.invalidParticles();
 
         // per atom properties
-        for(std::size_t i = 0; i < currentFrame.positions.size(); i++){
+        for(std::size_t row = 0; row < static_cast<std::size_t>(currentFrame.natoms); row++){
+            const std::size_t i = _jsonExporter.atomAt(row);
             json a;
             a["id"] = currentFrame.ids[i];
             a["shear_strain"] = shear ? shear->getDouble(i) : 0.0;
@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/centrosymmetry.h>
+#include <opendxa/core/spatial_sort.h>
 #include <spdlog/spdlog.h>
 
 namespace OpenDXA {
@@ -18,19 +19,11 @@ void CentroSymmetryAnalyzer::setMode(CentroSymmetryAnalysis::CSPMode mode){
 }
 
 std::shared_ptr<ParticleProperty> CentroSymmetryAnalyzer::createPositionProperty(const LammpsParser::Frame& frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-    if(!property || property->size() != (std::size_t)frame.natoms) return nullptr;
-
-    Point3* data = property->dataPoint3();
-    if(!data) return nullptr;
-
-    for(std::size_t i = 0; i < frame.positions.size() && i < (std::size_t)frame.natoms; i++){
-        data[i] = frame.positions[i];
-    }
-    return property;
+    return LammpsParser::createPositionProperty(frame);
 }
 
 json CentroSymmetryAnalyzer::compute(const LammpsParser::Frame& frame, const std::string& outputBase){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(frame));
     auto start = std::chrono::high_resolution_clock::now();
 
     json result;
@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/cluster_analysis.h>
+#include <opendxa/core/spatial_sort.h>
 #include <spdlog/spdlog.h>
 
 namespace OpenDXA{
@@ -10,7 +11,8 @@ ClusterAnalysisAnalyzer::ClusterAnalysisAnalyzer()
       _sortBySize(true),
       _unwrapParticleCoordinates(false),
       _computeCentersOfMass(false),
-      _computeRadiusOfGyration(false){}
+      _computeRadiusOfGyration(false),
+      _searchPrecision(SearchPrecision::Double){}
 
 void ClusterAnalysisAnalyzer::setCutoff(double cutoff){
     _cutoff = cutoff;
@@ -28,29 +30,17 @@ void ClusterAnalysisAnalyzer::setOptions(
     _computeRadiusOfGyration = computeRadiusOfGyration;
 }
 
+void ClusterAnalysisAnalyzer::setSearchPrecision(SearchPrecision precision){
+    _searchPrecision = precision;
+}
 
-std::shared_ptr<ParticleProperty> ClusterAnalysisAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != frame.natoms){
-        spdlog::error("Failed to allocate ParticleProperty for positions with correct size");
-        return nullptr;
-    }
-
-    Point3* data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer from ParticleProperty");
-        return nullptr;
-    }
-
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
 
-    return property;
+std::shared_ptr<ParticleProperty> ClusterAnalysisAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
+    return LammpsParser::createPositionProperty(frame);
 }
 
 json ClusterAnalysisAnalyzer::compute(const LammpsParser::Frame& frame, const std::string& outputFilename){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(frame));
     auto startTime = std::chrono::high_resolution_clock::now();
     json result;
 
@@ -80,6 +70,7 @@ json ClusterAnalysisAnalyzer::compute(const LammpsParser::Frame& frame, const st
         _computeCentersOfMass,
         _computeRadiusOfGyration
     );
+    engine.setPrecision(_searchPrecision);
 
     engine.perform();
 
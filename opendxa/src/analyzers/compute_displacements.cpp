@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/compute_displacements.h>
+#include <opendxa/core/spatial_sort.h>
 #include <spdlog/spdlog.h>
 
 namespace OpenDXA{
@@ -21,24 +22,7 @@ void DisplacementsAnalyzer::setOptions(bool useMinimumImageConvention, ComputeDi
 }
 
 std::shared_ptr<ParticleProperty> DisplacementsAnalyzer::createPositionProperty(const LammpsParser::Frame& frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != static_cast<std::size_t>(frame.natoms)){
-        spdlog::error("Failed to allocate ParticleProperty for positions with correct size");
-        return nullptr;
-    }
-
-    Point3* data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer from ParticleProperty");
-        return nullptr;
-    }
-
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
-
-    return property;
+    return LammpsParser::createPositionProperty(frame);
 }
 
 std::shared_ptr<ParticleProperty> DisplacementsAnalyzer::createIdentifierProperty(const LammpsParser::Frame& frame){
@@ -50,13 +34,14 @@ std::shared_ptr<ParticleProperty> DisplacementsAnalyzer::createIdentifierPropert
     }
 
     for(size_t i = 0; i < frame.ids.size(); i++){
-        property->setInt(i, frame.ids[i]);
+        property->setInt64(i, frame.ids[i]);
     }
 
     return property;
 }
 
 json DisplacementsAnalyzer::compute(const LammpsParser::Frame& currentFrame, const std::string &outputFilename){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(currentFrame));
     auto startTime = std::chrono::high_resolution_clock::now();
     json result;
 
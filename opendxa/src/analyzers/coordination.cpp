@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/coordination.h>
+#include <opendxa/core/spatial_sort.h>
 #include <opendxa/utilities/concurrence/parallel_system.h>
 #include <spdlog/spdlog.h>
 
@@ -8,7 +9,8 @@ using namespace OpenDXA::Particles;
 
 CoordinationAnalyzer::CoordinationAnalyzer()
     : _cutoff(3.2),
-      _rdfBins(500){}
+      _rdfBins(500),
+      _searchPrecision(SearchPrecision::Double){}
 
 void CoordinationAnalyzer::setCutoff(double cutoff){
     _cutoff = cutoff;
@@ -18,25 +20,20 @@ void CoordinationAnalyzer::setRdfBins(int bins){
     _rdfBins = bins;
 }
 
-std::shared_ptr<ParticleProperty> CoordinationAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != frame.natoms){
-        spdlog::error("Failed to allocate ParticleProperty for positions with correct size");
-        return nullptr;
-    }
-
-    Point3* data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer from ParticleProperty");
-        return nullptr;
+void CoordinationAnalyzer::setNeighborSkin(double skin){
+    if(skin > 0){
+        _neighborList = std::make_unique<VerletNeighborList>(skin);
+    }else{
+        _neighborList.reset();
     }
+}
 
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
+void CoordinationAnalyzer::setSearchPrecision(SearchPrecision precision){
+    _searchPrecision = precision;
+}
 
-    return property;
+std::shared_ptr<ParticleProperty> CoordinationAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
+    return LammpsParser::createPositionProperty(frame);
 }
 
 bool CoordinationAnalyzer::validateSimulationCell(const SimulationCell& cell){
@@ -61,6 +58,7 @@ bool CoordinationAnalyzer::validateSimulationCell(const SimulationCell& cell){
 }
 
 json CoordinationAnalyzer::compute(const LammpsParser::Frame &frame, const std::string& outputFile){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(frame));
     auto startTime = std::chrono::high_resolution_clock::now();
     json result;
 
@@ -93,6 +91,13 @@ json CoordinationAnalyzer::compute(const LammpsParser::Frame &frame, const std::
         _cutoff,
         _rdfBins
     );
+    engine.setPrecision(_searchPrecision);
+
+    if(_neighborList){
+        const bool rebuilt = _neighborList->update(_cutoff, positions.get(), frame.simulationCell, &frame.ids);
+        spdlog::debug("Verlet neighbor list {} (skin = {}, {} rebuilds)", rebuilt ? "rebuilt" : "reused", _neighborList->skin(), _neighborList->rebuildCount());
+        engine.setNeighborList(_neighborList.get());
+    }
 
     engine.perform(),
     coordNumber.transferComputationResults(&engine);
@@ -102,8 +107,8 @@ json CoordinationAnalyzer::compute(const LammpsParser::Frame &frame, const std::
 
     auto coordProp = engine.coordinationNumbers();
     std::vector<int> coord(frame.natoms);
-    for(int i = 0; i < frame.natoms; i++){
-        coord[i] = coordProp->getInt(i);
+    for(size_t row = 0; row < static_cast<size_t>(frame.natoms); row++){
+        coord[row] = coordProp->getInt(_jsonExporter.atomAt(row));
     }
 
     result["is_failed"] = false;
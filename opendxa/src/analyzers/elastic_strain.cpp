@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/elastic_strain.h>
+#include <opendxa/core/spatial_sort.h>
 #include <opendxa/analysis/elastic_strain.h>
 #include <opendxa/utilities/concurrence/parallel_system.h>
 #include <spdlog/spdlog.h>
@@ -44,27 +45,11 @@ void ElasticStrainAnalyzer::setParameters(
 }
 
 std::shared_ptr<ParticleProperty> ElasticStrainAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != frame.natoms){
-        spdlog::error("Failed to allocate ParticleProperty for positions with correct size");
-        return nullptr;
-    }
-
-    Point3* data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer from ParticleProperty");
-        return nullptr;
-    }
-
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
-
-    return property;
+    return LammpsParser::createPositionProperty(frame);
 }
 
 json ElasticStrainAnalyzer::compute(const LammpsParser::Frame &frame, const std::string &outputFilename){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(frame));
     auto startTime = std::chrono::high_resolution_clock::now();
     json result;
 
@@ -74,6 +59,10 @@ json ElasticStrainAnalyzer::compute(const LammpsParser::Frame &frame, const std:
         return result;
     }
 
+    if(!StructureAnalysis::checkAtomCount(frame.natoms, result)){
+        return result;
+    }
+
     auto positions = createPositionProperty(frame);
     if(!positions){
         result["is_failed"] = true;
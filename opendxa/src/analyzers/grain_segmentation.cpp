@@ -1,4 +1,5 @@
 #include <opendxa/analyzers/grain_segmentation.h>
+#include <opendxa/core/spatial_sort.h>
 #include <opendxa/utilities/concurrence/parallel_system.h>
 #include <spdlog/spdlog.h>
 #include <map>
@@ -9,6 +10,7 @@ using namespace OpenDXA::Particles;
 
 GrainSegmentationAnalyzer::GrainSegmentationAnalyzer()
     : _rmsd(0.10f),
+      _searchPrecision(SearchPrecision::Double),
       _identificationMode(StructureAnalysis::Mode::PTM),
       _adoptOrphanAtoms(true),
       _minGrainAtomCount(100),
@@ -23,6 +25,10 @@ void GrainSegmentationAnalyzer::setRMSD(float rmsd){
     _rmsd = rmsd;
 }
 
+void GrainSegmentationAnalyzer::setSearchPrecision(SearchPrecision precision){
+    _searchPrecision = precision;
+}
+
 void GrainSegmentationAnalyzer::setParameters(
     bool adoptOrphanAtoms,
     int minGrainAtomCount,
@@ -36,27 +42,11 @@ void GrainSegmentationAnalyzer::setParameters(
 }
 
 std::shared_ptr<ParticleProperty> GrainSegmentationAnalyzer::createPositionProperty(const LammpsParser::Frame &frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != frame.natoms){
-        spdlog::error("Failed to allocate ParticleProperty for positions with correct size");
-        return nullptr;
-    }
-
-    Point3* data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer from ParticleProperty");
-        return nullptr;
-    }
-
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
-
-    return property;
+    return LammpsParser::createPositionProperty(frame);
 }
 
 json GrainSegmentationAnalyzer::compute(const LammpsParser::Frame &frame, const std::string &outputFilename){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(frame));
     json result;
     
     if(frame.natoms <= 0){
@@ -65,6 +55,10 @@ json GrainSegmentationAnalyzer::compute(const LammpsParser::Frame &frame, const
         return result;
     }
 
+    if(!StructureAnalysis::checkAtomCount(frame.natoms, result)){
+        return result;
+    }
+
     auto positions = createPositionProperty(frame);
     if(!positions){
         result["is_failed"] = true;
@@ -86,6 +80,7 @@ json GrainSegmentationAnalyzer::compute(const LammpsParser::Frame &frame, const
         structuretypes.get(),
         std::move(preferredOrientations)
     );
+    context.neighborCache->setPrecision(_searchPrecision);
 
     auto structureAnalysis = std::make_unique<StructureAnalysis>(
         context,
@@ -101,7 +96,7 @@ json GrainSegmentationAnalyzer::compute(const LammpsParser::Frame &frame, const
 
     std::vector<int> extractedStructureTypes;
     extractedStructureTypes.reserve(frame.natoms);
-    for(int i = 0; i < frame.natoms; i++){
+    for(size_t i = 0; i < static_cast<size_t>(frame.natoms); i++){
         extractedStructureTypes.push_back(structureAnalysis->context().structureTypes->getInt(i));
     }
 
@@ -144,9 +139,11 @@ json GrainSegmentationAnalyzer::performGrainSegmentation(
         }
 
         // Create shared pointers for the engine
-        auto positions = std::make_shared<ParticleProperty>(frame.natoms, ParticleProperty::PositionProperty, 0, true);
-        for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-            positions->setPoint3(i, frame.positions[i]);
+        auto positions = createPositionProperty(frame);
+        if(!positions){
+            result["is_failed"] = true;
+            result["error"] = "No position data available";
+            return result;
         }
 
         auto structures = std::make_shared<ParticleProperty>(frame.natoms, DataType::Int, 1, 0, false);
@@ -180,7 +177,8 @@ json GrainSegmentationAnalyzer::performGrainSegmentation(
             correspondences,
             &frame.simulationCell,
             _handleCoherentInterfaces,
-            _outputBonds
+            _outputBonds,
+            ctx.neighborCache
         );
 
         engine1->perform();
@@ -201,8 +199,8 @@ json GrainSegmentationAnalyzer::performGrainSegmentation(
 
         auto atomClusters = engine2.atomClusters();
         std::vector<int> grainIds(frame.natoms, 0);
-        for(size_t i = 0; i < static_cast<size_t>(frame.natoms); i++){
-            grainIds[i] = atomClusters->getInt(i);
+        for(size_t row = 0; row < static_cast<size_t>(frame.natoms); row++){
+            grainIds[row] = atomClusters->getInt(_jsonExporter.atomAt(row));
         }
 
         json grainData;
@@ -225,12 +223,16 @@ json GrainSegmentationAnalyzer::performGrainSegmentation(
 
         try{
             std::map<int, json> grainGroups;
-            for(size_t i = 0; i < static_cast<size_t>(frame.natoms); i++){
-                int gid = grainIds[i];
+            const Point3* positionData = frame.positionData();
+            for(size_t row = 0; row < static_cast<size_t>(frame.natoms); row++){
+                const size_t i = _jsonExporter.atomAt(row);
+                int gid = grainIds[row];
                 json atomData;
-                atomData["id"] = i;
-                if(i < frame.positions.size()){
-                    const auto &p = frame.positions[i];
+                // The dump row, as before spatial sorting existed; atomAt() maps
+                // it back to the sorted storage.
+                atomData["id"] = row;
+                if(positionData){
+                    const auto &p = positionData[i];
                     atomData["pos"] = {p.x(), p.y(), p.z()};
                 }else{
                     atomData["pos"] = {0.0, 0.0, 0.0};
@@ -1,5 +1,8 @@
 #include <opendxa/core/coordination_structures.h>
 #include <opendxa/analysis/analysis_context.h>
+#include <opendxa/analysis/distance_kernels.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 namespace OpenDXA{
 
@@ -61,195 +64,322 @@ void CoordinationStructures::generateCellTooSmallError(int dimension){
 }
 
 int CoordinationStructures::getCoordinationNumber() const{
-	switch(_inputCrystalType){
-		case LATTICE_FCC:
-		case LATTICE_HCP:
-			return 12;
-		case LATTICE_BCC:
-			return 14;
-		case LATTICE_CUBIC_DIAMOND:
-		case LATTICE_HEX_DIAMOND:
-			return 16;
-        case LATTICE_SC:
-            return 6;
-		default:
-			return 0;
+	return latticeCoordinationNumber(_inputCrystalType);
+}
+
+namespace {
+
+// Lattices whose CNA shell is made of the nearest neighbors alone
+constexpr bool isShellLattice(LatticeStructureType lattice){
+	return lattice == LATTICE_FCC || lattice == LATTICE_HCP || lattice == LATTICE_BCC;
+}
+
+// Lattices whose CNA shell is built from first and second neighbors
+constexpr bool isDiamondLattice(LatticeStructureType lattice){
+	return lattice == LATTICE_CUBIC_DIAMOND || lattice == LATTICE_HEX_DIAMOND;
+}
+
+// Atoms per block of the batched CNA path
+constexpr size_t CNABlockSize = 16;
+
+// Coordinate of the unused neighbor slots of a shell, far from every real one
+constexpr double UnusedNeighborCoordinate = 1e100;
+
+}
+
+// Local cutoff of an FCC, HCP or BCC atom: halfway between the first and
+// second neighbor shells, scaled by the mean distance of the nearest neighbors.
+template<LatticeStructureType Lattice>
+double CoordinationStructures::computeShellCutoff(const NearestNeighborFinder::Query<MAX_NEIGHBORS>& neighQuery) const{
+	static_assert(isShellLattice(Lattice));
+	constexpr int nearestNeighbors = (Lattice == LATTICE_BCC) ? 8 : 12;
+	double localScaling = 0;
+	for(int neighbor = 0; neighbor < nearestNeighbors; neighbor++){
+		localScaling += sqrt(neighQuery.results()[neighbor].distanceSq);
+	}
+	localScaling /= nearestNeighbors;
+	if constexpr(Lattice == LATTICE_BCC){
+		return localScaling / (sqrt(3.0) / 2.0) * 0.5 * (1.0 + sqrt(2.0));
+	}else{
+		return localScaling * (1.0f + sqrt(2.0f)) * 0.5f;
 	}
 }
 
+template<LatticeStructureType Lattice>
 double CoordinationStructures::computeLocalCutoff(
 	const NearestNeighborFinder& neighList, 
 	const NearestNeighborFinder::Query<MAX_NEIGHBORS>& neighQuery,
 	int numNeighbors,
-	int coordinationNumber,
-	int particleIndex,
-	int* neighborIndices,
+	AtomIndex particleIndex,
+	AtomIndex* neighborIndices,
 	Vector3* neighborVectors,
 	NeighborBondArray& neighborArray
 ) const { 
-	double localScaling = 0;
-	double localCutoff = 0;
-	
-	switch(_inputCrystalType){
-		case LATTICE_FCC:
-		case LATTICE_HCP:
-			for(int neighbor = 0; neighbor < 12; neighbor++){
-				localScaling += sqrt(neighQuery.results()[neighbor].distanceSq);
-			}
-			localScaling /= 12;
-			localCutoff = localScaling * (1.0f + sqrt(2.0f)) * 0.5f;
-			break;
-		case LATTICE_BCC:
-			for(int neighbor = 0; neighbor < 8; neighbor++){
-				localScaling += sqrt(neighQuery.results()[neighbor].distanceSq);
-			}
-			localScaling /= 8;
-			localCutoff = localScaling / (sqrt(3.0) / 2.0) * 0.5 * (1.0 + sqrt(2.0));
-			break;
-		case LATTICE_CUBIC_DIAMOND:
-		case LATTICE_HEX_DIAMOND: {
-			// Generate list of second nearest neighbors
-			int outputIndex = 4;
-			for(int i = 0; i < 4; i++){
-				const Vector3& v0 = neighQuery.results()[i].delta;
-				neighborVectors[i] = v0;
-				neighborIndices[i] = neighQuery.results()[i].index;
-				
-				NearestNeighborFinder::Query<MAX_NEIGHBORS> neighQuery2(neighList);
-				neighQuery2.findNeighbors(neighList.particlePos(neighborIndices[i]));
-				if(neighQuery2.results().size() < 4) return 0.0;
-
-				for(int j = 0; j < 4; j++){
-					Vector3 v = v0 + neighQuery2.results()[j].delta;
-					if(neighQuery2.results()[j].index == particleIndex && v.isZero()) continue;
-					if(outputIndex == 16) return 0;
-
-					neighborIndices[outputIndex] = neighQuery2.results()[j].index;
-					neighborVectors[outputIndex] = v;
-					neighborArray.setNeighborBond(i, outputIndex, true);
-					outputIndex++;
-				}
+	constexpr int coordinationNumber = latticeCoordinationNumber(Lattice);
+
+	if constexpr(isShellLattice(Lattice)){
+		const double localCutoff = computeShellCutoff<Lattice>(neighQuery);
+		const double localCutoffSquared = localCutoff * localCutoff;
+
+		// Make sure the (N + 1) -th atom is beyond the cutoff radius (if it exists)
+		if(numNeighbors > coordinationNumber && neighQuery.results()[coordinationNumber].distanceSq <= localCutoffSquared){
+			return 0.0;
+		}
 
-                // consistency check: each of the first 4 contributes 3 second neighbors => outputIndex should be (i*3)+7 after loop for i
-				if(outputIndex != (i * 3) + 7) return 0;
+		// Compute common neighbor fit-flag array
+		for(int ni1 = 0; ni1 < coordinationNumber; ni1++){
+			neighborIndices[ni1] = neighQuery.results()[ni1].index;
+			neighborVectors[ni1] = neighQuery.results()[ni1].delta;
+			neighborArray.setNeighborBond(ni1, ni1, false);
+			for(int ni2 = ni1 + 1; ni2 < coordinationNumber; ni2++){
+				neighborArray.setNeighborBond(ni1, ni2, (neighQuery.results()[ni1].delta - neighQuery.results()[ni2].delta).squaredLength() <= localCutoffSquared);
 			}
+		}
+		return localCutoff;
+	}else{
+		static_assert(isDiamondLattice(Lattice));
+		for(int i = 0; i < 4; i++){
+			neighborIndices[i] = neighQuery.results()[i].index;
+			neighborVectors[i] = neighQuery.results()[i].delta;
+		}
 
-            // Compute local scale factor from the 12 second neighbors (positions 4..15)
-			localScaling = 0;
-			for(int neighbor = 4; neighbor < 16; neighbor++){
-				localScaling += neighborVectors[neighbor].length();
+		// Look up the first neighbors of each first neighbor with a query of
+		// the same size as the central one.
+		auto queryFirstNeighbors = [&](AtomIndex particle, AtomIndex* indices, Vector3* deltas){
+			NearestNeighborFinder::Query<MAX_NEIGHBORS> neighQuery2(neighList, neighQuery.results().maxSize());
+			neighQuery2.findNeighbors(neighList.particlePos(particle));
+			const int count = std::min(neighQuery2.results().size(), DiamondNeighborTable::RowSize);
+			for(int j = 0; j < count; j++){
+				indices[j] = neighQuery2.results()[j].index;
+				deltas[j] = neighQuery2.results()[j].delta;
 			}
+			return count;
+		};
+		return computeDiamondCutoff<Lattice>(queryFirstNeighbors, particleIndex, neighborIndices, neighborVectors, neighborArray);
+	}
+}
 
-			localScaling /= 12;
-			// 1.2071068 is a geometric constant used to calculate 
-			// the local shear radius in diamond-type structures, and is equal to ((1 + sqrt(2)) / 2).
-			// That is, it allows to delimit the maximum distance allowed between secondary 
-			// neighbors that could still form links coherent with the ideal network.
-			localCutoff = localScaling * 1.2071068;
-			break;
+// Completes the shell of a diamond atom whose four nearest neighbors are in
+// slots 0..3: the three other first neighbors of each of them fill slots
+// 4..15. firstNeighbors(particle, indices, deltas) stores up to four nearest
+// neighbors of a particle and returns their number. Returns the local cutoff
+// and fills the bond array, or returns zero if the shell is not diamond-like.
+template<LatticeStructureType Lattice, typename FirstNeighbors>
+double CoordinationStructures::computeDiamondCutoff(
+	const FirstNeighbors& firstNeighbors,
+	AtomIndex particleIndex,
+	AtomIndex* neighborIndices,
+	Vector3* neighborVectors,
+	NeighborBondArray& neighborArray
+) const {
+	static_assert(isDiamondLattice(Lattice));
+	constexpr int coordinationNumber = latticeCoordinationNumber(Lattice);
+
+	// Generate list of second nearest neighbors
+	int outputIndex = 4;
+	for(int i = 0; i < 4; i++){
+		const Vector3& v0 = neighborVectors[i];
+		AtomIndex secondIndices[DiamondNeighborTable::RowSize];
+		Vector3 secondDeltas[DiamondNeighborTable::RowSize];
+		if(firstNeighbors(neighborIndices[i], secondIndices, secondDeltas) < 4) return 0.0;
+
+		for(int j = 0; j < 4; j++){
+			Vector3 v = v0 + secondDeltas[j];
+			if(secondIndices[j] == particleIndex && v.isZero()) continue;
+			if(outputIndex == coordinationNumber) return 0;
+
+			neighborIndices[outputIndex] = secondIndices[j];
+			neighborVectors[outputIndex] = v;
+			neighborArray.setNeighborBond(i, outputIndex, true);
+			outputIndex++;
 		}
-		default:
-			return 0.0;
+
+        // consistency check: each of the first 4 contributes 3 second neighbors => outputIndex should be (i*3)+7 after loop for i
+		if(outputIndex != (i * 3) + 7) return 0;
 	}
 
-	double localCutoffSquared = localCutoff * localCutoff;
+    // Compute local scale factor from the 12 second neighbors (positions 4..15)
+	double localScaling = 0;
+	for(int neighbor = 4; neighbor < coordinationNumber; neighbor++){
+		localScaling += neighborVectors[neighbor].length();
+	}
 
-	switch(_inputCrystalType){
-		case LATTICE_FCC:
-		case LATTICE_HCP:
-		case LATTICE_BCC:
-			// Make sure the (N + 1) -th atom is beyond the cutoff radius (if it exists)
-			if(numNeighbors > coordinationNumber && neighQuery.results()[coordinationNumber].distanceSq <= localCutoffSquared){
-				return 0.0;
-			}
+	localScaling /= 12;
+	// 1.2071068 is a geometric constant used to calculate 
+	// the local shear radius in diamond-type structures, and is equal to ((1 + sqrt(2)) / 2).
+	// That is, it allows to delimit the maximum distance allowed between secondary 
+	// neighbors that could still form links coherent with the ideal network.
+	const double localCutoff = localScaling * 1.2071068;
+	const double localCutoffSquared = localCutoff * localCutoff;
+
+	// Compute common neighbor bit-flag array
+	for(int ni1 = 4; ni1 < coordinationNumber; ni1++){
+		for(int ni2 = ni1 + 1; ni2 < coordinationNumber; ni2++){
+			auto distance = (neighborVectors[ni1] - neighborVectors[ni2]);
+			bool isBonded = distance.squaredLength() <= localCutoffSquared;
+			neighborArray.setNeighborBond(ni1, ni2, isBonded);
+		}
+	}
+	return localCutoff;
+}
 
-			// Compute common neighbor fit-flag array
-			for(int ni1 = 0; ni1 < coordinationNumber; ni1++){
-				neighborIndices[ni1] = neighQuery.results()[ni1].index;
-				neighborVectors[ni1] = neighQuery.results()[ni1].delta;
-				neighborArray.setNeighborBond(ni1, ni1, false);
-				for(int ni2 = ni1 + 1; ni2 < coordinationNumber; ni2++){
-					neighborArray.setNeighborBond(ni1, ni2, (neighQuery.results()[ni1].delta - neighQuery.results()[ni2].delta).squaredLength() <= localCutoffSquared);
-				}
+DiamondNeighborTable CoordinationStructures::computeDiamondNeighborTable(const NearestNeighborFinder& neighList, int maxNeighbors) const{
+	const size_t N = _structureTypes->size();
+	DiamondNeighborTable table;
+	table.neighborCounts.resize(N);
+	table.indices.resize(N * DiamondNeighborTable::RowSize);
+	table.deltas.resize(N * DiamondNeighborTable::RowSize);
+
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, N), [&](const tbb::blocked_range<size_t>& r){
+		NearestNeighborFinder::Query<MAX_NEIGHBORS> neighQuery(neighList, maxNeighbors);
+		for(size_t particleIndex = r.begin(); particleIndex != r.end(); ++particleIndex){
+			neighQuery.findNeighbors(neighList.particlePos(particleIndex));
+			const auto& results = neighQuery.results();
+			table.neighborCounts[particleIndex] = static_cast<unsigned char>(results.size());
+			const int count = table.rowSize(particleIndex);
+			const size_t row = particleIndex * DiamondNeighborTable::RowSize;
+			for(int j = 0; j < count; j++){
+				table.indices[row + j] = results[j].index;
+				table.deltas[row + j] = results[j].delta;
 			}
-			break;
-		case LATTICE_CUBIC_DIAMOND:
-		case LATTICE_HEX_DIAMOND:
-			// Compute common neighbor bit-flag array
-			for(int ni1 = 4; ni1 < coordinationNumber; ni1++){
-				for(int ni2 = ni1 + 1; ni2 < coordinationNumber; ni2++){
-					auto distance = (neighborVectors[ni1] - neighborVectors[ni2]);
-					bool isBonded = distance.squaredLength() <= localCutoffSquared;
-					neighborArray.setNeighborBond(ni1, ni2, isBonded);
-				}
-			}
-			break;
-		default:
-			return 0.0;
-	}
+		}
+	});
+	return table;
+}
 
-	return localCutoff;
+// Diamond CNA without neighbor queries: the shell of every atom is gathered
+// from the rows of its first neighbors, where the per-atom path queries each
+// of them again.
+template<LatticeStructureType Lattice>
+double CoordinationStructures::determineLocalStructures(
+	const DiamondNeighborTable& firstNeighbors,
+	size_t begin,
+	size_t end,
+	std::shared_ptr<ParticleProperty> neighborLists
+) const {
+	static_assert(isDiamondLattice(Lattice));
+	assert(Lattice == _inputCrystalType);
+	constexpr int coordinationNumber = latticeCoordinationNumber(Lattice);
+
+	auto tableRow = [&firstNeighbors](AtomIndex particle, AtomIndex* indices, Vector3* deltas){
+		const int count = firstNeighbors.rowSize(particle);
+		const size_t row = static_cast<size_t>(particle) * DiamondNeighborTable::RowSize;
+		for(int j = 0; j < count; j++){
+			indices[j] = firstNeighbors.indices[row + j];
+			deltas[j] = firstNeighbors.deltas[row + j];
+		}
+		return count;
+	};
+
+	double maxCutoff = 0;
+	for(size_t particleIndex = begin; particleIndex < end; particleIndex++){
+		assert(_structureTypes->getInt(particleIndex) == COORD_OTHER);
+
+		// Early rejection of under-coordinated atoms
+		if(firstNeighbors.neighborCounts[particleIndex] < coordinationNumber) continue;
+
+		AtomIndex neighborIndices[MAX_NEIGHBORS];
+		Vector3 neighborVectors[MAX_NEIGHBORS];
+		NeighborBondArray neighborArray;
+		tableRow(static_cast<AtomIndex>(particleIndex), neighborIndices, neighborVectors);
+
+		const double localCutoff = computeDiamondCutoff<Lattice>(tableRow, static_cast<AtomIndex>(particleIndex), neighborIndices, neighborVectors, neighborArray);
+		if(localCutoff == 0.0) continue;
+
+		if(assignLocalStructure<Lattice>(static_cast<AtomIndex>(particleIndex), neighborIndices, neighborVectors, neighborArray, neighborLists)){
+			maxCutoff = std::max(maxCutoff, localCutoff);
+		}
+	}
+	return maxCutoff;
 }
 
 // Determines the coordination structure of a particle
+template<LatticeStructureType Lattice>
 double CoordinationStructures::determineLocalStructure(
 	const NearestNeighborFinder& neighList, 
-	int particleIndex,
+	int maxNeighbors,
+	AtomIndex particleIndex,
 	std::shared_ptr<ParticleProperty> neighborLists
 ) const { 
-    std::vector<int> neighborIndices(MAX_NEIGHBORS);
-    std::vector<Vector3> neighborVectors(MAX_NEIGHBORS);
-    std::vector<int> cnaSignatures(MAX_NEIGHBORS);
-    std::vector<int> neighborMapping(MAX_NEIGHBORS);
-    std::vector<int> previousMapping(MAX_NEIGHBORS);
+	assert(Lattice == _inputCrystalType);
+    AtomIndex neighborIndices[MAX_NEIGHBORS];
+    Vector3 neighborVectors[MAX_NEIGHBORS];
 
     NeighborBondArray neighborArray;
 
     assert(_structureTypes->getInt(particleIndex) == COORD_OTHER);
     
     // Find N nearest neighbors of current atom
-    NearestNeighborFinder::Query<MAX_NEIGHBORS> neighQuery(neighList);
+    NearestNeighborFinder::Query<MAX_NEIGHBORS> neighQuery(neighList, maxNeighbors);
     neighQuery.findNeighbors(neighList.particlePos(particleIndex));
     int numNeighbors = neighQuery.results().size();
     
-    // Number of neighbors to analyze
-    int coordinationNumber = getCoordinationNumber();
-
     // Early rejection of under-coordinated atoms
-    if(numNeighbors < coordinationNumber) return 0.0;
+    if(numNeighbors < latticeCoordinationNumber(Lattice)) return 0.0;
 
-	double localCutoff = computeLocalCutoff(
-		neighList, neighQuery, numNeighbors, coordinationNumber,
+	double localCutoff = computeLocalCutoff<Lattice>(
+		neighList, neighQuery, numNeighbors,
 		particleIndex, 
-        neighborIndices.data(), 
-        neighborVectors.data(), 
+        neighborIndices, 
+        neighborVectors, 
         neighborArray
 	);
 
     if(localCutoff == 0.0) return 0.0;
 
-    // Prepare mapping indices
-    for(int n = 0; n < coordinationNumber; ++n){
-        neighborMapping[n] = n;
-        previousMapping[n] = -1;
-    }
-
-	CoordinationStructureType coordinationType = CommonNeighborAnalysis::computeCoordinationType(
-		neighborArray, coordinationNumber, cnaSignatures.data(),
-		_inputCrystalType, _identifyPlanarDefects);
-
-	if(coordinationType == COORD_OTHER) return 0.0;
+	if(!assignLocalStructure<Lattice>(particleIndex, neighborIndices, neighborVectors, neighborArray, neighborLists)){
+		return 0.0;
+	}
+	return localCutoff;
+}
 
-	for(int n = 0; n < coordinationNumber; n++){
-		neighborMapping[n] = n;
-		previousMapping[n] = -1;
+double CoordinationStructures::determineLocalStructure(
+	const NearestNeighborFinder& neighList, 
+	int maxNeighbors,
+	AtomIndex particleIndex,
+	std::shared_ptr<ParticleProperty> neighborLists
+) const { 
+	switch(_inputCrystalType){
+		case LATTICE_FCC:
+			return determineLocalStructure<LATTICE_FCC>(neighList, maxNeighbors, particleIndex, std::move(neighborLists));
+		case LATTICE_HCP:
+			return determineLocalStructure<LATTICE_HCP>(neighList, maxNeighbors, particleIndex, std::move(neighborLists));
+		case LATTICE_BCC:
+			return determineLocalStructure<LATTICE_BCC>(neighList, maxNeighbors, particleIndex, std::move(neighborLists));
+		case LATTICE_CUBIC_DIAMOND:
+			return determineLocalStructure<LATTICE_CUBIC_DIAMOND>(neighList, maxNeighbors, particleIndex, std::move(neighborLists));
+		case LATTICE_HEX_DIAMOND:
+			return determineLocalStructure<LATTICE_HEX_DIAMOND>(neighList, maxNeighbors, particleIndex, std::move(neighborLists));
+		default:
+			return 0.0;
 	}
+}
+
+// Classifies a particle from the bond topology of its neighbor shell and, on
+// a match, stores its structure type and its neighbors in the order of the
+// reference structure.
+template<LatticeStructureType Lattice>
+bool CoordinationStructures::assignLocalStructure(
+	AtomIndex particleIndex,
+	const AtomIndex* neighborIndices,
+	const Vector3* neighborVectors,
+	const NeighborBondArray& neighborArray,
+	const std::shared_ptr<ParticleProperty>& neighborLists
+) const {
+	constexpr int coordinationNumber = latticeCoordinationNumber(Lattice);
+	int cnaSignatures[MAX_NEIGHBORS];
+	int neighborMapping[MAX_NEIGHBORS];
+
+	CoordinationStructureType coordinationType = CommonNeighborAnalysis::computeCoordinationType<Lattice>(
+		neighborArray, cnaSignatures, _identifyPlanarDefects);
+
+	if(coordinationType == COORD_OTHER) return false;
 
 	bool found = CommonNeighborAnalysis::findMatchingNeighborPermutation(
-		coordinationType, neighborMapping.data(), previousMapping.data(),
-		coordinationNumber, cnaSignatures.data(), neighborArray, _coordinationStructures);
+		coordinationType, neighborMapping, coordinationNumber,
+		cnaSignatures, neighborArray, _coordinationStructures);
 
-	if(!found) return 0.0;
+	if(!found) return false;
 
     // Map coordinationType -> StructureType for the central atom
     StructureType atomStructure = StructureType::OTHER;
@@ -287,79 +417,144 @@ double CoordinationStructures::determineLocalStructure(
 				}
 			}
 		}
-		neighborLists->setIntComponent(particleIndex, i, neighborIndices[neighborMapping[i]]);
+		neighborLists->setAtomIndexComponent(particleIndex, i, neighborIndices[neighborMapping[i]]);
 	}
 
-	return localCutoff;
+	return true;
 }
 
-void CoordinationStructures::postProcessDiamondNeighbors(
-    AnalysisContext& context,
-    const NearestNeighborFinder& neighList
-) const{
-    if(_inputCrystalType != LATTICE_CUBIC_DIAMOND && _inputCrystalType != LATTICE_HEX_DIAMOND) return;
-    
-    const size_t N = _structureTypes->size();
-    std::vector<int> newStructureTypes(N);
+bool CoordinationStructures::supportsBatchedCNA() const{
+	return isShellLattice(_inputCrystalType);
+}
 
-    for(size_t i = 0; i < N; ++i){
-        newStructureTypes[i] = _structureTypes->getInt(i);
-    }
-    
-    NearestNeighborFinder firstNeighborFinder(4);
-    firstNeighborFinder.prepare(context.positions, context.simCell, nullptr);
-    
-    // Mark first neighbors of diamond atoms
-    for(size_t i = 0; i < N; ++i){
-        int currentType = _structureTypes->getInt(i);
-        if(currentType != static_cast<int>(StructureType::CUBIC_DIAMOND) && 
-           currentType != static_cast<int>(StructureType::HEX_DIAMOND)) continue;
-           
-        NearestNeighborFinder::Query<4> query(firstNeighborFinder);
-        // false = do not include self
-        query.findNeighbors(i, false); 
-        
-        StructureType firstNeighType = (currentType == static_cast<int>(StructureType::CUBIC_DIAMOND)) 
-            ? StructureType::CUBIC_DIAMOND_FIRST_NEIGH 
-            : StructureType::HEX_DIAMOND_FIRST_NEIGH;
-            
-        for(const auto& neighbor : query.results()){
-            if(_structureTypes->getInt(neighbor.index) == static_cast<int>(StructureType::OTHER)){
-                newStructureTypes[neighbor.index] = static_cast<int>(firstNeighType);
-            }
-        }
-    }
-    
-    // Apply changes for first neighbors
-    for(size_t i = 0; i < N; ++i){
-        _structureTypes->setInt(i, newStructureTypes[i]);
-    }
-    
-    // Mark second neighbors from first neighbors
-    for(size_t i = 0; i < N; ++i){
-        int currentType = _structureTypes->getInt(i);
-        if(currentType != static_cast<int>(StructureType::CUBIC_DIAMOND_FIRST_NEIGH) && 
-           currentType != static_cast<int>(StructureType::HEX_DIAMOND_FIRST_NEIGH)) continue;
-           
-        NearestNeighborFinder::Query<4> query(firstNeighborFinder);
-        query.findNeighbors(i, false);
-        
-        StructureType secondNeighType = (currentType == static_cast<int>(StructureType::CUBIC_DIAMOND_FIRST_NEIGH)) 
-            ? StructureType::CUBIC_DIAMOND_SECOND_NEIGH 
-            : StructureType::HEX_DIAMOND_SECOND_NEIGH;
-            
-        for(const auto& neighbor : query.results()){
-            if(_structureTypes->getInt(neighbor.index) == static_cast<int>(StructureType::OTHER)){
-                newStructureTypes[neighbor.index] = static_cast<int>(secondNeighType);
-            }
-        }
-    }
-    
-    for(size_t i = 0; i < N; ++i){
-        _structureTypes->setInt(i, newStructureTypes[i]);
-    }
+// Runs CNA on a range of particles in blocks of CNABlockSize. All neighbor
+// queries of a block come first, and their shells are stored as one x/y/z
+// column per atom, padded with far-away slots. The bond row of a neighbor is then
+// a single batched distance test of the whole column against that neighbor,
+// which yields the NeighborBondArray row as a bitmask; the scalar path tests
+// the pairs one at a time. Signatures and neighbor matching follow for the
+// block. Results are the same as calling determineLocalStructure() for every
+// particle.
+template<LatticeStructureType Lattice>
+double CoordinationStructures::determineLocalStructures(
+	const NearestNeighborFinder& neighList,
+	int maxNeighbors,
+	size_t begin,
+	size_t end,
+	std::shared_ptr<ParticleProperty> neighborLists
+) const {
+	static_assert(isShellLattice(Lattice));
+	assert(Lattice == _inputCrystalType);
+	constexpr int coordinationNumber = latticeCoordinationNumber(Lattice);
+	constexpr unsigned int shellMask = (1u << coordinationNumber) - 1;
+	// Shell columns are padded to a multiple of eight slots, so that the
+	// batched distance test needs no scalar tail.
+	constexpr size_t columnLength = (static_cast<size_t>(coordinationNumber) + 7) & ~size_t(7);
+	static_assert(columnLength <= MAX_NEIGHBORS);
+	NearestNeighborFinder::Query<MAX_NEIGHBORS> neighQuery(neighList, maxNeighbors);
+
+	// Column of atom a: [a * MAX_NEIGHBORS, (a + 1) * MAX_NEIGHBORS)
+	alignas(64) double x[CNABlockSize * MAX_NEIGHBORS];
+	alignas(64) double y[CNABlockSize * MAX_NEIGHBORS];
+	alignas(64) double z[CNABlockSize * MAX_NEIGHBORS];
+	AtomIndex indices[CNABlockSize][MAX_NEIGHBORS];
+	// Zero for atoms rejected before the bond test
+	double cutoffs[CNABlockSize];
+	NeighborBondArray bondArrays[CNABlockSize];
+
+	for(size_t a = 0; a < CNABlockSize; a++){
+		for(size_t ni = coordinationNumber; ni < columnLength; ni++){
+			const size_t slot = a * MAX_NEIGHBORS + ni;
+			x[slot] = y[slot] = z[slot] = UnusedNeighborCoordinate;
+		}
+	}
+
+	double maxCutoff = 0;
+	for(size_t blockBegin = begin; blockBegin < end; blockBegin += CNABlockSize){
+		const size_t blockSize = std::min(CNABlockSize, end - blockBegin);
+
+		for(size_t a = 0; a < blockSize; a++){
+			cutoffs[a] = 0;
+			const size_t particleIndex = blockBegin + a;
+			assert(_structureTypes->getInt(particleIndex) == COORD_OTHER);
+			neighQuery.findNeighbors(neighList.particlePos(particleIndex));
+			const auto& results = neighQuery.results();
+			const int numNeighbors = results.size();
+			if(numNeighbors < coordinationNumber) continue;
+
+			// Make sure the (N + 1) -th atom is beyond the cutoff radius (if it exists)
+			const double localCutoff = computeShellCutoff<Lattice>(neighQuery);
+			if(localCutoff == 0.0) continue;
+			if(numNeighbors > coordinationNumber && results[coordinationNumber].distanceSq <= localCutoff * localCutoff) continue;
+
+			const size_t column = a * MAX_NEIGHBORS;
+			for(int ni = 0; ni < coordinationNumber; ni++){
+				x[column + ni] = results[ni].delta.x();
+				y[column + ni] = results[ni].delta.y();
+				z[column + ni] = results[ni].delta.z();
+				indices[a][ni] = results[ni].index;
+			}
+			cutoffs[a] = localCutoff;
+		}
+
+		for(size_t a = 0; a < blockSize; a++){
+			if(cutoffs[a] == 0) continue;
+			const double localCutoffSquared = cutoffs[a] * cutoffs[a];
+			const double* cx = x + a * MAX_NEIGHBORS;
+			const double* cy = y + a * MAX_NEIGHBORS;
+			const double* cz = z + a * MAX_NEIGHBORS;
+			for(int ni = 0; ni < coordinationNumber; ni++){
+				const std::uint64_t row = DistanceKernels::withinMask(cx, cy, cz, columnLength, Point3(cx[ni], cy[ni], cz[ni]), localCutoffSquared);
+				bondArrays[a].neighborArray[ni] = static_cast<unsigned int>(row) & shellMask & ~(1u << ni);
+			}
+		}
+
+		for(size_t a = 0; a < blockSize; a++){
+			if(cutoffs[a] == 0) continue;
+			const size_t column = a * MAX_NEIGHBORS;
+			Vector3 neighborVectors[MAX_NEIGHBORS];
+			for(int ni = 0; ni < coordinationNumber; ni++){
+				neighborVectors[ni] = Vector3(x[column + ni], y[column + ni], z[column + ni]);
+			}
+			if(assignLocalStructure<Lattice>(static_cast<AtomIndex>(blockBegin + a), indices[a], neighborVectors, bondArrays[a], neighborLists)){
+				maxCutoff = std::max(maxCutoff, cutoffs[a]);
+			}
+		}
+	}
+	return maxCutoff;
+}
+
+double CoordinationStructures::determineLocalStructures(
+	const NearestNeighborFinder& neighList,
+	int maxNeighbors,
+	size_t begin,
+	size_t end,
+	std::shared_ptr<ParticleProperty> neighborLists
+) const {
+	switch(_inputCrystalType){
+		case LATTICE_FCC:
+			return determineLocalStructures<LATTICE_FCC>(neighList, maxNeighbors, begin, end, std::move(neighborLists));
+		case LATTICE_HCP:
+			return determineLocalStructures<LATTICE_HCP>(neighList, maxNeighbors, begin, end, std::move(neighborLists));
+		case LATTICE_BCC:
+			return determineLocalStructures<LATTICE_BCC>(neighList, maxNeighbors, begin, end, std::move(neighborLists));
+		default:
+			assert(false);
+			return 0.0;
+	}
 }
 
+template double CoordinationStructures::determineLocalStructure<LATTICE_FCC>(const NearestNeighborFinder&, int, AtomIndex, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructure<LATTICE_HCP>(const NearestNeighborFinder&, int, AtomIndex, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructure<LATTICE_BCC>(const NearestNeighborFinder&, int, AtomIndex, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructure<LATTICE_CUBIC_DIAMOND>(const NearestNeighborFinder&, int, AtomIndex, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructure<LATTICE_HEX_DIAMOND>(const NearestNeighborFinder&, int, AtomIndex, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructures<LATTICE_FCC>(const NearestNeighborFinder&, int, size_t, size_t, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructures<LATTICE_HCP>(const NearestNeighborFinder&, int, size_t, size_t, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructures<LATTICE_BCC>(const NearestNeighborFinder&, int, size_t, size_t, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructures<LATTICE_CUBIC_DIAMOND>(const DiamondNeighborTable&, size_t, size_t, std::shared_ptr<ParticleProperty>) const;
+template double CoordinationStructures::determineLocalStructures<LATTICE_HEX_DIAMOND>(const DiamondNeighborTable&, size_t, size_t, std::shared_ptr<ParticleProperty>) const;
+
 void CoordinationStructures::initializeFCC(){
 	initializeCoordinationStructure(COORD_FCC, FCC_VECTORS, 12, [&](const Vector3& v1, const Vector3& v2){
 		return (v1 - v2).length() < (sqrt(0.5f) + 1.0) * 0.5;
@@ -517,6 +712,21 @@ void CoordinationStructures::initializeCommonNeighbors(){
 	}
 }
 
+// Builds the class table the CNA neighbor matcher compares an atom's
+// neighbors against.
+void CoordinationStructures::initializeNeighborClasses(){
+	for(CoordinationStructure& coordStruct : _coordinationStructures){
+		CommonNeighborAnalysis::computeNeighborClasses(
+			coordStruct.neighborArray, coordStruct.cnaSignatures,
+			coordStruct.numNeighbors, coordStruct.neighborClasses);
+		for(int ni1 = 0; ni1 < coordStruct.numNeighbors; ni1++){
+			coordStruct.neighborClassSizes[ni1] = static_cast<int>(std::count(
+				coordStruct.neighborClasses, coordStruct.neighborClasses + coordStruct.numNeighbors,
+				coordStruct.neighborClasses[ni1]));
+		}
+	}
+}
+
 void CoordinationStructures::findCommonNeighborsForBond(CoordinationStructure& coordStruct, int neighborIndex){
 	Matrix3 tm;
 	tm.column(0) = coordStruct.latticeVectors[neighborIndex];
@@ -724,6 +934,7 @@ void CoordinationStructures::initializeStructures(){
 	initializeCubicDiamond();
 	initializeHexagonalDiamond();
 	initializeCommonNeighbors();
+	initializeNeighborClasses();
 	initializeSymmetryInformation();
 }
 
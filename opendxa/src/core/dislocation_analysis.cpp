@@ -1,4 +1,5 @@
 #include <opendxa/core/dislocation_analysis.h>
+#include <opendxa/core/spatial_sort.h>
 #include <opendxa/analysis/structure_analysis.h>
 #include <opendxa/utilities/concurrence/parallel_system.h>
 #include <opendxa/analysis/analysis_context.h>
@@ -18,6 +19,7 @@ DislocationAnalysis::DislocationAnalysis()
       _linePointInterval(2.5),
       _defectMeshSmoothingLevel(8),
       _rmsd(0.12f),
+      _searchPrecision(SearchPrecision::Double),
       _identificationMode(StructureAnalysis::Mode::CNA),
       _markCoreAtoms(false),
       _structureIdentificationOnly(false),
@@ -51,6 +53,10 @@ void DislocationAnalysis::setRmsd(float rmsd){
     _rmsd = rmsd;
 }
 
+void DislocationAnalysis::setSearchPrecision(SearchPrecision precision){
+    _searchPrecision = precision;
+}
+
 void DislocationAnalysis::setLineSmoothingLevel(double lineSmoothingLevel){
     _lineSmoothingLevel = lineSmoothingLevel;
 }
@@ -68,6 +74,7 @@ void DislocationAnalysis::setIdentificationMode(StructureAnalysis::Mode identifi
 }
 
 json DislocationAnalysis::compute(const LammpsParser::Frame &frame, const std::string& outputFile){
+    _jsonExporter.setAtomOrder(SpatialSort::exportOrder(frame));
     auto start_time = std::chrono::high_resolution_clock::now();
     spdlog::debug("Processing frame {} with {} atoms", frame.timestep, frame.natoms);
     
@@ -79,7 +86,11 @@ json DislocationAnalysis::compute(const LammpsParser::Frame &frame, const std::s
         return result;
     }
 
-    if(frame.positions.empty()){
+    if(!StructureAnalysis::checkAtomCount(frame.natoms, result)){
+        return result;
+    }
+
+    if(!frame.positionData()){
         result["is_failed"] = true;
         result["error"] = "No position data available";
         return result;
@@ -115,6 +126,7 @@ json DislocationAnalysis::compute(const LammpsParser::Frame &frame, const std::s
         structureTypes.get(),
         std::move(preferredOrientations)
     );
+    context.neighborCache->setPrecision(_searchPrecision);
 
     std::unique_ptr<StructureAnalysis> structureAnalysis;
     {
@@ -134,7 +146,7 @@ json DislocationAnalysis::compute(const LammpsParser::Frame &frame, const std::s
 
     std::vector<int> extractedStructureTypes;
     extractedStructureTypes.reserve(frame.natoms);
-    for(int i = 0; i < frame.natoms; ++i){
+    for(size_t i = 0; i < static_cast<size_t>(frame.natoms); ++i){
         int structureType = structureAnalysis->context().structureTypes->getInt(i);
         extractedStructureTypes.push_back(structureType);
     }
@@ -339,25 +351,7 @@ json DislocationAnalysis::compute(const LammpsParser::Frame &frame, const std::s
 }
 
 std::shared_ptr<ParticleProperty> DislocationAnalysis::createPositionProperty(const LammpsParser::Frame &frame){
-    std::shared_ptr<ParticleProperty> property(new ParticleProperty(
-        frame.natoms, ParticleProperty::PositionProperty, 0, true));
-
-    if(!property || property->size() != frame.natoms){
-        spdlog::error("Failed to allocate ParticleProperty for positions");
-        return nullptr;
-    }
-
-    Point3 *data = property->dataPoint3();
-    if(!data){
-        spdlog::error("Failed to get position data pointer");
-        return nullptr;
-    }
-
-    for(size_t i = 0; i < frame.positions.size() && i < static_cast<size_t>(frame.natoms); i++){
-        data[i] = frame.positions[i];
-    }
-
-    return property;
+    return LammpsParser::createPositionProperty(frame);
 }
 
 bool DislocationAnalysis::validateSimulationCell(const SimulationCell &cell){
@@ -0,0 +1,112 @@
+#include <opendxa/core/dump_columns.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+
+namespace OpenDXA{
+
+bool isCoreDumpColumn(std::string_view name){
+    return name == "id" || name == "type" ||
+           name == "x" || name == "y" || name == "z" ||
+           name == "xs" || name == "ys" || name == "zs";
+}
+
+Particles::DataType inferDumpColumnType(std::string_view name){
+    if(name == "mol" || name == "proc" || name == "procp1" ||
+       name == "ix" || name == "iy" || name == "iz" ||
+       name.starts_with("i_") || name.starts_with("i2_")){
+        return Particles::DataType::Int;
+    }
+    return Particles::DataType::Double;
+}
+
+std::vector<BoundColumn> bindRequestedColumns(
+    const std::vector<std::string>& names,
+    const std::vector<LammpsParser::ColumnRequest>& requests,
+    LammpsParser::Frame& frame
+){
+    using Particles::DataType;
+    using Particles::ParticleProperty;
+
+    std::vector<BoundColumn> bound;
+    std::map<std::string, std::shared_ptr<ParticleProperty>> properties;
+    const size_t natoms = static_cast<size_t>(frame.natoms);
+
+    auto bind = [&](int column, DataType dataType){
+        const std::string& name = names[static_cast<size_t>(column)];
+        if(properties.count(name)) return;
+
+        std::shared_ptr<ParticleProperty> property;
+        auto previous = frame.properties.find(name);
+        if(previous != frame.properties.end() && previous->second &&
+           previous->second.use_count() == 1 &&
+           previous->second->dataType() == dataType &&
+           previous->second->componentCount() == 1){
+            property = previous->second;
+            property->resize(natoms, false);
+        }else{
+            property = std::make_shared<ParticleProperty>(natoms, dataType, 1, 0, false);
+        }
+        bound.push_back({column, dataType, property->data()});
+        properties.emplace(name, std::move(property));
+    };
+
+    bool all = false;
+    for(const auto& request : requests){
+        if(request.name == "*"){
+            all = true;
+            continue;
+        }
+        if(isCoreDumpColumn(request.name)) continue;
+        auto it = std::find(names.begin(), names.end(), request.name);
+        if(it == names.end()){
+            spdlog::warn("Requested column '{}' is not present in the dump", request.name);
+            continue;
+        }
+        DataType dataType = request.dataType == DataType::Void ? inferDumpColumnType(request.name) : request.dataType;
+        bind(static_cast<int>(it - names.begin()), dataType);
+    }
+    if(all){
+        for(size_t c = 0; c < names.size(); ++c){
+            if(!isCoreDumpColumn(names[c])) bind(static_cast<int>(c), inferDumpColumnType(names[c]));
+        }
+    }
+
+    frame.properties = std::move(properties);
+    return bound;
+}
+
+FrameAtomFilter::FrameAtomFilter(const LammpsParser::AtomFilter& filter, const SimulationCell& cell)
+    : _active(filter.isActive()), _types(filter.types){
+    std::sort(_types.begin(), _types.end());
+    if(filter.region.isEmpty()) return;
+
+    _region = filter.region.padBox(filter.padding);
+
+    // An atom is kept if it or one of its periodic images lies in the
+    // region. Only images whose translated region still overlaps the cell
+    // can match, which for an interior region leaves just the atom itself.
+    _shifts.push_back(Vector3::Zero());
+    const AffineTransformation& M = cell.matrix();
+    const Box3 cellBox = Box3(Point3(0, 0, 0), Point3(1, 1, 1)).transformed(M);
+    for(int i = -1; i <= 1; ++i){
+        if(i != 0 && !cell.hasPbc(0)) continue;
+        for(int j = -1; j <= 1; ++j){
+            if(j != 0 && !cell.hasPbc(1)) continue;
+            for(int k = -1; k <= 1; ++k){
+                if(k != 0 && !cell.hasPbc(2)) continue;
+                if(i == 0 && j == 0 && k == 0) continue;
+                const Vector3 shift = M.column(0) * static_cast<double>(i) + M.column(1) * static_cast<double>(j) + M.column(2) * static_cast<double>(k);
+                bool overlaps = true;
+                for(int d = 0; d < 3; ++d){
+                    if(_region.minc[d] - shift[d] > cellBox.maxc[d] || _region.maxc[d] - shift[d] < cellBox.minc[d]){
+                        overlaps = false;
+                    }
+                }
+                if(overlaps) _shifts.push_back(shift);
+            }
+        }
+    }
+}
+
+}
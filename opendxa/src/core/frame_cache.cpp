@@ -0,0 +1,176 @@
+#include <opendxa/core/frame_cache.h>
+#include <opendxa/core/snapshot.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace OpenDXA{
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Bytes hashed from the start of the dump, which hold the first frame's
+// header, and from each sampled block further in.
+constexpr std::size_t HeadBytes = std::size_t(64) << 10;
+constexpr std::size_t SampleBytes = std::size_t(4) << 10;
+constexpr int SampleCount = 16;
+
+struct Fnv1a{
+    std::uint64_t state = 0xcbf29ce484222325ull;
+
+    void update(const void* data, std::size_t size){
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for(std::size_t i = 0; i < size; ++i){
+            state ^= bytes[i];
+            state *= 0x100000001b3ull;
+        }
+    }
+
+    template <typename T>
+    void update(const T& value){
+        update(&value, sizeof(value));
+    }
+};
+
+bool hashBlock(std::ifstream& in, std::uint64_t offset, std::size_t size, std::vector<char>& buffer, Fnv1a& hash){
+    buffer.resize(size);
+    in.seekg(static_cast<std::streamoff>(offset));
+    if(!in.read(buffer.data(), static_cast<std::streamsize>(size))) return false;
+    hash.update(buffer.data(), size);
+    return true;
+}
+
+} // namespace
+
+FrameCache::FrameCache(std::string directory, std::uint64_t maxBytes)
+    : _directory(std::move(directory)), _maxBytes(maxBytes){}
+
+std::unique_ptr<FrameCache> FrameCache::fromEnvironment(){
+    const char* directory = std::getenv("OPENDXA_FRAME_CACHE");
+    if(!directory || !*directory) return nullptr;
+
+    std::uint64_t maxBytes = DefaultMaxBytes;
+    if(const char* maxMb = std::getenv("OPENDXA_FRAME_CACHE_MAX_MB")){
+        char* end = nullptr;
+        const unsigned long long value = std::strtoull(maxMb, &end, 10);
+        if(end != maxMb && value > 0) maxBytes = static_cast<std::uint64_t>(value) << 20;
+    }
+
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if(ec){
+        spdlog::warn("Frame cache disabled, cannot create {}: {}", directory, ec.message());
+        return nullptr;
+    }
+    return std::make_unique<FrameCache>(directory, maxBytes);
+}
+
+// The mtime and size catch ordinary rewrites; the sampled content catches
+// dumps replaced by a copy that preserved both.
+std::string FrameCache::key(const std::string &filename){
+    std::error_code ec;
+    const std::uint64_t size = fs::file_size(filename, ec);
+    if(ec) return {};
+    const auto mtime = fs::last_write_time(filename, ec);
+    if(ec) return {};
+
+    std::ifstream in(filename, std::ios::binary);
+    if(!in) return {};
+
+    Fnv1a hash;
+    hash.update(Snapshot::FormatVersion);
+    hash.update(size);
+    hash.update(static_cast<std::int64_t>(mtime.time_since_epoch().count()));
+
+    std::vector<char> buffer;
+    if(!hashBlock(in, 0, static_cast<std::size_t>(std::min<std::uint64_t>(size, HeadBytes)), buffer, hash)) return {};
+    if(size > HeadBytes + SampleBytes){
+        const std::uint64_t span = size - HeadBytes - SampleBytes;
+        for(int i = 1; i <= SampleCount; ++i){
+            const std::uint64_t offset = HeadBytes + span * static_cast<std::uint64_t>(i) / SampleCount;
+            if(!hashBlock(in, offset, SampleBytes, buffer, hash)) return {};
+        }
+    }
+
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash.state));
+    return text;
+}
+
+std::string FrameCache::entryPath(const std::string &key) const{
+    return (fs::path(_directory) / (key + Snapshot::Extension)).string();
+}
+
+bool FrameCache::load(const std::string &filename, LammpsParser::Frame &frame) const{
+    const std::string cacheKey = key(filename);
+    if(cacheKey.empty()) return false;
+
+    const std::string path = entryPath(cacheKey);
+    std::error_code ec;
+    if(!fs::exists(path, ec)) return false;
+    if(!Snapshot::read(path, frame)){
+        spdlog::warn("Discarding unreadable frame cache entry {}", path);
+        fs::remove(path, ec);
+        return false;
+    }
+
+    // The entry's mtime is its last use, which eviction orders by.
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    spdlog::info("Loaded {} from frame cache {}", filename, path);
+    return true;
+}
+
+void FrameCache::store(const std::string &filename, const LammpsParser::Frame &frame) const{
+    const std::string cacheKey = key(filename);
+    if(cacheKey.empty()) return;
+
+    const std::string path = entryPath(cacheKey);
+    if(!Snapshot::write(path, frame)){
+        spdlog::warn("Could not add {} to frame cache {}", filename, _directory);
+        return;
+    }
+    evict(path);
+}
+
+// Remove the least recently used entries until the cache fits its cap.
+// The entry just stored is kept even if it alone exceeds the cap.
+void FrameCache::evict(const std::string &keep) const{
+    struct Entry{
+        fs::path path;
+        std::uint64_t size;
+        fs::file_time_type lastUse;
+    };
+
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+    std::error_code ec;
+    for(const auto& item : fs::directory_iterator(_directory, ec)){
+        if(!item.is_regular_file(ec) || item.path().extension() != Snapshot::Extension) continue;
+        const std::uint64_t size = item.file_size(ec);
+        if(ec) continue;
+        const auto lastUse = item.last_write_time(ec);
+        if(ec) continue;
+        entries.push_back({ item.path(), size, lastUse });
+        total += size;
+    }
+    if(total <= _maxBytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+        return a.lastUse < b.lastUse;
+    });
+    for(const Entry& entry : entries){
+        if(total <= _maxBytes) break;
+        if(entry.path == fs::path(keep)) continue;
+        if(fs::remove(entry.path, ec)){
+            total -= entry.size;
+            spdlog::debug("Evicted frame cache entry {}", entry.path.string());
+        }
+    }
+}
+
+}
@@ -0,0 +1,442 @@
+#include <opendxa/core/lammps_binary_parser.h>
+#include <opendxa/core/mapped_file.h>
+#include <opendxa/core/dump_columns.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <omp.h>
+
+namespace OpenDXA{
+
+namespace {
+
+// Atoms decoded per parallel work item.
+constexpr size_t DecodeSliceAtoms = 1 << 16;
+
+class ByteReader{
+public:
+    ByteReader(const char* begin, const char* end) : _p(begin), _end(end){}
+
+    template <typename T>
+    bool read(T& value){
+        if(static_cast<size_t>(_end - _p) < sizeof(T)) return false;
+        std::memcpy(&value, _p, sizeof(T));
+        _p += sizeof(T);
+        return true;
+    }
+
+    bool readString(size_t length, std::string& out){
+        if(static_cast<size_t>(_end - _p) < length) return false;
+        out.assign(_p, length);
+        _p += length;
+        return true;
+    }
+
+    bool skip(size_t bytes){
+        if(static_cast<size_t>(_end - _p) < bytes) return false;
+        _p += bytes;
+        return true;
+    }
+
+    const char* position() const{ return _p; }
+    bool atEnd() const{ return _p >= _end; }
+
+private:
+    const char* _p;
+    const char* _end;
+};
+
+struct BinaryHeader{
+    std::int64_t timestep = 0;
+    std::int64_t natoms = 0;
+    int triclinic = 0;
+    int boundary[6] = {};
+    double lo[3] = {};
+    double hi[3] = {};
+    double tilt[3] = {};
+    // Cell edges and origin of general triclinic boxes (triclinic == 2).
+    double avec[3] = {}, bvec[3] = {}, cvec[3] = {}, origin[3] = {};
+    int sizeOne = 0;
+    int nchunk = 0;
+    std::vector<std::string> columns;
+};
+
+struct Chunk{
+    const char* data;
+    size_t firstAtom;
+    size_t numAtoms;
+};
+
+// Header layout written by DumpCustom::header_binary(). Current LAMMPS
+// versions start with the negated length of a magic string followed by the
+// string, an endianness marker and a format revision; revision 2 and later
+// also store units, an optional time value and the column names.
+bool readHeader(ByteReader& in, const std::vector<std::string>& fallbackColumns, BinaryHeader& header){
+    if(!in.read(header.timestep)) return false;
+
+    int revision = 0;
+    if(header.timestep < 0){
+        std::string magic;
+        int endian = 0;
+        if(!in.readString(static_cast<size_t>(-header.timestep), magic)) return false;
+        if(!in.read(endian) || !in.read(revision)) return false;
+        if(endian != 1){
+            spdlog::error("Binary dump was written with a different byte order");
+            return false;
+        }
+        if(!in.read(header.timestep)) return false;
+    }
+
+    if(!in.read(header.natoms) || !in.read(header.triclinic)) return false;
+    for(int i = 0; i < 6; ++i){
+        if(!in.read(header.boundary[i])) return false;
+    }
+
+    if(header.triclinic > 1){
+        for(int i = 0; i < 3; ++i) if(!in.read(header.avec[i])) return false;
+        for(int i = 0; i < 3; ++i) if(!in.read(header.bvec[i])) return false;
+        for(int i = 0; i < 3; ++i) if(!in.read(header.cvec[i])) return false;
+        for(int i = 0; i < 3; ++i) if(!in.read(header.origin[i])) return false;
+    }else{
+        for(int i = 0; i < 3; ++i){
+            if(!in.read(header.lo[i]) || !in.read(header.hi[i])) return false;
+        }
+        if(header.triclinic){
+            for(int i = 0; i < 3; ++i) if(!in.read(header.tilt[i])) return false;
+        }
+    }
+
+    if(!in.read(header.sizeOne) || header.sizeOne <= 0) return false;
+
+    header.columns.clear();
+    if(revision > 1){
+        int length = 0;
+        std::string text;
+        if(!in.read(length) || !in.readString(static_cast<size_t>(std::max(length, 0)), text)) return false;
+
+        char hasTime = 0;
+        double time = 0.0;
+        if(!in.read(hasTime)) return false;
+        if(hasTime && !in.read(time)) return false;
+
+        if(!in.read(length) || !in.readString(static_cast<size_t>(std::max(length, 0)), text)) return false;
+        std::istringstream ss(text);
+        std::string name;
+        while(ss >> name) header.columns.push_back(name);
+    }else{
+        header.columns = fallbackColumns;
+    }
+
+    if(header.columns.size() != static_cast<size_t>(header.sizeOne)){
+        spdlog::error("Binary dump has {} values per atom but {} column names", header.sizeOne, header.columns.size());
+        return false;
+    }
+
+    return in.read(header.nchunk) && header.nchunk >= 0;
+}
+
+// Walk the chunk table of one frame, leaving the reader after its last chunk.
+bool collectChunks(ByteReader& in, const BinaryHeader& header, std::vector<Chunk>* chunks){
+    size_t atoms = 0;
+    const size_t rowBytes = static_cast<size_t>(header.sizeOne) * sizeof(double);
+    for(int i = 0; i < header.nchunk; ++i){
+        int n = 0;
+        if(!in.read(n) || n < 0 || n % header.sizeOne != 0) return false;
+        const size_t numAtoms = static_cast<size_t>(n / header.sizeOne);
+        if(chunks) chunks->push_back({ in.position(), atoms, numAtoms });
+        if(!in.skip(numAtoms * rowBytes)) return false;
+        atoms += numAtoms;
+    }
+    return atoms == static_cast<size_t>(header.natoms);
+}
+
+inline double loadDouble(const char* p){
+    double value;
+    std::memcpy(&value, p, sizeof(double));
+    return value;
+}
+
+int findColumn(const std::vector<std::string>& columns, const char* name){
+    auto it = std::find(columns.begin(), columns.end(), name);
+    return it == columns.end() ? -1 : static_cast<int>(it - columns.begin());
+}
+
+bool decodeFrame(
+    const BinaryHeader& header,
+    const std::vector<Chunk>& chunks,
+    const std::vector<LammpsParser::ColumnRequest>& requests,
+    const LammpsParser::AtomFilter& atomFilter,
+    LammpsParser::Frame& frame
+){
+    // With a filter only the selected atoms need to fit in AtomIndex.
+    if(atomFilter.isActive() ? header.natoms <= 0 : !LammpsParser::acceptAtomCount(header.natoms)) return false;
+
+    frame.timestep = header.timestep;
+    frame.natoms = header.natoms;
+    frame.positionProperty.reset();
+
+    if(header.triclinic > 1){
+        AffineTransformation M(
+            Vector3(header.avec[0], header.avec[1], header.avec[2]),
+            Vector3(header.bvec[0], header.bvec[1], header.bvec[2]),
+            Vector3(header.cvec[0], header.cvec[1], header.cvec[2]),
+            Vector3(header.origin[0], header.origin[1], header.origin[2]));
+        frame.simulationCell.setMatrix(M);
+    }else{
+        frame.simulationCell.setMatrix(LammpsParser::boxMatrix(header.lo, header.hi, header.tilt));
+    }
+    // LAMMPS boundary codes: 0 = p, 1 = f, 2 = s, 3 = m.
+    frame.simulationCell.setPbcFlags(header.boundary[0] == 0, header.boundary[2] == 0, header.boundary[4] == 0);
+
+    const int idCol = findColumn(header.columns, "id");
+    const int typeCol = findColumn(header.columns, "type");
+    int xCol = findColumn(header.columns, "xs");
+    int yCol = findColumn(header.columns, "ys");
+    int zCol = findColumn(header.columns, "zs");
+    const bool scaled = xCol >= 0 && yCol >= 0 && zCol >= 0;
+    if(!scaled){
+        xCol = findColumn(header.columns, "x");
+        yCol = findColumn(header.columns, "y");
+        zCol = findColumn(header.columns, "z");
+    }
+    if(xCol < 0 || yCol < 0 || zCol < 0){
+        spdlog::error("Binary dump has no x/y/z or xs/ys/zs columns");
+        return false;
+    }
+
+    const AffineTransformation& cell = frame.simulationCell.matrix();
+    const size_t rowBytes = static_cast<size_t>(header.sizeOne) * sizeof(double);
+
+    struct Slice{
+        const Chunk* chunk;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Slice> slices;
+    for(const Chunk& chunk : chunks){
+        for(size_t begin = 0; begin < chunk.numAtoms; begin += DecodeSliceAtoms){
+            slices.push_back({ &chunk, begin, std::min(chunk.numAtoms, begin + DecodeSliceAtoms) });
+        }
+    }
+    const long numSlices = static_cast<long>(slices.size());
+
+    auto rowPosition = [&](const char* row){
+        Point3 pos(loadDouble(row + xCol * sizeof(double)),
+                   loadDouble(row + yCol * sizeof(double)),
+                   loadDouble(row + zCol * sizeof(double)));
+        return scaled ? cell * pos : pos;
+    };
+    auto rowType = [&](const char* row){
+        return typeCol >= 0 ? static_cast<int>(loadDouble(row + typeCol * sizeof(double))) : 1;
+    };
+
+    // Filtered frames first collect, per slice, the rows the filter keeps
+    // so everything below is sized to the selection. Rows are fixed-size,
+    // so this pass only loads the position and type of each row.
+    const FrameAtomFilter filter(atomFilter, frame.simulationCell);
+    std::vector<std::vector<size_t>> selected;
+    std::vector<size_t> slotOffsets;
+    if(filter.isActive()){
+        selected.resize(slices.size());
+#pragma omp parallel for schedule(dynamic)
+        for(long s = 0; s < numSlices; ++s){
+            const Slice& slice = slices[static_cast<size_t>(s)];
+            std::vector<size_t>& rows = selected[static_cast<size_t>(s)];
+            for(size_t local = slice.begin; local < slice.end; ++local){
+                const char* row = slice.chunk->data + local * rowBytes;
+                if(filter.accepts(rowPosition(row), rowType(row))) rows.push_back(slice.chunk->firstAtom + local);
+            }
+        }
+
+        slotOffsets.assign(slices.size() + 1, 0);
+        for(size_t s = 0; s < slices.size(); ++s){
+            slotOffsets[s + 1] = slotOffsets[s] + selected[s].size();
+        }
+        const size_t kept = slotOffsets.back();
+        if(kept > 0 && !LammpsParser::acceptAtomCount(static_cast<std::int64_t>(kept))) return false;
+        frame.natoms = static_cast<std::int64_t>(kept);
+
+        frame.sourceIndices.resize(kept);
+        for(size_t s = 0; s < slices.size(); ++s){
+            std::copy(selected[s].begin(), selected[s].end(), frame.sourceIndices.begin() + slotOffsets[s]);
+        }
+    }else{
+        frame.sourceIndices.clear();
+    }
+
+    frame.positions.resize(frame.natoms);
+    frame.types.resize(frame.natoms);
+    frame.ids.resize(frame.natoms);
+    const std::vector<BoundColumn> properties = bindRequestedColumns(header.columns, requests, frame);
+
+#pragma omp parallel for schedule(dynamic)
+    for(long s = 0; s < numSlices; ++s){
+        const Slice& slice = slices[static_cast<size_t>(s)];
+        const size_t count = filter.isActive() ? selected[static_cast<size_t>(s)].size() : slice.end - slice.begin;
+        for(size_t k = 0; k < count; ++k){
+            // Dump row number of the atom and the slot it is stored in.
+            const size_t source = filter.isActive() ? selected[static_cast<size_t>(s)][k] : slice.chunk->firstAtom + slice.begin + k;
+            const size_t index = filter.isActive() ? slotOffsets[static_cast<size_t>(s)] + k : source;
+            const char* row = slice.chunk->data + (source - slice.chunk->firstAtom) * rowBytes;
+
+            frame.positions[index] = rowPosition(row);
+            frame.ids[index] = idCol >= 0 ? static_cast<AtomId>(loadDouble(row + idCol * sizeof(double))) : static_cast<AtomId>(source + 1);
+            frame.types[index] = rowType(row);
+
+            for(const BoundColumn& column : properties){
+                const double value = loadDouble(row + column.column * sizeof(double));
+                switch(column.dataType){
+                    case Particles::DataType::Int: static_cast<int*>(column.data)[index] = static_cast<int>(value); break;
+                    case Particles::DataType::Int64: static_cast<std::int64_t*>(column.data)[index] = static_cast<std::int64_t>(value); break;
+                    default: static_cast<double*>(column.data)[index] = value; break;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Read the header and chunk table at the cursor and decode the frame.
+bool parseBinaryFrame(
+    const char*& cursor,
+    const char* end,
+    const std::vector<std::string>& fallbackColumns,
+    const std::vector<LammpsParser::ColumnRequest>& requests,
+    const LammpsParser::AtomFilter& atomFilter,
+    LammpsParser::Frame& frame
+){
+    ByteReader in(cursor, end);
+    BinaryHeader header;
+    if(!readHeader(in, fallbackColumns, header)) return false;
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(static_cast<size_t>(header.nchunk));
+    if(!collectChunks(in, header, &chunks)) return false;
+    if(!decodeFrame(header, chunks, requests, atomFilter, frame)) return false;
+
+    cursor = in.position();
+    return true;
+}
+
+bool skipBinaryFrame(const char*& cursor, const char* end, const std::vector<std::string>& fallbackColumns){
+    ByteReader in(cursor, end);
+    BinaryHeader header;
+    if(!readHeader(in, fallbackColumns, header)) return false;
+    if(!collectChunks(in, header, nullptr)) return false;
+    cursor = in.position();
+    return true;
+}
+
+} // namespace
+
+bool LammpsBinaryParser::isBinaryDump(const std::string &filename){
+    std::ifstream file(filename, std::ios::binary);
+    char head[8] = {};
+    if(!file.read(head, sizeof(head))) return false;
+    if(std::memcmp(head, "ITEM:", 5) == 0) return false;
+
+    std::int64_t first = 0;
+    std::memcpy(&first, head, sizeof(first));
+    if(first < 0 && first >= -64) return true;
+    return std::find(std::begin(head), std::end(head), '\0') != std::end(head);
+}
+
+bool LammpsBinaryParser::parseFile(const std::string &filename, Frame &frame){
+    return parseFile(filename, 0, frame);
+}
+
+bool LammpsBinaryParser::parseFile(const std::string &filename, size_t frameIndex, Frame &frame){
+    MappedFile mapped(filename, frameIndex == 0);
+    if(!mapped.valid()){
+        spdlog::error("Cannot map binary dump {}", filename);
+        return false;
+    }
+
+    const char* cursor = mapped.data();
+    const char* end = mapped.data() + mapped.size();
+    for(size_t i = 0; i < frameIndex; ++i){
+        if(!skipBinaryFrame(cursor, end, _columnNames)){
+            spdlog::error("Frame {} not found in {}", frameIndex, filename);
+            return false;
+        }
+    }
+
+    if(!parseBinaryFrame(cursor, end, _columnNames, _requestedColumns, _atomFilter, frame)){
+        spdlog::error("Malformed binary dump {}", filename);
+        return false;
+    }
+    spdlog::debug("Parsed {} atoms at timestep {} ", frame.natoms, frame.timestep);
+    return true;
+}
+
+LammpsBinaryParser::TrajectoryReader::TrajectoryReader(const std::string &filename)
+    : _mapped(std::make_unique<MappedFile>(filename, false)){
+    if(!_mapped->valid()){
+        spdlog::error("Cannot map binary dump {}", filename);
+        _mapped.reset();
+        _failed = true;
+        return;
+    }
+    _cursor = _mapped->data();
+    _released = _mapped->data();
+}
+
+LammpsBinaryParser::TrajectoryReader::~TrajectoryReader() = default;
+
+bool LammpsBinaryParser::TrajectoryReader::isOpen() const{
+    return _mapped != nullptr;
+}
+
+bool LammpsBinaryParser::TrajectoryReader::next(Frame &frame){
+    if(_failed || !_mapped) return false;
+
+    const char* end = _mapped->data() + _mapped->size();
+    if(_cursor >= end) return false;
+
+    const char* frameBegin = _cursor;
+    if(!parseBinaryFrame(_cursor, end, _columnNames, _requestedColumns, _atomFilter, frame)){
+        spdlog::error("Malformed binary frame {} at byte offset {}", _framesRead, frameBegin - _mapped->data());
+        _failed = true;
+        return false;
+    }
+
+    _mapped->release(_released, frameBegin);
+    _released = frameBegin;
+    if(_prefetch){
+        // Frames of a trajectory are usually the same size, so the one just
+        // read estimates how much of the file the next call will touch.
+        _mapped->willNeed(_cursor, _cursor + std::min<size_t>(end - _cursor, _cursor - frameBegin));
+    }
+    ++_framesRead;
+    return true;
+}
+
+void LammpsBinaryParser::TrajectoryReader::rewind(){
+    if(!_mapped) return;
+    _failed = false;
+    _framesRead = 0;
+    _cursor = _mapped->data();
+    _released = _mapped->data();
+}
+
+bool LammpsBinaryParser::TrajectoryReader::seek(size_t frameIndex){
+    if(!_mapped) return false;
+    const char* cursor = _mapped->data();
+    const char* end = _mapped->data() + _mapped->size();
+    for(size_t i = 0; i < frameIndex; ++i){
+        if(!skipBinaryFrame(cursor, end, _columnNames)) return false;
+    }
+    if(cursor >= end) return false;
+
+    _failed = false;
+    _cursor = cursor;
+    _released = cursor;
+    _framesRead = frameIndex;
+    return true;
+}
+
+}
@@ -1,23 +1,20 @@
 #include <opendxa/core/lammps_parser.h>
+#include <opendxa/core/mapped_file.h>
+#include <opendxa/core/dump_columns.h>
+#include <opendxa/core/simd_tokenizer.h>
 #include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <map>
 #include <numeric>
 #include <string>
 #include <string_view>
 #include <system_error>
 #include <thread>
-#include <fast_float/fast_float.h>
 
 #include <omp.h>
 
-#if defined(__unix__) || defined(__APPLE__)
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#endif
-
 namespace OpenDXA{
 
 namespace {
@@ -61,14 +58,15 @@ inline const char* skipToken(const char* p, const char* end){
     return p;
 }
 
-inline bool parseIntToken(const char* start, const char* end, int& out){
+template <typename Int>
+inline bool parseIntToken(const char* start, const char* end, Int& out){
     if(start >= end) return false;
-    int sign = 1;
+    Int sign = 1;
     if(*start == '-'){
         sign = -1;
         ++start;
     }
-    int value = 0;
+    Int value = 0;
     bool any = false;
     for(const char* p = start; p < end; ++p){
         char c = *p;
@@ -82,11 +80,11 @@ inline bool parseIntToken(const char* start, const char* end, int& out){
 }
 
 inline bool parseDoubleToken(const char* start, const char* end, double& out){
-    auto result = fast_float::from_chars(start, end, out);
-    return result.ec == std::errc();
+    return Tokenizer::parseDouble(start, end, out);
 }
 
-inline bool parseIntLine(const LineView& line, int& out){
+template <typename Int>
+inline bool parseIntLine(const LineView& line, Int& out){
     const char* p = skipSpaces(line.begin, line.end);
     return parseIntToken(p, line.end, out);
 }
@@ -140,7 +138,10 @@ enum class ColumnKind : unsigned char{
     Type,
     PosX,
     PosY,
-    PosZ
+    PosZ,
+    IntProperty,
+    Int64Property,
+    DoubleProperty
 };
 
 struct AtomColumns{
@@ -158,6 +159,9 @@ struct AtomColumns{
     bool scaled = false;
     bool valid = false;
     std::vector<ColumnKind> kinds;
+    // Destination array for property columns, indexed like kinds.
+    std::vector<void*> targets;
+    std::vector<std::string> names;
 };
 
 inline AtomColumns parseAtomColumns(const LineView& line){
@@ -172,6 +176,7 @@ inline AtomColumns parseAtomColumns(const LineView& line){
         p = skipToken(p, line.end);
         if(tokenIndex >= 2){
             std::string_view tok(start, static_cast<size_t>(p - start));
+            cols.names.emplace_back(tok);
             if(tok == "id") cols.idCol = columnIndex;
             else if(tok == "type") cols.typeCol = columnIndex;
             else if(tok == "x") cols.xCol = columnIndex;
@@ -191,6 +196,7 @@ inline AtomColumns parseAtomColumns(const LineView& line){
     cols.posZCol = cols.scaled ? cols.zsCol : cols.zCol;
     cols.valid = (cols.posXCol >= 0 && cols.posYCol >= 0 && cols.posZCol >= 0);
     cols.kinds.assign(static_cast<size_t>(columnIndex), ColumnKind::Ignore);
+    cols.targets.assign(static_cast<size_t>(columnIndex), nullptr);
 
     if(cols.idCol >= 0) cols.kinds[cols.idCol] = ColumnKind::Id;
     if(cols.typeCol >= 0) cols.kinds[cols.typeCol] = ColumnKind::Type;
@@ -224,17 +230,6 @@ inline const char* advanceLines(const char* p, const char* end, size_t lines, bo
     return p;
 }
 
-inline size_t countNewlines(const char* p, const char* end){
-    size_t count = 0;
-    while(p < end){
-        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
-        if(!nl) break;
-        ++count;
-        p = nl + 1;
-    }
-    return count;
-}
-
 inline int resolveThreads(){
     int threads = static_cast<int>(std::thread::hardware_concurrency());
     if(threads <= 0){
@@ -245,166 +240,237 @@ inline int resolveThreads(){
     return threads;
 }
 
-inline const char* parseAtomLine(
-    const char* p,
+struct AtomRow{
+    AtomId id;
+    int type;
+    bool idSet;
+    bool typeSet;
+    bool xSet;
+    bool ySet;
+    bool zSet;
+    double x;
+    double y;
+    double z;
+
+    void reset(const AtomColumns& cols, size_t row){
+        id = cols.idCol >= 0 ? 0 : static_cast<AtomId>(row + 1);
+        type = cols.typeCol >= 0 ? 0 : 1;
+        idSet = cols.idCol < 0;
+        typeSet = cols.typeCol < 0;
+        xSet = ySet = zSet = false;
+        x = y = z = 0.0;
+    }
+
+    bool accept(const AtomColumns& cols, int col, const char* start, const char* end, size_t index){
+        if(col >= static_cast<int>(cols.kinds.size())) return true;
+        switch(cols.kinds[col]){
+            case ColumnKind::Id:
+                return idSet = parseIntToken(start, end, id);
+            case ColumnKind::Type:
+                return typeSet = parseIntToken(start, end, type);
+            case ColumnKind::PosX:
+                return xSet = parseDoubleToken(start, end, x);
+            case ColumnKind::PosY:
+                return ySet = parseDoubleToken(start, end, y);
+            case ColumnKind::PosZ:
+                return zSet = parseDoubleToken(start, end, z);
+            case ColumnKind::IntProperty:
+                return parseIntToken(start, end, static_cast<int*>(cols.targets[col])[index]);
+            case ColumnKind::Int64Property:
+                return parseIntToken(start, end, static_cast<std::int64_t*>(cols.targets[col])[index]);
+            case ColumnKind::DoubleProperty:
+                return parseDoubleToken(start, end, static_cast<double*>(cols.targets[col])[index]);
+            default:
+                return true;
+        }
+    }
+
+    bool complete() const{
+        return idSet && typeSet && xSet && ySet && zSet;
+    }
+
+    Point3 position(const AtomColumns& cols, const CellMatrix& cell) const{
+        if(!cols.scaled) return Point3(x, y, z);
+        return Point3(cell.m00 * x + cell.m01 * y + cell.m02 * z + cell.m03,
+                      cell.m10 * x + cell.m11 * y + cell.m12 * z + cell.m13,
+                      cell.m20 * x + cell.m21 * y + cell.m22 * z + cell.m23);
+    }
+
+    bool store(const AtomColumns& cols, const CellMatrix& cell, LammpsParser::Frame& frame, size_t index) const{
+        if(!complete()) return false;
+        frame.positions[index] = position(cols, cell);
+        frame.ids[index] = id;
+        frame.types[index] = type;
+        return true;
+    }
+};
+
+// Parse exactly `lines` atom rows from [begin, end), the first of which is
+// row firstRow of the atom section, into slots starting at firstSlot.
+// Tokens come from the vectorised scanner; a token preceded by a newline
+// starts the next row. With a selection (ascending row numbers) only
+// those rows are stored and the tokens of all others are skipped.
+inline bool parseAtomRows(
+    const char* begin,
     const char* end,
     const AtomColumns& cols,
     const CellMatrix& cell,
     LammpsParser::Frame& frame,
-    size_t index,
-    bool& ok
+    size_t firstRow,
+    size_t lines,
+    size_t firstSlot,
+    const size_t* selected = nullptr,
+    size_t selectedCount = 0
 ){
-    int id = cols.idCol >= 0 ? 0 : static_cast<int>(index + 1);
-    int type = cols.typeCol >= 0 ? 0 : 1;
-    bool idSet = cols.idCol < 0;
-    bool typeSet = cols.typeCol < 0;
-    bool xSet = false;
-    bool ySet = false;
-    bool zSet = false;
-    double x = 0.0;
-    double y = 0.0;
-    double z = 0.0;
+    const size_t lastRow = firstRow + lines;
+    const size_t* selectedEnd = selected + selectedCount;
+    size_t rowIndex = firstRow;
+    size_t slot = firstSlot;
+    auto isKept = [&](size_t r){
+        return !selected || (selected != selectedEnd && *selected == r);
+    };
+    bool keep = isKept(rowIndex);
     int col = 0;
-
-    while(p < end){
-        char c = *p;
-        if(c == '\n'){
-            ++p;
-            break;
-        }
-        if(c == '\r'){
-            ++p;
-            continue;
-        }
-        if(c == ' ' || c == '\t'){
-            ++p;
-            continue;
-        }
-
-        const char* tokenStart = p;
-        while(p < end){
-            char cc = *p;
-            if(cc == ' ' || cc == '\t' || cc == '\n' || cc == '\r') break;
-            ++p;
-        }
-        const char* tokenEnd = p;
-
-        if(col < static_cast<int>(cols.kinds.size())){
-            switch(cols.kinds[col]){
-                case ColumnKind::Id:
-                    if(!parseIntToken(tokenStart, tokenEnd, id)) ok = false;
-                    else idSet = true;
-                    break;
-                case ColumnKind::Type:
-                    if(!parseIntToken(tokenStart, tokenEnd, type)) ok = false;
-                    else typeSet = true;
-                    break;
-                case ColumnKind::PosX:
-                    if(!parseDoubleToken(tokenStart, tokenEnd, x)) ok = false;
-                    else xSet = true;
-                    break;
-                case ColumnKind::PosY:
-                    if(!parseDoubleToken(tokenStart, tokenEnd, y)) ok = false;
-                    else ySet = true;
-                    break;
-                case ColumnKind::PosZ:
-                    if(!parseDoubleToken(tokenStart, tokenEnd, z)) ok = false;
-                    else zSet = true;
-                    break;
-                default:
-                    break;
+    AtomRow row;
+    row.reset(cols, rowIndex);
+
+    Tokenizer::TokenScanner scanner(begin, end);
+    Tokenizer::Token token;
+    while(scanner.next(token)){
+        if(token.newline && col > 0){
+            if(keep){
+                if(!row.store(cols, cell, frame, slot++)) return false;
+                if(selected) ++selected;
             }
+            keep = isKept(++rowIndex);
+            row.reset(cols, rowIndex);
+            col = 0;
         }
+        if(rowIndex >= lastRow) return false;
+        if(keep && !row.accept(cols, col, token.begin, token.end, slot)) return false;
         ++col;
     }
 
-    if(!idSet || !typeSet || !xSet || !ySet || !zSet){
-        ok = false;
-        return p;
+    if(col > 0){
+        if(keep && !row.store(cols, cell, frame, slot)) return false;
+        ++rowIndex;
     }
+    return rowIndex == lastRow;
+}
 
-    if(cols.scaled){
-        const double px = cell.m00 * x + cell.m01 * y + cell.m02 * z + cell.m03;
-        const double py = cell.m10 * x + cell.m11 * y + cell.m12 * z + cell.m13;
-        const double pz = cell.m20 * x + cell.m21 * y + cell.m22 * z + cell.m23;
-        frame.positions[index] = Point3(px, py, pz);
-    }else{
-        frame.positions[index] = Point3(x, y, z);
+// First pass of a filtered parse: decode only type and position of the
+// `lines` rows in [begin, end) and append the numbers of the rows the
+// filter keeps. cols must have every other column set to Ignore.
+inline bool selectAtomRows(
+    const char* begin,
+    const char* end,
+    const AtomColumns& cols,
+    const CellMatrix& cell,
+    const FrameAtomFilter& filter,
+    size_t firstRow,
+    size_t lines,
+    std::vector<size_t>& selected
+){
+    const size_t lastRow = firstRow + lines;
+    size_t rowIndex = firstRow;
+    int col = 0;
+    AtomRow row;
+    row.reset(cols, rowIndex);
+
+    auto finishRow = [&](){
+        if(!row.complete()) return false;
+        if(filter.accepts(row.position(cols, cell), row.type)) selected.push_back(rowIndex);
+        return true;
+    };
+
+    Tokenizer::TokenScanner scanner(begin, end);
+    Tokenizer::Token token;
+    while(scanner.next(token)){
+        if(token.newline && col > 0){
+            if(!finishRow()) return false;
+            row.reset(cols, ++rowIndex);
+            col = 0;
+        }
+        if(rowIndex >= lastRow) return false;
+        if(!row.accept(cols, col, token.begin, token.end, 0)) return false;
+        ++col;
     }
 
-    frame.ids[index] = id;
-    frame.types[index] = type;
-    return p;
+    if(col > 0){
+        if(!finishRow()) return false;
+        ++rowIndex;
+    }
+    return rowIndex == lastRow;
 }
 
-#if defined(__unix__) || defined(__APPLE__)
-class MappedFile{
-public:
-    explicit MappedFile(const std::string& filename){
-        fd_ = open(filename.c_str(), O_RDONLY);
-        if(fd_ < 0) return;
+// Split the atom section into one chunk per thread on line boundaries and
+// count the rows in each. Fails unless the counts add up to natoms.
+inline bool splitAtomSection(
+    const char* atomBegin,
+    const char* atomEnd,
+    const char* end,
+    int threads,
+    size_t natoms,
+    std::vector<const char*>& chunkStarts,
+    std::vector<size_t>& counts
+){
+    chunkStarts.assign(static_cast<size_t>(threads + 1), atomEnd);
+    counts.assign(static_cast<size_t>(threads), 0);
+    chunkStarts[0] = atomBegin;
+    if(threads <= 1){
+        counts[0] = natoms;
+        return true;
+    }
 
-        struct stat st{};
-        if(fstat(fd_, &st) != 0 || st.st_size <= 0){
-            close(fd_);
-            fd_ = -1;
-            return;
-        }
-        size_ = static_cast<size_t>(st.st_size);
-        data_ = static_cast<const char*>(mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0));
-        if(data_ == MAP_FAILED){
-            data_ = nullptr;
-            close(fd_);
-            fd_ = -1;
-            return;
-        }
-#ifdef POSIX_FADV_SEQUENTIAL
-        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
-#endif
-#ifdef MADV_SEQUENTIAL
-        madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
-#endif
-#ifdef MADV_WILLNEED
-        madvise(const_cast<char*>(data_), size_, MADV_WILLNEED);
-#endif
-        valid_ = true;
-    }
-
-    ~MappedFile(){
-        if(data_){
-            munmap(const_cast<char*>(data_), size_);
-        }
-        if(fd_ >= 0){
-            close(fd_);
+    size_t totalBytes = static_cast<size_t>(atomEnd - atomBegin);
+    for(int i = 1; i < threads; ++i){
+        const char* approx = atomBegin + (totalBytes * static_cast<size_t>(i)) / static_cast<size_t>(threads);
+        if(approx > atomBegin && *(approx - 1) == '\n'){
+            chunkStarts[i] = approx;
+        }else{
+            const char* nl = static_cast<const char*>(std::memchr(approx, '\n', atomEnd - approx));
+            chunkStarts[i] = nl ? (nl + 1) : atomEnd;
         }
     }
 
-    bool valid() const { return valid_; }
-    const char* data() const { return data_; }
-    size_t size() const { return size_; }
+#pragma omp parallel for schedule(static)
+    for(int i = 0; i < threads; ++i){
+        counts[static_cast<size_t>(i)] = Tokenizer::countNewlines(chunkStarts[i], chunkStarts[i + 1]);
+    }
 
-private:
-    int fd_ = -1;
-    const char* data_ = nullptr;
-    size_t size_ = 0;
-    bool valid_ = false;
-};
-#endif
+    size_t totalLines = std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0));
+    if(totalLines < natoms){
+        if(atomEnd == end && atomEnd > atomBegin && *(atomEnd - 1) != '\n' &&
+           (natoms - totalLines) == 1){
+            counts.back() += 1;
+            ++totalLines;
+        }
+    }
+
+    return totalLines == natoms;
+}
 
-inline bool parseMapped(const char* data, size_t size, LammpsParser::Frame& frame){
-    const char* cursor = data;
-    const char* end = data + size;
+// Parse the frame starting at cursor. On success the cursor is left at the
+// first byte after the frame's atom section, i.e. at the next ITEM: TIMESTEP.
+inline bool parseMappedFrame(
+    const char*& cursor,
+    const char* end,
+    const std::vector<LammpsParser::ColumnRequest>& requests,
+    const LammpsParser::AtomFilter& atomFilter,
+    LammpsParser::Frame& frame
+){
     LineView line;
 
     if(!readLine(cursor, end, line) || !lineStartsWith(line, "ITEM: TIMESTEP")) return false;
     if(!readLine(cursor, end, line) || !parseIntLine(line, frame.timestep)) return false;
     if(!readLine(cursor, end, line) || !lineStartsWith(line, "ITEM: NUMBER OF ATOMS")) return false;
-    if(!readLine(cursor, end, line) || !parseIntLine(line, frame.natoms)) return false;
 
-    if(frame.natoms <= 0) return false;
-    frame.positions.resize(frame.natoms);
-    frame.types.resize(frame.natoms);
-    frame.ids.resize(frame.natoms);
+    // With a filter only the selected atoms need to fit in AtomIndex.
+    std::int64_t natoms = 0;
+    if(!readLine(cursor, end, line) || !parseIntLine(line, natoms)) return false;
+    if(atomFilter.isActive() ? natoms <= 0 : !LammpsParser::acceptAtomCount(natoms)) return false;
+    frame.natoms = natoms;
+    frame.positionProperty.reset();
 
     if(!readLine(cursor, end, line) || !lineStartsWith(line, "ITEM: BOX BOUNDS")) return false;
     bool pbcX = true, pbcY = true, pbcZ = true;
@@ -416,26 +482,7 @@ inline bool parseMapped(const char* data, size_t size, LammpsParser::Frame& fram
         if(!parseBoundsLine(line, lo[i], hi[i], tilt[i])) return false;
     }
 
-    Point3 minc(lo[0], lo[1], lo[2]);
-    Point3 maxc(hi[0], hi[1], hi[2]);
-
-    double t0 = tilt[0], t1 = tilt[1];
-    double dxmin = std::min({ t0, t1, t0 + t1, 0.0 });
-    double dxmax = std::max({ t0, t1, t0 + t1, 0.0 });
-    minc.x() -= dxmin;
-    maxc.x() -= dxmax;
-
-    double t2 = tilt[2];
-    minc.y() -= std::min(t2, 0.0);
-    maxc.y() -= std::max(t2, 0.0);
-
-    Vector3 a(maxc.x() - minc.x(), 0.0, 0.0);
-    Vector3 b(tilt[0], maxc.y() - minc.y(), 0.0);
-    Vector3 c(tilt[1], tilt[2], maxc.z() - minc.z());
-    Point3 origin = minc;
-
-    AffineTransformation M(a, b, c, origin - Point3::Origin());
-    frame.simulationCell.setMatrix(M);
+    frame.simulationCell.setMatrix(LammpsParser::boxMatrix(lo, hi, tilt));
     frame.simulationCell.setPbcFlags(pbcX, pbcY, pbcZ);
 
     if(!readLine(cursor, end, line) || !lineStartsWith(line, "ITEM: ATOMS")) return false;
@@ -456,93 +503,110 @@ inline bool parseMapped(const char* data, size_t size, LammpsParser::Frame& fram
 
     const char* atomBegin = cursor;
     bool okLines = false;
-    const char* atomEnd = advanceLines(atomBegin, end, static_cast<size_t>(frame.natoms), okLines);
+    const char* atomEnd = advanceLines(atomBegin, end, static_cast<size_t>(natoms), okLines);
     if(!okLines) return false;
 
     int threads = resolveThreads();
-    if(threads <= 1){
-        const char* p = atomBegin;
-        for(size_t i = 0; i < static_cast<size_t>(frame.natoms); ++i){
-            bool ok = true;
-            p = parseAtomLine(p, atomEnd, cols, cell, frame, i, ok);
-            if(!ok) return false;
+    std::vector<const char*> chunkStarts;
+    std::vector<size_t> counts;
+    if(!splitAtomSection(atomBegin, atomEnd, end, threads, static_cast<size_t>(natoms), chunkStarts, counts)) return false;
+
+    std::vector<size_t> rowOffsets(static_cast<size_t>(threads + 1), 0);
+    for(int i = 0; i < threads; ++i){
+        rowOffsets[static_cast<size_t>(i + 1)] = rowOffsets[static_cast<size_t>(i)] + counts[static_cast<size_t>(i)];
+    }
+
+    // Filtered frames take a first pass that reads only types and
+    // positions and records the kept rows, so the frame arrays and the
+    // requested columns can be sized to the selection before any atom is
+    // stored.
+    const FrameAtomFilter filter(atomFilter, frame.simulationCell);
+    std::vector<std::vector<size_t>> selected;
+    std::vector<size_t> slotOffsets = rowOffsets;
+    if(filter.isActive()){
+        AtomColumns probe = cols;
+        probe.idCol = -1;
+        for(ColumnKind& kind : probe.kinds){
+            if(kind == ColumnKind::Id) kind = ColumnKind::Ignore;
         }
-    }else{
-        size_t totalBytes = static_cast<size_t>(atomEnd - atomBegin);
-        std::vector<const char*> chunkStarts(static_cast<size_t>(threads + 1));
-        chunkStarts[0] = atomBegin;
-        chunkStarts[threads] = atomEnd;
-
-        for(int i = 1; i < threads; ++i){
-            const char* approx = atomBegin + (totalBytes * static_cast<size_t>(i)) / static_cast<size_t>(threads);
-            if(approx > atomBegin && *(approx - 1) == '\n'){
-                chunkStarts[i] = approx;
-            }else{
-                const char* nl = static_cast<const char*>(std::memchr(approx, '\n', atomEnd - approx));
-                chunkStarts[i] = nl ? (nl + 1) : atomEnd;
+
+        selected.resize(static_cast<size_t>(threads));
+        std::atomic<bool> selectFailed(false);
+#pragma omp parallel for schedule(static)
+        for(int i = 0; i < threads; ++i){
+            if(selectFailed.load(std::memory_order_relaxed)) continue;
+            if(!selectAtomRows(chunkStarts[i], chunkStarts[i + 1], probe, cell, filter,
+                               rowOffsets[static_cast<size_t>(i)], counts[static_cast<size_t>(i)],
+                               selected[static_cast<size_t>(i)])){
+                selectFailed.store(true, std::memory_order_relaxed);
             }
         }
+        if(selectFailed.load(std::memory_order_relaxed)) return false;
 
-        std::vector<size_t> counts(static_cast<size_t>(threads), 0);
-#pragma omp parallel for schedule(static)
         for(int i = 0; i < threads; ++i){
-            counts[static_cast<size_t>(i)] = countNewlines(chunkStarts[i], chunkStarts[i + 1]);
+            slotOffsets[static_cast<size_t>(i + 1)] = slotOffsets[static_cast<size_t>(i)] + selected[static_cast<size_t>(i)].size();
         }
+        const size_t kept = slotOffsets.back();
+        if(kept > 0 && !LammpsParser::acceptAtomCount(static_cast<std::int64_t>(kept))) return false;
+        frame.natoms = static_cast<std::int64_t>(kept);
 
-        size_t totalLines = std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0));
-        if(totalLines < static_cast<size_t>(frame.natoms)){
-            if(atomEnd == end && atomEnd > atomBegin && *(atomEnd - 1) != '\n' &&
-               (static_cast<size_t>(frame.natoms) - totalLines) == 1){
-                counts.back() += 1;
-                ++totalLines;
-            }
+        frame.sourceIndices.resize(kept);
+        for(int i = 0; i < threads; ++i){
+            const auto& rows = selected[static_cast<size_t>(i)];
+            std::copy(rows.begin(), rows.end(), frame.sourceIndices.begin() + slotOffsets[static_cast<size_t>(i)]);
         }
+    }else{
+        frame.sourceIndices.clear();
+    }
 
-        if(totalLines != static_cast<size_t>(frame.natoms)) return false;
+    frame.positions.resize(frame.natoms);
+    frame.types.resize(frame.natoms);
+    frame.ids.resize(frame.natoms);
 
-        std::vector<size_t> offsets(static_cast<size_t>(threads + 1), 0);
-        for(int i = 0; i < threads; ++i){
-            offsets[static_cast<size_t>(i + 1)] = offsets[static_cast<size_t>(i)] + counts[static_cast<size_t>(i)];
+    for(const BoundColumn& column : bindRequestedColumns(cols.names, requests, frame)){
+        switch(column.dataType){
+            case Particles::DataType::Int: cols.kinds[column.column] = ColumnKind::IntProperty; break;
+            case Particles::DataType::Int64: cols.kinds[column.column] = ColumnKind::Int64Property; break;
+            default: cols.kinds[column.column] = ColumnKind::DoubleProperty; break;
         }
+        cols.targets[column.column] = column.data;
+    }
 
-        std::atomic<bool> parseFailed(false);
+    std::atomic<bool> parseFailed(false);
 #pragma omp parallel for schedule(static)
-        for(int i = 0; i < threads; ++i){
-            if(parseFailed.load(std::memory_order_relaxed)) continue;
-            const char* p = chunkStarts[i];
-            const char* chunkEnd = chunkStarts[i + 1];
-            size_t index = offsets[static_cast<size_t>(i)];
-            size_t lines = counts[static_cast<size_t>(i)];
-            for(size_t lineIdx = 0; lineIdx < lines; ++lineIdx){
-                if(parseFailed.load(std::memory_order_relaxed)) break;
-                bool ok = true;
-                p = parseAtomLine(p, chunkEnd, cols, cell, frame, index, ok);
-                if(!ok){
-                    parseFailed.store(true, std::memory_order_relaxed);
-                    break;
-                }
-                ++index;
-            }
+    for(int i = 0; i < threads; ++i){
+        if(parseFailed.load(std::memory_order_relaxed)) continue;
+        const size_t* rows = filter.isActive() ? selected[static_cast<size_t>(i)].data() : nullptr;
+        const size_t rowCount = filter.isActive() ? selected[static_cast<size_t>(i)].size() : 0;
+        if(!parseAtomRows(chunkStarts[i], chunkStarts[i + 1], cols, cell, frame,
+                          rowOffsets[static_cast<size_t>(i)], counts[static_cast<size_t>(i)],
+                          slotOffsets[static_cast<size_t>(i)], rows, rowCount)){
+            parseFailed.store(true, std::memory_order_relaxed);
         }
-
-        if(parseFailed.load(std::memory_order_relaxed)) return false;
     }
+    if(parseFailed.load(std::memory_order_relaxed)) return false;
 
+    cursor = atomEnd;
     return true;
 }
 
+// Skip blank lines between frames. Returns true if another frame follows.
+inline bool skipBlankLines(const char*& cursor, const char* end){
+    while(cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) ++cursor;
+    return cursor < end;
+}
+
 } // namespace
 
 // Parse a LAMMPS dump file into a Frame structure.
 // Opens the given filename for input and hands the resulting stream to parseStream().
 // If the file cannot be opened, reports an error and returns false.
 bool LammpsParser::parseFile(const std::string &filename, Frame &frame){
-#if defined(__unix__) || defined(__APPLE__)
     MappedFile mapped(filename);
     if(mapped.valid()){
-        return parseMapped(mapped.data(), mapped.size(), frame);
+        const char* cursor = mapped.data();
+        return parseMappedFrame(cursor, mapped.data() + mapped.size(), _requestedColumns, _atomFilter, frame);
     }
-#endif
 
     std::ifstream file(filename, std::ios::binary);
     if(!file.is_open()){
@@ -553,6 +617,154 @@ bool LammpsParser::parseFile(const std::string &filename, Frame &frame){
     return parseStream(file, frame);
 }
 
+// Map the trajectory once. Readahead is left to the kernel's sequential
+// heuristics since the file may be far larger than physical memory.
+LammpsParser::TrajectoryReader::TrajectoryReader(const std::string &filename)
+    : _mapped(std::make_unique<MappedFile>(filename, false)), _path(filename){
+    if(_mapped->valid()){
+        _cursor = _mapped->data();
+        _released = _mapped->data();
+        return;
+    }
+
+    _mapped.reset();
+    _stream.open(filename, std::ios::binary);
+    if(!_stream.is_open()){
+        spdlog::error("Cannot open trajectory {}", filename);
+        _failed = true;
+    }
+}
+
+LammpsParser::TrajectoryReader::~TrajectoryReader() = default;
+
+bool LammpsParser::TrajectoryReader::isOpen() const{
+    return _mapped != nullptr || _stream.is_open();
+}
+
+// Parse the next frame into the given Frame. Its vectors are resized in
+// place, so passing the same Frame on every call keeps their capacity and
+// avoids per-frame allocations. Returns false at end of file or on a
+// malformed frame; failed() tells the two apart.
+bool LammpsParser::TrajectoryReader::next(Frame &frame){
+    if(_failed) return false;
+
+    if(_mapped){
+        const char* end = _mapped->data() + _mapped->size();
+        if(!skipBlankLines(_cursor, end)) return false;
+
+        const char* frameBegin = _cursor;
+        if(!parseMappedFrame(_cursor, end, _requestedColumns, _atomFilter, frame)){
+            spdlog::error("Malformed frame {} at byte offset {}", _framesRead, frameBegin - _mapped->data());
+            _failed = true;
+            return false;
+        }
+
+        // Pages behind the cursor are never touched again.
+        _mapped->release(_released, frameBegin);
+        _released = frameBegin;
+        if(_prefetch){
+            // Frames of a trajectory are usually the same size, so the one
+            // just parsed estimates how much the next call will touch.
+            _mapped->willNeed(_cursor, _cursor + std::min<size_t>(end - _cursor, _cursor - frameBegin));
+        }
+    }else{
+        if(!_stream.is_open()) return false;
+        _stream >> std::ws;
+        if(_stream.eof()) return false;
+        LammpsParser parser;
+        parser.setRequestedColumns(_requestedColumns);
+        parser.setAtomFilter(_atomFilter);
+        if(!parser.parseStream(_stream, frame)){
+            spdlog::error("Malformed frame {} in trajectory stream", _framesRead);
+            _failed = true;
+            return false;
+        }
+    }
+
+    ++_framesRead;
+    return true;
+}
+
+// Restart iteration from the first frame.
+void LammpsParser::TrajectoryReader::rewind(){
+    _failed = false;
+    _framesRead = 0;
+    if(_mapped){
+        _cursor = _mapped->data();
+        _released = _mapped->data();
+    }else if(_stream.is_open()){
+        _stream.clear();
+        _stream.seekg(0);
+    }
+}
+
+bool LammpsParser::TrajectoryReader::ensureIndex(){
+    if(_indexed) return true;
+    if(!_mapped) return false;
+    _indexed = _index.open(_path, _mapped->data(), _mapped->size());
+    return _indexed;
+}
+
+size_t LammpsParser::TrajectoryReader::frameCount(){
+    return ensureIndex() ? _index.size() : 0;
+}
+
+// Position the reader so the next call to next() yields the given frame.
+bool LammpsParser::TrajectoryReader::seek(size_t frameIndex){
+    if(!ensureIndex() || frameIndex >= _index.size()) return false;
+    _failed = false;
+    _cursor = _mapped->data() + _index[frameIndex].offset;
+    _released = _cursor;
+    _framesRead = frameIndex;
+    return true;
+}
+
+bool LammpsParser::parseFile(const std::string &filename, size_t frameIndex, Frame &frame){
+    MappedFile mapped(filename, false);
+    if(!mapped.valid()){
+        spdlog::error("Cannot map {} for indexed access", filename);
+        return false;
+    }
+
+    FrameIndex index;
+    if(!index.open(filename, mapped.data(), mapped.size())){
+        spdlog::error("Cannot index frames of {}", filename);
+        return false;
+    }
+    if(frameIndex >= index.size()){
+        spdlog::error("Frame {} out of range, {} contains {} frames", frameIndex, filename, index.size());
+        return false;
+    }
+
+    const FrameIndexEntry& entry = index[frameIndex];
+    mapped.willNeed(mapped.data() + entry.offset, mapped.data() + entry.end);
+    const char* cursor = mapped.data() + entry.offset;
+    return parseMappedFrame(cursor, mapped.data() + mapped.size(), _requestedColumns, _atomFilter, frame);
+}
+
+// Build the cell matrix from LAMMPS box bounds. For triclinic boxes the
+// dump stores the bounding box of the tilted cell, so the tilt offsets are
+// removed from lo/hi before the edge vectors are formed.
+AffineTransformation LammpsParser::boxMatrix(const double lo[3], const double hi[3], const double tilt[3]){
+    Point3 minc(lo[0], lo[1], lo[2]);
+    Point3 maxc(hi[0], hi[1], hi[2]);
+
+    double t0 = tilt[0], t1 = tilt[1];
+    double dxmin = std::min({ t0, t1, t0 + t1, 0.0 });
+    double dxmax = std::max({ t0, t1, t0 + t1, 0.0 });
+    minc.x() -= dxmin;
+    maxc.x() -= dxmax;
+
+    double t2 = tilt[2];
+    minc.y() -= std::min(t2, 0.0);
+    maxc.y() -= std::max(t2, 0.0);
+
+    Vector3 a(maxc.x() - minc.x(), 0.0, 0.0);
+    Vector3 b(tilt[0], maxc.y() - minc.y(), 0.0);
+    Vector3 c(tilt[1], tilt[2], maxc.z() - minc.z());
+    return AffineTransformation(a, b, c, minc - Point3::Origin());
+}
+
 // Parse a LAMMPS dump from any input stream.
 // Return header lines, box bounds, and atom data in sequence.
 // If any stage fails, the function aborts and returns false.
@@ -566,6 +778,44 @@ bool LammpsParser::parseStream(std::istream &in, Frame &frame){
     return true;
 }
 
+bool LammpsParser::acceptAtomCount(std::int64_t natoms){
+    if(natoms <= 0) return false;
+    if(static_cast<std::uint64_t>(natoms) > MaxAtomCount){
+        spdlog::error("Frame has {} atoms, more than the {} supported with {}-bit atom indices; rebuild with OPENDXA_64BIT_INDICES=ON",
+            natoms, MaxAtomCount, sizeof(AtomIndex) * 8);
+        return false;
+    }
+    return true;
+}
+
+const Point3* LammpsParser::Frame::positionData() const{
+    const std::size_t count = static_cast<std::size_t>(natoms);
+    if(positionProperty && positionProperty->size() == count){
+        return positionProperty->constDataPoint3();
+    }
+    if(positions.size() == count && count > 0){
+        return positions.data();
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Particles::ParticleProperty> LammpsParser::createPositionProperty(const Frame &frame){
+    const std::size_t count = static_cast<std::size_t>(frame.natoms);
+    if(frame.positionProperty && frame.positionProperty->size() == count){
+        return frame.positionProperty;
+    }
+
+    const Point3* positions = frame.positionData();
+    if(!positions){
+        spdlog::error("Frame has no positions for its {} atoms", frame.natoms);
+        return nullptr;
+    }
+
+    auto property = std::make_shared<Particles::ParticleProperty>(count, Particles::ParticleProperty::PositionProperty, 0, false);
+    std::copy(positions, positions + count, property->dataPoint3());
+    return property;
+}
+
 // Read and validate the LAMMPS dump header.
 // Expects an "ITEM: TIMESTEP" line followed by the timestep number,
 // then "ITEM: NUMBER OF ATOMS" and the atom count. Reserves spaces in 
@@ -579,20 +829,25 @@ bool LammpsParser::readHeader(std::istream &in, Frame &f) {
 
     // Next line is the timestep integer
     std::getline(in, line);
-    f.timestep = std::stoi(line);
+    f.timestep = std::stoll(line);
     
     // Skip "ITEM: NUMBER OF ATOMS" and read the atom count
     std::getline(in, line);
     std::getline(in, line);
     
     // Reserve vectors to avoid reallocations
-    f.natoms = std::stoi(line);
+    f.natoms = std::stoll(line);
+    if(_atomFilter.isActive() ? f.natoms <= 0 : !acceptAtomCount(f.natoms)) return false;
+    f.positionProperty.reset();
     f.positions.clear();
     f.types.clear();
     f.ids.clear();
-    f.positions.reserve(f.natoms);
-    f.types.reserve(f.natoms);
-    f.ids.reserve(f.natoms);
+    f.sourceIndices.clear();
+    if(!_atomFilter.isActive()){
+        f.positions.reserve(f.natoms);
+        f.types.reserve(f.natoms);
+        f.ids.reserve(f.natoms);
+    }
     
     return true;
 }
@@ -640,28 +895,7 @@ bool LammpsParser::readBoxBounds(std::istream &in, Frame &f){
         // If no tilt factor, it remains 0.0 (orthogonal box)
     }
 
-    // Adjust min/max for triclinic tilf offsets
-    Point3 minc(lo[0], lo[1], lo[2]);
-    Point3 maxc(hi[0], hi[1], hi[2]);
-
-    double t0 = tilt[0], t1 = tilt[1];
-    double dxmin = std::min({ t0, t1, t0 + t1, 0.0 });
-    double dxmax = std::max({ t0, t1, t0 + t1, 0.0 });
-    minc.x() -= dxmin;
-    maxc.x() -= dxmax;
-
-    double t2 = tilt[2];
-    minc.y() -= std::min(t2, 0.0);
-    maxc.y() -= std::max(t2, 0.0);
-
-    // Build the cell matrix columns a, b, c and origin shift
-    Vector3 a(maxc.x() - minc.x(), 0.0, 0.0);
-    Vector3 b(tilt[0], maxc.y() - minc.y(), 0.0);
-    Vector3 c(tilt[1], tilt[2], maxc.z() - minc.z());
-    Point3 origin = minc;
-
-    AffineTransformation M(a, b, c, origin - Point3::Origin());
-    f.simulationCell.setMatrix(M);
+    f.simulationCell.setMatrix(boxMatrix(lo, hi, tilt));
     f.simulationCell.setPbcFlags(pbcX, pbcY, pbcZ);
 
     return true;
@@ -687,11 +921,14 @@ bool LammpsParser::readAtomData(std::istream &in, Frame &f){
     int ysCol = findColumn(cols, "ys");
     int zsCol = findColumn(cols, "zs");
     bool scaled = (xsCol >= 0 && ysCol >= 0 && zsCol >=0 );
+    std::vector<BoundColumn> properties = bindRequestedColumns(cols, _requestedColumns, f);
+    const FrameAtomFilter filter(_atomFilter, f.simulationCell);
+    const std::int64_t rows = f.natoms;
 
     std::vector<std::string> vals;
     vals.reserve(cols.size());
 
-    for(int i=0; i<f.natoms; ++i){
+    for(std::int64_t i = 0; i < rows; ++i){
         if(!std::getline(in, line)){
             return false;
         }
@@ -704,7 +941,7 @@ bool LammpsParser::readAtomData(std::istream &in, Frame &f){
             vals.push_back(v);
         }
 
-        int id = idCol >= 0 ? std::stoi(vals[idCol]) : (i+1);
+        AtomId id = idCol >= 0 ? std::stoll(vals[idCol]) : (i+1);
         int type = typeCol >= 0 ? std::stoi(vals[typeCol]) : 1;
         double px, py, pz;
         
@@ -720,9 +957,34 @@ bool LammpsParser::readAtomData(std::istream &in, Frame &f){
             pz = std::stod(vals[zCol]);
         }
 
+        if(filter.isActive()){
+            if(!filter.accepts(Point3(px, py, pz), type)) continue;
+            f.sourceIndices.push_back(static_cast<size_t>(i));
+        }
+
+        const size_t slot = f.ids.size();
         f.ids.push_back(id);
         f.types.push_back(type);
         f.positions.emplace_back(px, py, pz);
+
+        for(const BoundColumn& column : properties){
+            const std::string& value = vals[column.column];
+            switch(column.dataType){
+                case Particles::DataType::Int: static_cast<int*>(column.data)[slot] = std::stoi(value); break;
+                case Particles::DataType::Int64: static_cast<std::int64_t*>(column.data)[slot] = std::stoll(value); break;
+                default: static_cast<double*>(column.data)[slot] = std::stod(value); break;
+            }
+        }
+    }
+
+    // The stream path cannot size the requested columns up front, so they
+    // are allocated for every row and shrunk to the selection here.
+    if(filter.isActive()){
+        f.natoms = static_cast<std::int64_t>(f.ids.size());
+        if(f.natoms > 0 && !acceptAtomCount(f.natoms)) return false;
+        for(auto& [name, property] : f.properties){
+            property->resize(f.ids.size(), true);
+        }
     }
     return true;
 }
@@ -0,0 +1,106 @@
+#include <opendxa/core/mapped_file.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace OpenDXA{
+
+#if defined(__unix__) || defined(__APPLE__)
+
+MappedFile::MappedFile(const std::string& filename, bool prefetch, bool copyOnWrite){
+    _fd = open(filename.c_str(), O_RDONLY);
+    if(_fd < 0) return;
+
+    struct stat st{};
+    if(fstat(_fd, &st) != 0 || st.st_size <= 0){
+        close(_fd);
+        _fd = -1;
+        return;
+    }
+    _size = static_cast<size_t>(st.st_size);
+    const int protection = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    _data = static_cast<const char*>(mmap(nullptr, _size, protection, MAP_PRIVATE, _fd, 0));
+    if(_data == MAP_FAILED){
+        _data = nullptr;
+        close(_fd);
+        _fd = -1;
+        return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#ifdef MADV_SEQUENTIAL
+    madvise(const_cast<char*>(_data), _size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+    if(prefetch){
+        madvise(const_cast<char*>(_data), _size, MADV_WILLNEED);
+    }
+#endif
+    _copyOnWrite = copyOnWrite;
+    _valid = true;
+}
+
+MappedFile::~MappedFile(){
+    if(_data){
+        munmap(const_cast<char*>(_data), _size);
+    }
+    if(_fd >= 0){
+        close(_fd);
+    }
+}
+
+// Round the range inwards to page boundaries relative to the mapping
+// start, which is itself page aligned.
+static bool pageRange(const char* base, size_t size, const char* begin, const char* end, char*& start, size_t& length){
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if(begin < base) begin = base;
+    if(end > base + size) end = base + size;
+    if(end <= begin) return false;
+    size_t first = ((static_cast<size_t>(begin - base) + page - 1) / page) * page;
+    size_t last = (static_cast<size_t>(end - base) / page) * page;
+    if(last <= first) return false;
+    start = const_cast<char*>(base) + first;
+    length = last - first;
+    return true;
+}
+
+void MappedFile::release(const char* begin, const char* end) const{
+#ifdef MADV_DONTNEED
+    if(!_valid) return;
+    char* start = nullptr;
+    size_t length = 0;
+    if(pageRange(_data, _size, begin, end, start, length)){
+        madvise(start, length, MADV_DONTNEED);
+    }
+#endif
+}
+
+void MappedFile::willNeed(const char* begin, const char* end) const{
+#ifdef MADV_WILLNEED
+    if(!_valid) return;
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if(begin < _data) begin = _data;
+    if(end > _data + _size) end = _data + _size;
+    if(end <= begin) return;
+    // Expand outwards here; prefetching a partial page is harmless.
+    size_t first = (static_cast<size_t>(begin - _data) / page) * page;
+    size_t length = static_cast<size_t>(end - _data) - first;
+    madvise(const_cast<char*>(_data) + first, length, MADV_WILLNEED);
+#endif
+}
+
+#else
+
+MappedFile::MappedFile(const std::string&, bool, bool){}
+MappedFile::~MappedFile(){}
+void MappedFile::release(const char*, const char*) const{}
+void MappedFile::willNeed(const char*, const char*) const{}
+
+#endif
+
+}
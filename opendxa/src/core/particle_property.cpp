@@ -17,8 +17,9 @@ ParticleProperty::ParticleProperty(size_t particleCount,
                                    bool   initializeMemory)
     : PropertyBase(
         particleCount,
-        // Determina el tipo de dato según el tipo estándar
-        (type == ParticleTypeProperty || type == StructureTypeProperty || type == SelectionProperty || type == ClusterProperty || type == CoordinationProperty || type == IdentifierProperty || type == MoleculeProperty || type == MoleculeTypeProperty || type == PeriodicImageProperty) ? DataType::Int :
+        // Determina el tipo de dato según el tipo estándar (los identificadores son AtomId, 64 bits)
+        (type == IdentifierProperty) ? DataType::Int64 :
+        (type == ParticleTypeProperty || type == StructureTypeProperty || type == SelectionProperty || type == ClusterProperty || type == CoordinationProperty || type == MoleculeProperty || type == MoleculeTypeProperty || type == PeriodicImageProperty) ? DataType::Int :
         (type == UserProperty) ? DataType::Void : DataType::Double,
         // Usa el componentCount del usuario si es válido, si no el estándar
         (componentCount > 0) ? componentCount :
@@ -27,14 +28,15 @@ ParticleProperty::ParticleProperty(size_t particleCount,
         (type == DeformationGradientProperty || type == ElasticDeformationGradientProperty) ? 9 :
         (type == OrientationProperty || type == RotationProperty) ? 4 : 1,
         // Calcula el stride según el componentCount efectivo y tipo de dato
-        (componentCount > 0) ? ((type == ParticleTypeProperty || type == StructureTypeProperty || type == SelectionProperty || type == ClusterProperty || type == CoordinationProperty || type == IdentifierProperty || type == MoleculeProperty || type == MoleculeTypeProperty || type == PeriodicImageProperty) ? componentCount * sizeof(int) : componentCount * sizeof(double)) :
+        (componentCount > 0) ? ((type == IdentifierProperty) ? componentCount * sizeof(std::int64_t) : (type == ParticleTypeProperty || type == StructureTypeProperty || type == SelectionProperty || type == ClusterProperty || type == CoordinationProperty || type == MoleculeProperty || type == MoleculeTypeProperty || type == PeriodicImageProperty) ? componentCount * sizeof(int) : componentCount * sizeof(double)) :
         (type == PositionProperty || type == DisplacementProperty || type == VelocityProperty || type == ForceProperty || type == DipoleOrientationProperty || type == AngularVelocityProperty || type == AngularMomentumProperty || type == TorqueProperty || type == AsphericalShapeProperty) ? sizeof(Vector3) :
         (type == ColorProperty || type == VectorColorProperty) ? 3 * sizeof(double) :
         (type == StressTensorProperty || type == StrainTensorProperty || type == ElasticStrainTensorProperty || type == StretchTensorProperty) ? sizeof(SymmetricTensor2) :
         (type == DeformationGradientProperty || type == ElasticDeformationGradientProperty) ? 9 * sizeof(double) :
         (type == OrientationProperty || type == RotationProperty) ? sizeof(Quaternion) :
         (type == PeriodicImageProperty) ? 3 * sizeof(int) :
-        (type == ParticleTypeProperty || type == StructureTypeProperty || type == SelectionProperty || type == ClusterProperty || type == CoordinationProperty || type == IdentifierProperty || type == MoleculeProperty || type == MoleculeTypeProperty) ? sizeof(int) : sizeof(double),
+        (type == IdentifierProperty) ? sizeof(std::int64_t) :
+        (type == ParticleTypeProperty || type == StructureTypeProperty || type == SelectionProperty || type == ClusterProperty || type == CoordinationProperty || type == MoleculeProperty || type == MoleculeTypeProperty) ? sizeof(int) : sizeof(double),
         initializeMemory)
     , _type(type)
 {
@@ -57,6 +59,19 @@ ParticleProperty::ParticleProperty(size_t              particleCount,
 {
 }
 
+// Ctor sobre memoria externa (sin copia)
+ParticleProperty::ParticleProperty(void*               externalData,
+                                   size_t              particleCount,
+                                   DataType            dataType,
+                                   size_t              componentCount,
+                                   size_t              stride,
+                                   std::shared_ptr<const void> keepAlive,
+                                   Type                type)
+    : PropertyBase(externalData, particleCount, dataType, componentCount, stride, std::move(keepAlive))
+    , _type(type)
+{
+}
+
 // Copy ctor
 ParticleProperty::ParticleProperty(const ParticleProperty& other)
     : PropertyBase(other)
@@ -54,13 +54,26 @@ PropertyBase::PropertyBase(
 	}
 }
 
+PropertyBase::PropertyBase(
+	void* externalData,
+	size_t count,
+	DataType dataType,
+	size_t componentCount,
+	size_t stride,
+	std::shared_ptr<const void> keepAlive
+) : PropertyBase(0, dataType, componentCount, stride, false){
+	_externalData = static_cast<uint8_t*>(externalData);
+	_keepAlive = std::move(keepAlive);
+	_numElements = count;
+}
+
 PropertyBase::PropertyBase(const PropertyBase& other)
 	: _dataType(other._dataType), _dataTypeSize(other._dataTypeSize), _numElements(other._numElements), _stride(other._stride)
 	, _componentCount(other._componentCount), _data(nullptr){
 	if(_numElements > 0 && _stride > 0){
 		const auto bufSize = _numElements * _stride;
 		_data = std::make_unique<uint8_t[]>(bufSize);
-		std::memcpy(_data.get(), other._data.get(), bufSize);
+		std::memcpy(_data.get(), other.constData(), bufSize);
 	}
 }
 
@@ -70,6 +83,8 @@ void PropertyBase::resize(size_t newSize, bool preserveData){
 	if(newSize == _numElements) return;
 	if(newSize == 0){
 		_data.reset();
+		_externalData = nullptr;
+		_keepAlive.reset();
 		_numElements = 0;
 		return;
 	}
@@ -78,12 +93,14 @@ void PropertyBase::resize(size_t newSize, bool preserveData){
 	const auto newBufSize = newSize * _stride;
 	auto newData = std::make_unique<uint8_t[]>(newBufSize);
 
-	if(preserveData && _data){
+	if(preserveData && constData()){
 		const auto copySize = std::min(_numElements * _stride, newBufSize);
-		std::memcpy(newData.get(), _data.get(), copySize);
+		std::memcpy(newData.get(), constData(), copySize);
 	}
 
 	_data = std::move(newData);
+	_externalData = nullptr;
+	_keepAlive.reset();
 	_numElements = newSize;
 }
 
@@ -0,0 +1,298 @@
+#include <opendxa/core/snapshot.h>
+#include <opendxa/core/mapped_file.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace OpenDXA{
+
+using namespace OpenDXA::Particles;
+
+namespace {
+
+constexpr char Magic[8] = {'D', 'X', 'A', 'S', 'N', 'A', 'P', '\0'};
+
+struct SnapshotHeader{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t columnCount;
+    std::int64_t timestep;
+    std::uint64_t natoms;
+    // Cell matrix columns a, b, c and origin.
+    double cell[4][3];
+    std::uint8_t pbc[3];
+    std::uint8_t reserved[5];
+    std::uint64_t directoryOffset;
+};
+
+struct SnapshotColumn{
+    char name[64];
+    std::int32_t dataType;
+    std::uint32_t componentCount;
+    std::uint64_t offset;
+    std::uint64_t stride;
+};
+
+static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+static_assert(std::is_trivially_copyable_v<SnapshotColumn>);
+static_assert(sizeof(Point3) == 3 * sizeof(double), "position column is stored as packed Point3");
+
+struct ColumnSource{
+    std::string name;
+    DataType dataType;
+    std::size_t componentCount;
+    std::size_t stride;
+    const void* data;
+};
+
+inline std::uint64_t alignUp(std::uint64_t value){
+    return (value + Snapshot::Alignment - 1) / Snapshot::Alignment * Snapshot::Alignment;
+}
+
+std::size_t elementSize(DataType dataType){
+    switch(dataType){
+        case DataType::Int: return sizeof(int);
+        case DataType::Int64: return sizeof(std::int64_t);
+        case DataType::Double: return sizeof(double);
+        default: return 0;
+    }
+}
+
+// True if the column holds packed elements of the given type and width.
+bool hasLayout(const SnapshotColumn& column, DataType dataType, std::size_t componentCount){
+    return static_cast<DataType>(column.dataType) == dataType &&
+        column.componentCount == componentCount &&
+        column.stride == componentCount * elementSize(dataType);
+}
+
+// Extra columns may be padded, but each element must fit in its stride.
+bool hasValidLayout(const SnapshotColumn& column){
+    const std::size_t size = elementSize(static_cast<DataType>(column.dataType));
+    return size != 0 && column.componentCount != 0 && column.stride >= column.componentCount * size;
+}
+
+std::shared_ptr<ParticleProperty> mapColumn(
+    const std::shared_ptr<MappedFile>& mapped,
+    const SnapshotColumn& column,
+    std::size_t natoms,
+    ParticleProperty::Type type
+){
+    return std::make_shared<ParticleProperty>(
+        mapped->writableData() + column.offset,
+        natoms,
+        static_cast<DataType>(column.dataType),
+        column.componentCount,
+        column.stride,
+        mapped,
+        type);
+}
+
+} // namespace
+
+bool Snapshot::isSnapshot(const std::string &filename){
+    std::ifstream file(filename, std::ios::binary);
+    char head[sizeof(Magic)] = {};
+    return file.read(head, sizeof(head)) && std::memcmp(head, Magic, sizeof(Magic)) == 0;
+}
+
+// Columns are written in directory order, each padded to the alignment.
+// The file is written under a unique temporary name and renamed into place.
+bool Snapshot::write(const std::string &filename, const LammpsParser::Frame &frame){
+    const std::size_t natoms = static_cast<std::size_t>(frame.natoms);
+    const Point3* positions = frame.positionData();
+    if(!positions || frame.ids.size() != natoms || frame.types.size() != natoms){
+        spdlog::error("Snapshot: frame arrays do not match natoms = {}", natoms);
+        return false;
+    }
+
+    std::vector<ColumnSource> sources;
+    sources.push_back({ "position", DataType::Double, 3, sizeof(Point3), positions });
+    sources.push_back({ "id", DataType::Int64, 1, sizeof(AtomId), frame.ids.data() });
+    sources.push_back({ "type", DataType::Int, 1, sizeof(int), frame.types.data() });
+    if(frame.sourceIndices.size() == natoms){
+        sources.push_back({ "source_index", DataType::Int64, 1, sizeof(std::size_t), frame.sourceIndices.data() });
+    }
+    for(const auto& [name, property] : frame.properties){
+        if(!property || property->size() != natoms) continue;
+        if(name.size() >= sizeof(SnapshotColumn::name)){
+            spdlog::warn("Snapshot: skipping column '{}', name too long", name);
+            continue;
+        }
+        sources.push_back({ name, property->dataType(), property->componentCount(), property->stride(), property->constData() });
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.columnCount = static_cast<std::uint32_t>(sources.size());
+    header.timestep = frame.timestep;
+    header.natoms = natoms;
+    const AffineTransformation& cell = frame.simulationCell.matrix();
+    for(int c = 0; c < 4; ++c){
+        header.cell[c][0] = cell.column(c).x();
+        header.cell[c][1] = cell.column(c).y();
+        header.cell[c][2] = cell.column(c).z();
+    }
+    for(int d = 0; d < 3; ++d){
+        header.pbc[d] = frame.simulationCell.pbcFlags()[d] ? 1 : 0;
+    }
+    header.directoryOffset = sizeof(SnapshotHeader);
+
+    std::vector<SnapshotColumn> directory(sources.size());
+    std::uint64_t offset = alignUp(header.directoryOffset + directory.size() * sizeof(SnapshotColumn));
+    for(std::size_t i = 0; i < sources.size(); ++i){
+        SnapshotColumn& column = directory[i];
+        std::memset(&column, 0, sizeof(column));
+        std::memcpy(column.name, sources[i].name.data(), sources[i].name.size());
+        column.dataType = static_cast<std::int32_t>(sources[i].dataType);
+        column.componentCount = static_cast<std::uint32_t>(sources[i].componentCount);
+        column.stride = sources[i].stride;
+        column.offset = offset;
+        offset = alignUp(offset + natoms * sources[i].stride);
+    }
+
+    // The temporary file gets a random suffix and is created exclusively,
+    // so concurrent writers of the same snapshot never share it. It lives
+    // next to the target so the rename stays on one filesystem.
+    std::random_device random;
+    std::string tmp;
+    std::ofstream out;
+    for(int attempt = 0; attempt < 16 && !out.is_open(); ++attempt){
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", unsigned(random()), unsigned(random()));
+        tmp = filename + suffix;
+        out.open(tmp, std::ios::binary | std::ios::noreplace);
+    }
+    if(!out.is_open()){
+        spdlog::error("Snapshot: cannot create a temporary file for {}", filename);
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(SnapshotColumn));
+
+    static const char padding[Alignment] = {};
+    std::uint64_t position = header.directoryOffset + directory.size() * sizeof(SnapshotColumn);
+    for(std::size_t i = 0; i < sources.size(); ++i){
+        out.write(padding, static_cast<std::streamsize>(directory[i].offset - position));
+        const std::uint64_t bytes = natoms * sources[i].stride;
+        out.write(static_cast<const char*>(sources[i].data), static_cast<std::streamsize>(bytes));
+        position = directory[i].offset + bytes;
+    }
+    out.write(padding, static_cast<std::streamsize>(alignUp(position) - position));
+    out.close();
+
+    std::error_code ec;
+    if(!out){
+        spdlog::error("Snapshot: write to {} failed", tmp);
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    std::filesystem::rename(tmp, filename, ec);
+    if(ec){
+        spdlog::error("Snapshot: cannot move {} into place: {}", tmp, ec.message());
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::read(const std::string &filename, LammpsParser::Frame &frame){
+    auto mapped = std::make_shared<MappedFile>(filename, true, true);
+    if(!mapped->valid() || mapped->size() < sizeof(SnapshotHeader)){
+        spdlog::error("Snapshot: cannot map {}", filename);
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, mapped->data(), sizeof(header));
+    if(std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion){
+        spdlog::error("Snapshot: {} is not a version {} snapshot", filename, FormatVersion);
+        return false;
+    }
+    if(header.natoms > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) ||
+       !LammpsParser::acceptAtomCount(static_cast<std::int64_t>(header.natoms))){
+        spdlog::error("Snapshot: unsupported atom count {}", header.natoms);
+        return false;
+    }
+    const std::size_t natoms = static_cast<std::size_t>(header.natoms);
+    if(header.directoryOffset + header.columnCount * sizeof(SnapshotColumn) > mapped->size()){
+        spdlog::error("Snapshot: truncated column directory in {}", filename);
+        return false;
+    }
+
+    std::vector<SnapshotColumn> directory(header.columnCount);
+    std::memcpy(directory.data(), mapped->data() + header.directoryOffset, directory.size() * sizeof(SnapshotColumn));
+
+    frame.timestep = header.timestep;
+    frame.natoms = static_cast<std::int64_t>(natoms);
+    frame.simulationCell.setMatrix(AffineTransformation(
+        Vector3(header.cell[0][0], header.cell[0][1], header.cell[0][2]),
+        Vector3(header.cell[1][0], header.cell[1][1], header.cell[1][2]),
+        Vector3(header.cell[2][0], header.cell[2][1], header.cell[2][2]),
+        Vector3(header.cell[3][0], header.cell[3][1], header.cell[3][2])));
+    frame.simulationCell.setPbcFlags(header.pbc[0] != 0, header.pbc[1] != 0, header.pbc[2] != 0);
+    frame.positions.clear();
+    frame.positionProperty.reset();
+    frame.properties.clear();
+    frame.sourceIndices.clear();
+
+    bool hasPositions = false, hasIds = false, hasTypes = false;
+    for(const SnapshotColumn& column : directory){
+        const std::string name(column.name, strnlen(column.name, sizeof(column.name)));
+        const bool validLayout =
+            name == "position" ? hasLayout(column, DataType::Double, 3) :
+            // Snapshots written before ids became 64-bit store them as Int.
+            name == "id" ? hasLayout(column, DataType::Int64, 1) || hasLayout(column, DataType::Int, 1) :
+            name == "type" ? hasLayout(column, DataType::Int, 1) :
+            name == "source_index" ? hasLayout(column, DataType::Int64, 1) :
+            hasValidLayout(column);
+        if(!validLayout){
+            spdlog::error("Snapshot: column '{}' in {} has an unexpected type or stride", name, filename);
+            return false;
+        }
+        if(column.offset % Alignment != 0 || column.offset > mapped->size() ||
+           column.stride > (mapped->size() - column.offset) / natoms){
+            spdlog::error("Snapshot: column '{}' lies outside {}", name, filename);
+            return false;
+        }
+        const char* data = mapped->data() + column.offset;
+
+        if(name == "position"){
+            frame.positionProperty = mapColumn(mapped, column, natoms, ParticleProperty::PositionProperty);
+            hasPositions = true;
+        }else if(name == "id"){
+            if(static_cast<DataType>(column.dataType) == DataType::Int){
+                const int* ids = reinterpret_cast<const int*>(data);
+                frame.ids.assign(ids, ids + natoms);
+            }else{
+                const AtomId* ids = reinterpret_cast<const AtomId*>(data);
+                frame.ids.assign(ids, ids + natoms);
+            }
+            hasIds = true;
+        }else if(name == "type"){
+            const int* types = reinterpret_cast<const int*>(data);
+            frame.types.assign(types, types + natoms);
+            hasTypes = true;
+        }else if(name == "source_index"){
+            const std::size_t* indices = reinterpret_cast<const std::size_t*>(data);
+            frame.sourceIndices.assign(indices, indices + natoms);
+        }else{
+            frame.properties.emplace(name, mapColumn(mapped, column, natoms, ParticleProperty::UserProperty));
+        }
+    }
+
+    if(!hasPositions || !hasIds || !hasTypes){
+        spdlog::error("Snapshot: {} lacks position, id or type column", filename);
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,161 @@
+#include <opendxa/core/spatial_sort.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <string>
+
+namespace OpenDXA{
+
+namespace {
+
+// Bits per axis of the Morton key; three of them fill 63 bits.
+constexpr int MortonBits = 21;
+
+// Spreads the low 21 bits of v so that there are two zero bits between
+// consecutive ones.
+std::uint64_t spreadBits(std::uint64_t v){
+    v &= 0x1fffff;
+    v = (v | (v << 32)) & 0x1f00000000ffffull;
+    v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+    v = (v | (v << 8)) & 0x100f00f00f00f00full;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+template <typename T>
+void permute(std::vector<T> &values, const std::vector<std::size_t> &order){
+    std::vector<T> sorted(values.size());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, order.size()), [&](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t i = r.begin(); i < r.end(); ++i){
+            sorted[i] = values[order[i]];
+        }
+    });
+    values.swap(sorted);
+}
+
+// Permuted owning copy of a property; mapped snapshot columns are left
+// untouched.
+std::shared_ptr<Particles::ParticleProperty> permute(const Particles::ParticleProperty &property, const std::vector<std::size_t> &order){
+    auto sorted = std::make_shared<Particles::ParticleProperty>(property);
+    const std::size_t stride = property.stride();
+    const auto* source = static_cast<const std::uint8_t*>(property.constData());
+    auto* target = static_cast<std::uint8_t*>(sorted->data());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, order.size()), [&](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t i = r.begin(); i < r.end(); ++i){
+            std::memcpy(target + i * stride, source + order[i] * stride, stride);
+        }
+    });
+    return sorted;
+}
+
+}
+
+bool SpatialSort::enabledFromEnvironment(){
+    const char* value = std::getenv("OPENDXA_SPATIAL_SORT");
+    if(!value) return false;
+    std::string text = value;
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){
+        return static_cast<char>(std::tolower(c));
+    });
+    return text == "1" || text == "true" || text == "yes" || text == "on";
+}
+
+void SpatialSort::reorder(LammpsParser::Frame &frame){
+    const std::size_t natoms = static_cast<std::size_t>(frame.natoms);
+    const Point3* positions = nullptr;
+    if(frame.positionProperty && frame.positionProperty->size() == natoms){
+        positions = frame.positionProperty->constDataPoint3();
+    }else if(frame.positions.size() == natoms){
+        positions = frame.positions.data();
+    }
+    if(!positions || natoms < 2) return;
+
+    // Reduced coordinates are normalized by the range the atoms actually
+    // span, so atoms outside a non-periodic box still get distinct keys.
+    const SimulationCell& cell = frame.simulationCell;
+    std::vector<Point3> reduced(natoms);
+    const Box3 range = tbb::parallel_reduce(tbb::blocked_range<std::size_t>(0, natoms), Box3(),
+        [&](const tbb::blocked_range<std::size_t>& r, Box3 box){
+            for(std::size_t i = r.begin(); i < r.end(); ++i){
+                reduced[i] = cell.absoluteToReduced(positions[i]);
+                box.addPoint(reduced[i]);
+            }
+            return box;
+        },
+        [](Box3 a, const Box3& b){
+            if(!b.isEmpty()){
+                a.addPoint(b.minc);
+                a.addPoint(b.maxc);
+            }
+            return a;
+        });
+
+    constexpr double MaxCell = double((1u << MortonBits) - 1);
+    double scale[3];
+    for(int k = 0; k < 3; ++k){
+        const double extent = range.maxc[k] - range.minc[k];
+        scale[k] = extent > 0 ? MaxCell / extent : 0;
+    }
+
+    std::vector<std::uint64_t> keys(natoms);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, natoms), [&](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t i = r.begin(); i < r.end(); ++i){
+            std::uint64_t key = 0;
+            for(int k = 0; k < 3; ++k){
+                const double cellIndex = std::clamp((reduced[i][k] - range.minc[k]) * scale[k], 0.0, MaxCell);
+                key |= spreadBits(static_cast<std::uint64_t>(cellIndex)) << k;
+            }
+            keys[i] = key;
+        }
+    });
+
+    // Ties keep their dump order, so the result does not depend on the
+    // number of threads.
+    std::vector<std::size_t> order(natoms);
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    tbb::parallel_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b){
+        return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    });
+
+    if(frame.positions.size() == natoms) permute(frame.positions, order);
+    if(frame.types.size() == natoms) permute(frame.types, order);
+    if(frame.ids.size() == natoms) permute(frame.ids, order);
+    if(frame.positionProperty && frame.positionProperty->size() == natoms){
+        frame.positionProperty = permute(*frame.positionProperty, order);
+    }
+    for(auto& [name, property] : frame.properties){
+        if(property && property->size() == natoms) property = permute(*property, order);
+    }
+
+    // Compose with the rows an AtomFilter already recorded.
+    if(frame.sourceIndices.size() == natoms){
+        permute(frame.sourceIndices, order);
+    }else{
+        frame.sourceIndices = std::move(order);
+    }
+    spdlog::debug("Sorted {} atoms along a Morton curve", natoms);
+}
+
+std::vector<std::size_t> SpatialSort::exportOrder(const LammpsParser::Frame &frame){
+    const std::vector<std::size_t>& rows = frame.sourceIndices;
+    if(rows.size() != static_cast<std::size_t>(frame.natoms) || std::is_sorted(rows.begin(), rows.end())){
+        return {};
+    }
+    std::vector<std::size_t> order(rows.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    tbb::parallel_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b){
+        return rows[a] < rows[b];
+    });
+    return order;
+}
+
+}
@@ -8,6 +8,7 @@ void showUsage(const std::string& name) {
     printUsageHeader(name, "OpenDXA - Cluster Analysis");
     std::cerr
         << "  --cutoff <float>              Cutoff radius for neighbor search. [default: 3.2]\n"
+        << "  --precision <double|single>   Neighbor search precision. [default: double]\n"
         << "  --sortBySize                  Sort clusters by size (desc). [default: true]\n"
         << "  --unwrap                      Unwrap particle coordinates inside clusters. [default: false]\n"
         << "  --centersOfMass               Compute cluster centers (uniform weights). [default: false]\n"
@@ -41,6 +42,7 @@ int main(int argc, char* argv[]) {
 
     ClusterAnalysisAnalyzer analyzer;
     analyzer.setCutoff(getDouble(opts, "--cutoff", 3.2));
+    analyzer.setSearchPrecision(parseSearchPrecision(getString(opts, "--precision", "double")));
 
     analyzer.setOptions(
         getBool(opts, "--sortBySize", true),
@@ -8,7 +8,11 @@ void showUsage(const std::string& name) {
     printUsageHeader(name, "OpenDXA - Coordination Analysis");
     std::cerr
         << "  --cutoff <float>              Cutoff radius for neighbor search. [default: 3.2]\n"
+        << "  --precision <double|single>   Neighbor search precision. [default: double]\n"
         << "  --rdfBins <int>               Number of bins for RDF calculation. [default: 500]\n"
+        << "  --allFrames                   Analyze every frame, writing <output_base>.<timestep>.* outputs.\n"
+        << "  --pipelineDepth <int>         Frame buffers for --allFrames, 2 or more. [default: 2]\n"
+        << "  --skin <float>                Verlet skin reused across frames with --allFrames, 0 to rebuild every frame. [default: 0.3]\n"
         << "  --threads <int>               Max worker threads (TBB/OMP). [default: auto]\n";
     printHelpOption();
 }
@@ -30,16 +34,33 @@ int main(int argc, char* argv[]) {
     auto parallel = initParallelism(opts, false);
     initLogging("opendxa-coordination", parallel.threads);
     
-    LammpsParser::Frame frame;
-    if (!parseFrame(filename, frame)) return 1;
-    
     outputBase = deriveOutputBase(filename, outputBase);
     spdlog::info("Output base: {}", outputBase);
     
     CoordinationAnalyzer analyzer;
     analyzer.setCutoff(getDouble(opts, "--cutoff", 3.2));
+    analyzer.setSearchPrecision(parseSearchPrecision(getString(opts, "--precision", "double")));
     analyzer.setRdfBins(getInt(opts, "--rdfBins", 500));
     
+    if (hasOption(opts, "--allFrames")) {
+        // Atoms move little between frames, so one neighbor list serves many of them.
+        analyzer.setNeighborSkin(getDouble(opts, "--skin", 0.3));
+        const size_t depth = static_cast<size_t>(std::max(2, getInt(opts, "--pipelineDepth", 2)));
+        const bool analyzed = forEachFrame(filename, {}, {}, depth, [&](const LammpsParser::Frame& frame) {
+            spdlog::info("Starting coordination analysis of timestep {}...", frame.timestep);
+            json result = analyzer.compute(frame, outputBase + "." + std::to_string(frame.timestep));
+            if (result.value("is_failed", false)) {
+                spdlog::error("Analysis of timestep {} failed: {}", frame.timestep, result.value("error", "Unknown error"));
+                return false;
+            }
+            return true;
+        });
+        return analyzed ? 0 : 1;
+    }
+
+    LammpsParser::Frame frame;
+    if (!parseFrame(filename, frame)) return 1;
+
     spdlog::info("Starting coordination analysis...");
     json result = analyzer.compute(frame, outputBase);
     
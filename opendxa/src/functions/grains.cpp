@@ -8,6 +8,7 @@ void showUsage(const std::string& name) {
     printUsageHeader(name, "OpenDXA - Grain Segmentation");
     std::cerr
         << "  --rmsd <float>                        RMSD threshold for PTM. [default: 0.1]\n"
+        << "  --precision <double|single>           Neighbor search precision. [default: double]\n"
         << "  --minGrainAtomCount <int>             Minimum atoms per grain. [default: 100]\n"
         << "  --adoptOrphanAtoms <true|false>       Adopt orphan atoms. [default: true]\n"
         << "  --handleCoherentInterfaces <true|false> Handle coherent interfaces. [default: true]\n"
@@ -53,6 +54,7 @@ int main(int argc, char* argv[]) {
     GrainSegmentationAnalyzer analyzer;
     analyzer.setIdentificationMode(StructureAnalysis::Mode::PTM);
     analyzer.setRMSD(getDouble(opts, "--rmsd", 0.1f));
+    analyzer.setSearchPrecision(parseSearchPrecision(getString(opts, "--precision", "double")));
     analyzer.setParameters(
         adoptOrphanAtoms,
         minGrainAtomCount,
@@ -9,12 +9,15 @@ void showUsage(const std::string& name) {
         << "  --crystalStructure <type>         Reference crystal structure. (BCC|FCC|HCP|CUBIC_DIAMOND|HEX_DIAMOND|SC) [default: BCC]\n"
         << "  --identificationMode <mode>       Structure identification mode. (CNA|PTM|DIAMOND) [default: CNA]\n"
         << "  --rmsd <float>                    RMSD threshold for PTM. [default: 0.1]\n"
+        << "  --precision <type>                Neighbor search precision. (double|single) [default: double]\n"
         << "  --maxTrialCircuitSize <int>       Maximum Burgers circuit size. [default: 14]\n"
         << "  --circuitStretchability <int>     Circuit stretchability factor. [default: 9]\n"
         << "  --lineSmoothingLevel <float>      Line smoothing level. [default: 1]\n"
         << "  --linePointInterval <float>       Point interval on dislocation lines. [default: 2.5]\n"
         << "  --onlyPerfectDislocations <bool>  Detect only perfect dislocations. [default: false]\n"
         << "  --markCoreAtoms <bool>            Mark dislocation core atoms. [default: false]\n"
+        << "  --allFrames                       Analyze every frame, writing <output_base>.<timestep>.* outputs.\n"
+        << "  --pipelineDepth <int>             Frame buffers for --allFrames, 2 or more. [default: 2]\n"
         << "  --threads <int>                   Max worker threads (TBB/OMP). [default: 1]\n";
     printHelpOption();
 }
@@ -36,9 +39,6 @@ int main(int argc, char* argv[]) {
     auto parallel = initParallelism(opts, false);
     initLogging("opendxa-dxa", parallel.threads);
     
-    LammpsParser::Frame frame;
-    if (!parseFrame(filename, frame)) return 1;
-    
     outputBase = deriveOutputBase(filename, outputBase);
     spdlog::info("Output base: {}", outputBase);
     
@@ -47,6 +47,7 @@ int main(int argc, char* argv[]) {
     analyzer.setInputCrystalStructure(parseCrystalStructure(getString(opts, "--crystalStructure", "BCC")));
     analyzer.setIdentificationMode(parseIdentificationMode(getString(opts, "--identificationMode", "CNA")));
     analyzer.setRmsd(getDouble(opts, "--rmsd", 0.1f));
+    analyzer.setSearchPrecision(parseSearchPrecision(getString(opts, "--precision", "double")));
     analyzer.setMaxTrialCircuitSize(getInt(opts, "--maxTrialCircuitSize", 14));
     analyzer.setCircuitStretchability(getInt(opts, "--circuitStretchability", 9));
     analyzer.setLineSmoothingLevel(getDouble(opts, "--lineSmoothingLevel", 1.0));
@@ -54,6 +55,24 @@ int main(int argc, char* argv[]) {
     analyzer.setOnlyPerfectDislocations(getBool(opts, "--onlyPerfectDislocations"));
     analyzer.setMarkCoreAtoms(getBool(opts, "--markCoreAtoms"));
     
+    if (hasOption(opts, "--allFrames")) {
+        // The next frame is parsed on the reader thread while this one is analyzed.
+        const size_t depth = static_cast<size_t>(std::max(2, getInt(opts, "--pipelineDepth", 2)));
+        const bool analyzed = forEachFrame(filename, {}, {}, depth, [&](const LammpsParser::Frame& frame) {
+            spdlog::info("Starting dislocation analysis of timestep {}...", frame.timestep);
+            json result = analyzer.compute(frame, outputBase + "." + std::to_string(frame.timestep));
+            if (result.value("is_failed", false)) {
+                spdlog::error("Analysis of timestep {} failed: {}", frame.timestep, result.value("error", "Unknown error"));
+                return false;
+            }
+            return true;
+        });
+        return analyzed ? 0 : 1;
+    }
+
+    LammpsParser::Frame frame;
+    if (!parseFrame(filename, frame)) return 1;
+
     spdlog::info("Starting dislocation analysis...");
     json result = analyzer.compute(frame, outputBase);
     
@@ -8,6 +8,7 @@ void showUsage(const std::string& name) {
     std::cerr
         << "  --mode <mode>     Identification mode. (CNA|PTM|DIAMOND) [default: CNA]\n"
         << "  --rmsd <float>    RMSD threshold for PTM. [default: 0.1]\n"
+        << "  --precision <mode> Neighbor search precision. (double|single) [default: double]\n"
         << "  --threads <int>   Max worker threads (TBB/OMP). [default: auto]\n";
     printHelpOption();
 }
@@ -39,6 +40,7 @@ int main(int argc, char* argv[]) {
     analyzer.setStructureIdentificationOnly(true);
     analyzer.setIdentificationMode(parseIdentificationMode(getString(opts, "--mode", "CNA")));
     analyzer.setRmsd(getDouble(opts, "--rmsd", 0.1f));
+    analyzer.setSearchPrecision(parseSearchPrecision(getString(opts, "--precision", "double")));
     
     spdlog::info("Starting structure identification...");
     json result = analyzer.compute(frame, outputBase);
@@ -167,11 +167,11 @@ bool DelaunayTessellation::classifyGhostCell(CellHandle cell) const{
 
 	// Identify the corner with minimum "vertexIndex"
 	VertexHandle headVertex = cellVertex(cell, 0);
-	int headVertexIndex = vertexIndex(headVertex);
+	AtomIndex headVertexIndex = vertexIndex(headVertex);
 	assert(headVertexIndex >= 0);
 	for(int v = 1; v < 4; v++){
 		VertexHandle p = cellVertex(cell, v);
-		int vindex = vertexIndex(p);
+		AtomIndex vindex = vertexIndex(p);
 		assert(vindex >= 0);
 		if(vindex < headVertexIndex){
 			headVertex = p;
@@ -89,7 +89,7 @@ void InterfaceMesh::createMesh(double maxNeighborDist){
     // imply the simulation cell is too small for the neighbor distance.
     auto prepareFace = [&](
 		Face* face,
-		std::array<int, 3> const& vIdx,
+		std::array<AtomIndex, 3> const& vIdx,
 		std::array<decltype(tessellation().cellVertex(0,0)),3> const& vH,
 		auto cell
 	){
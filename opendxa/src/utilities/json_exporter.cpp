@@ -655,8 +655,10 @@ json DXAJsonExporter::getAtomsData(
     const std::vector<int>* structureTypes
 ){
     std::map<std::string, json> groupedAtoms;
+    const Point3* positions = frame.positionData();
 
-    for(size_t i = 0; i < frame.natoms; ++i){
+    for(size_t row = 0; row < static_cast<size_t>(frame.natoms); ++row){
+        const size_t i = atomAt(row);
         int structureType = 0;
         if(structureTypes && i < static_cast<int>(structureTypes->size())){
             structureType = (*structureTypes)[i];
@@ -673,8 +675,8 @@ json DXAJsonExporter::getAtomsData(
             //atomJson["ptm_quaternion"] = {quat.x(), quat.y(), quat.z(), quat.w()};
         }
         
-        if(i < static_cast<int>(frame.positions.size())){
-            const auto& pos = frame.positions[i];
+        if(positions){
+            const auto& pos = positions[i];
             atomJson["pos"] = {pos.x(), pos.y(), pos.z()};
         }else{
             atomJson["pos"] = {0.0, 0.0, 0.0};
@@ -692,7 +694,7 @@ json DXAJsonExporter::getAtomsData(
 
 json DXAJsonExporter::getAtomicStrainData(
     const AtomicStrainModifier::AtomicStrainEngine& engine,
-    const std::vector<int>& ids
+    const std::vector<AtomId>& ids
 ){
     json result;
     
@@ -711,7 +713,8 @@ json DXAJsonExporter::getAtomicStrainData(
     double maxShear = 0.0;
     int count = 0;
 
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         if(shear){
             double s = shear->getDouble(i);
             totalShear += s;
@@ -733,7 +736,8 @@ json DXAJsonExporter::getAtomicStrainData(
     };
 
     json dataArray = json::array();
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         json atomData;
         atomData["id"] = ids[i];
         atomData["shear_strain"] = shear ? shear->getDouble(i) : 0.0;
@@ -768,7 +772,7 @@ json DXAJsonExporter::getAtomicStrainData(
 
 json DXAJsonExporter::getElasticStrainData(
     const ElasticStrainEngine& engine,
-    const std::vector<int>& ids
+    const std::vector<AtomId>& ids
 ){
     json result;
     
@@ -781,7 +785,8 @@ json DXAJsonExporter::getElasticStrainData(
     // Summary stats
     double totalVolumetric = 0.0;
     int count = 0;
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         if(volumetric){
             totalVolumetric += volumetric->getDouble(i);
         }
@@ -797,7 +802,8 @@ json DXAJsonExporter::getElasticStrainData(
     };
 
     json dataArray = json::array();
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         json atomData;
         atomData["id"] = ids[i];
 
@@ -826,7 +832,7 @@ json DXAJsonExporter::getElasticStrainData(
 
 json DXAJsonExporter::getPTMData(
     const AnalysisContext& context,
-    const std::vector<int>& ids
+    const std::vector<AtomId>& ids
 ){
     json result;
     auto ptmProp = context.ptmOrientation;
@@ -839,7 +845,8 @@ json DXAJsonExporter::getPTMData(
     size_t n = ids.size();
     json dataArray = json::array();
 
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         json atomData;
         atomData["id"] = ids[i];
         atomData["correspondence"] = corrProp->getInt64(i);
@@ -861,7 +868,7 @@ json DXAJsonExporter::getPTMData(
 
 void DXAJsonExporter::exportPTMData(
     const AnalysisContext& context,
-    const std::vector<int>& ids,
+    const std::vector<AtomId>& ids,
     const std::string& outputFilename
 ){
     json data = getPTMData(context, ids);
@@ -880,13 +887,14 @@ void DXAJsonExporter::exportCoreAtoms(
     if(coreAtomIndices.empty()) return;
 
     json dataArray = json::array();
+    const Point3* positions = frame.positionData();
     for(int atomIdx : coreAtomIndices){
         if(atomIdx >= 0 && atomIdx < static_cast<int>(frame.natoms)){
             json atomData;
             atomData["id"] = frame.ids[atomIdx];
             
-            if(atomIdx < static_cast<int>(frame.positions.size())){
-                const auto& pos = frame.positions[atomIdx];
+            if(positions){
+                const auto& pos = positions[atomIdx];
                 atomData["pos"] = {pos.x(), pos.y(), pos.z()};
             }
             
@@ -1245,7 +1253,7 @@ std::string DXAJsonExporter::getLineDirectionString(const Vector3& direction){
 
 json DXAJsonExporter::getCentroSymmetryData(
     const CentroSymmetryAnalysis::Engine& engine,
-    const std::vector<int>& ids
+    const std::vector<AtomId>& ids
 ){
     json out;
 
@@ -1262,7 +1270,8 @@ json DXAJsonExporter::getCentroSymmetryData(
 
     // per-atom
     json atoms = json::array();
-    for(std::size_t i = 0; i < n; i++){
+    for(std::size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         atoms.push_back({
             {"id", ids[i]},
             {"csp", csp ? csp->getDouble(i) : 0.0}
@@ -1289,7 +1298,7 @@ json DXAJsonExporter::getCentroSymmetryData(
 
 json DXAJsonExporter::getClusterAnalysisData(
     const ClusterAnalysis::ClusterAnalysisEngine& engine,
-    const std::vector<int>& ids
+    const std::vector<AtomId>& ids
 ){
     json out;
 
@@ -1342,7 +1351,8 @@ json DXAJsonExporter::getClusterAnalysisData(
 
     // per-atom assignments
     json atoms = json::array();
-    for(size_t i = 0; i < n; i++){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         json a;
         a["id"] = ids[i];
         a["cluster"] = clusters ? clusters->getInt(i) : 0;
@@ -1368,6 +1378,8 @@ void DXAJsonExporter::exportForStructureIdentification(
     constexpr int K = static_cast<int>(StructureType::NUM_STRUCTURE_TYPES);
 
     assert(frame.ids.size() == N);
+    const Point3* positions = frame.positionData();
+    assert(positions);
 
     std::vector<std::string> names(K);
     for(int st = 0; st < K; st++){
@@ -1403,9 +1415,10 @@ void DXAJsonExporter::exportForStructureIdentification(
             writer.write_key(names[st]);
             writer.write_array_header(checked_u32_size(counts[st]));
 
-            for(size_t i = 0; i < N; i++){
+            for(size_t row = 0; row < N; ++row){
+                const size_t i = atomAt(row);
                 if(stOfAtom[i] != static_cast<uint8_t>(st)) continue;
-                const Point3& pos = frame.positions[i];
+                const Point3& pos = positions[i];
                 writer.write_map_header(2);
                 writer.write_key("id");
                 writer.write_int(frame.ids[i]);
@@ -1661,7 +1674,7 @@ double DXAJsonExporter::calculateAverageVertexDegree(const InterfaceMesh* interf
 
 json DXAJsonExporter::getDisplacementsData(
     const ComputeDisplacements& engine,
-    const std::vector<int>& ids
+    const std::vector<AtomId>& ids
 ){
     json result;
 
@@ -1677,7 +1690,8 @@ json DXAJsonExporter::getDisplacementsData(
     double maxMag = 0.0;
     double minMag = std::numeric_limits<double>::max();
 
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         double m = Umag->getDouble(i);
         totalMag += m;
         if(m > maxMag) maxMag = m;
@@ -1695,7 +1709,8 @@ json DXAJsonExporter::getDisplacementsData(
     };
 
     json dataArray = json::array();
-    for(size_t i = 0; i < n; ++i){
+    for(size_t row = 0; row < n; ++row){
+        const size_t i = atomAt(row);
         json atom;
         atom["id"] = ids[i];
 
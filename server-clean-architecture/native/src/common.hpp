@@ -24,7 +24,7 @@ struct MappedFile {
     bool valid;
 };
 
-ALWAYS_INLINE MappedFile mapFile(const char* filepath) {
+ALWAYS_INLINE MappedFile mapFile(const char* filepath, bool prefetch = true) {
     MappedFile f = {nullptr, 0, -1, false};
     
     f.fd = open(filepath, O_RDONLY);
@@ -50,7 +50,7 @@ ALWAYS_INLINE MappedFile mapFile(const char* filepath) {
     }
     
     // Advise kernel for sequential access and preload
-    madvise((void*)f.data, f.size, MADV_SEQUENTIAL | MADV_WILLNEED);
+    madvise((void*)f.data, f.size, prefetch ? (MADV_SEQUENTIAL | MADV_WILLNEED) : MADV_SEQUENTIAL);
     
     f.valid = true;
     return f;
@@ -34,6 +34,8 @@ export interface ParseResult {
 export interface ParseOptions {
     includeIds?: boolean;
     properties?: string[];
+    // Zero-based frame of a multi-frame dump, located via the .dxaidx sidecar index
+    frame?: number;
 }
 
 export interface NativeDataResult {
@@ -5,6 +5,8 @@
 #include <thread>
 #include <future>
 #include "common.hpp"
+#include "external/frame_index.h"
+#include "external/simd_tokenizer.h"
 
 // ============================================================================
 // DUMP FILE METADATA
@@ -128,10 +130,17 @@ struct WorkerResult {
     int count = 0;
 };
 
+// Like fastAtof, but takes the shared tokenizer's exact fast path for the
+// fixed and exponent formats LAMMPS writes before falling back to fast_float.
+HOT ALWAYS_INLINE double tokenAtof(const char* RESTRICT p, const char* RESTRICT end) {
+    double result = 0.0;
+    OpenDXA::Tokenizer::parseDouble(p, end, result);
+    return result;
+}
+
 HOT static void parseChunk(
     const char* RESTRICT chunkStart,
     const char* RESTRICT chunkEnd,
-    const char* RESTRICT globalEnd,
     float* RESTRICT positions,
     uint16_t* RESTRICT types,
     uint32_t* RESTRICT ids,
@@ -139,67 +148,66 @@ HOT static void parseChunk(
     const ColumnMapping& cols,
     WorkerResult* result
 ) {
-    const char* p = chunkStart;
     int atomIdx = startIdx;
     BoundingBox bbox;
     bbox.init();
     
     const int maxCol = cols.maxIdx;
     
-    while (p < chunkEnd) {
-        const char* lineEnd = findLineEnd(p, globalEnd);
-        const char* content = skipWhitespace(p, lineEnd);
+    // Tokens come from the shared vectorised scanner; a token preceded by
+    // a newline starts the next atom line. Empty lines yield no tokens.
+    OpenDXA::Tokenizer::TokenScanner scanner(chunkStart, chunkEnd);
+    OpenDXA::Tokenizer::Token tok;
+    
+    float x = 0, y = 0, z = 0;
+    int type = 0;
+    uint32_t id = 0;
+    int col = -1;
+    
+    auto finishAtom = [&]() {
+        // Write directly to output buffers (zero-copy)
+        int posIdx = atomIdx * 3;
+        positions[posIdx] = x;
+        positions[posIdx + 1] = y;
+        positions[posIdx + 2] = z;
+        types[atomIdx] = (uint16_t)type;
+        if (ids) ids[atomIdx] = id;
         
-        // Skip empty lines
-        if (UNLIKELY(content >= lineEnd)) {
-            p = lineEnd + 1;
-            continue;
-        }
+        bbox.update(x, y, z);
+        atomIdx++;
+        x = y = z = 0;
+        type = 0;
+        id = 0;
+        col = -1;
+    };
+    
+    while (scanner.next(tok)) {
+        if (tok.newline && col >= 0) finishAtom();
         
-        // Stop at next ITEM: section
-        if (UNLIKELY(content[0] == 'I' && lineEnd - content >= 5 && content[4] == ':')) {
-            break;
+        if (col < 0) {
+            // Stop at next ITEM: section
+            if (UNLIKELY(tok.begin[0] == 'I' && tok.end - tok.begin >= 5 && tok.begin[4] == ':')) {
+                break;
+            }
+            col = 0;
         }
         
-        // Parse atom data
-        float x = 0, y = 0, z = 0;
-        int type = 0;
-        uint32_t id = 0;
-        
-        const char* tok = content;
-        int col = 0;
-        
-        while (tok < lineEnd && col <= maxCol) {
-            const char* tokEnd = findTokenEnd(tok, lineEnd);
-            
+        if (col <= maxCol) {
             if (col == cols.idxX) {
-                x = (float)fastAtof(tok, tokEnd);
+                x = (float)tokenAtof(tok.begin, tok.end);
             } else if (col == cols.idxY) {
-                y = (float)fastAtof(tok, tokEnd);
+                y = (float)tokenAtof(tok.begin, tok.end);
             } else if (col == cols.idxZ) {
-                z = (float)fastAtof(tok, tokEnd);
+                z = (float)tokenAtof(tok.begin, tok.end);
             } else if (col == cols.idxType) {
-                type = fastAtoi(tok, tokEnd);
+                type = fastAtoi(tok.begin, tok.end);
             } else if (ids && col == cols.idxId) {
-                id = (uint32_t)fastAtoi(tok, tokEnd);
+                id = (uint32_t)fastAtoi(tok.begin, tok.end);
             }
-            
-            tok = skipWhitespace(tokEnd, lineEnd);
-            col++;
         }
-        
-        // Write directly to output buffers (zero-copy)
-        int posIdx = atomIdx * 3;
-        positions[posIdx] = x;
-        positions[posIdx + 1] = y;
-        positions[posIdx + 2] = z;
-        types[atomIdx] = (uint16_t)type;
-        if (ids) ids[atomIdx] = id;
-        
-        bbox.update(x, y, z);
-        atomIdx++;
-        p = lineEnd + 1;
+        col++;
     }
+    if (col >= 0) finishAtom();
     
     result->bbox = bbox;
     result->count = atomIdx - startIdx;
@@ -237,6 +245,7 @@ static napi_value ParseDump(napi_env env, napi_callback_info info) {
     
     // Get options
     bool includeIds = false;
+    int64_t frameIndex = -1;
     if (argc >= 2) {
         napi_value optionsObj = args[1];
         napi_valuetype type;
@@ -246,19 +255,50 @@ static napi_value ParseDump(napi_env env, napi_callback_info info) {
             if (napi_get_named_property(env, optionsObj, "includeIds", &val) == napi_ok) {
                 napi_get_value_bool(env, val, &includeIds);
             }
+            if (napi_get_named_property(env, optionsObj, "frame", &val) == napi_ok) {
+                napi_valuetype valType;
+                napi_typeof(env, val, &valType);
+                if (valType == napi_number) napi_get_value_int64(env, val, &frameIndex);
+            }
         }
     }
     
-    // Memory-map file
-    MappedFile file = mapFile(filepath.c_str());
+    // Memory-map file. Indexed access only touches one frame, so skip the
+    // whole-file readahead and prefetch that frame once it is located.
+    MappedFile file = mapFile(filepath.c_str(), frameIndex < 0);
     if (!file.valid) {
         napi_throw_error(env, nullptr, "Failed to open file");
         return nullptr;
     }
     
+    // Locate the requested frame through the .dxaidx sidecar (built on first use)
+    const char* frameStart = file.data;
+    size_t frameSize = file.size;
+    size_t frameCount = 0;
+    if (frameIndex >= 0) {
+        OpenDXA::FrameIndex index;
+        if (!index.open(filepath, file.data, file.size)) {
+            unmapFile(file);
+            napi_throw_error(env, nullptr, "Failed to index dump frames");
+            return nullptr;
+        }
+        if ((size_t)frameIndex >= index.size()) {
+            unmapFile(file);
+            napi_throw_range_error(env, nullptr, "Frame index out of range");
+            return nullptr;
+        }
+        const OpenDXA::FrameIndexEntry& entry = index[(size_t)frameIndex];
+        frameStart = file.data + entry.offset;
+        frameSize = entry.end - entry.offset;
+        frameCount = index.size();
+        const uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+        const uint64_t alignedOffset = entry.offset - (entry.offset % page);
+        madvise((void*)(file.data + alignedOffset), entry.end - alignedOffset, MADV_WILLNEED);
+    }
+    
     // Parse header
     ColumnMapping cols;
-    DumpMetadata meta = parseDumpHeader(file.data, file.size, cols);
+    DumpMetadata meta = parseDumpHeader(frameStart, frameSize, cols);
     
     if (!meta.isValid || !meta.atomsSectionPtr) {
         unmapFile(file);
@@ -284,7 +324,7 @@ static napi_value ParseDump(napi_env env, napi_callback_info info) {
     
     // Multi-threaded parsing
     const char* dataStart = meta.atomsSectionPtr;
-    const char* dataEnd = file.data + file.size;
+    const char* dataEnd = frameStart + frameSize;
     
     unsigned int numThreads = std::thread::hardware_concurrency();
     if (numThreads == 0) numThreads = 1;
@@ -294,7 +334,7 @@ static napi_value ParseDump(napi_env env, napi_callback_info info) {
     
     if (numThreads == 1) {
         // Single-threaded fast path
-        parseChunk(dataStart, dataEnd, dataEnd, 
+        parseChunk(dataStart, dataEnd,
                    (float*)posPtr, (uint16_t*)typesPtr, (uint32_t*)idsPtr,
                    0, cols, &results[0]);
     } else {
@@ -327,7 +367,7 @@ static napi_value ParseDump(napi_env env, napi_callback_info info) {
         std::vector<std::thread> threads;
         for (unsigned int i = 0; i < numThreads; i++) {
             threads.emplace_back(parseChunk,
-                chunkPtrs[i], chunkPtrs[i+1], dataEnd,
+                chunkPtrs[i], chunkPtrs[i+1],
                 (float*)posPtr, (uint16_t*)typesPtr, (uint32_t*)idsPtr,
                 offsets[i], cols, &results[i]);
         }
@@ -368,6 +408,10 @@ static napi_value ParseDump(napi_env env, napi_callback_info info) {
     
     SET_INT(metaObj, "timestep", meta.timestep);
     SET_INT(metaObj, "natoms", meta.atomCount);
+    if (frameCount > 0) {
+        SET_INT(metaObj, "frame", (int)frameIndex);
+        SET_INT(metaObj, "frameCount", (int)frameCount);
+    }
     napi_set_named_property(env, metaObj, "boxBounds", boxObj);
     
     // Headers
@@ -0,0 +1,329 @@
+#pragma once
+
+// Byte-offset index over the frames of a LAMMPS text dump, persisted next to
+// the dump as "<dump>.dxaidx". The header only depends on the C++17 standard
+// library so the server's native addons can vendor it unchanged.
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace OpenDXA{
+
+struct FrameIndexEntry{
+    // Byte offset of the "ITEM: TIMESTEP" line.
+    uint64_t offset;
+    // Byte offset of the first atom line, right after "ITEM: ATOMS ...".
+    uint64_t atomsOffset;
+    // One past the last byte of the frame.
+    uint64_t end;
+    int64_t timestep;
+    uint64_t natoms;
+    double boxLo[3];
+    double boxHi[3];
+    double tilt[3];
+    uint8_t pbc[3];
+    uint8_t triclinic;
+    uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<FrameIndexEntry>, "FrameIndexEntry is written to disk as raw bytes");
+
+class FrameIndex{
+public:
+    static constexpr uint32_t FormatVersion = 1;
+
+    static std::string sidecarPath(const std::string& dumpPath){
+        return dumpPath + ".dxaidx";
+    }
+
+    size_t size() const{ return _entries.size(); }
+    bool empty() const{ return _entries.empty(); }
+    const FrameIndexEntry& operator[](size_t i) const{ return _entries[i]; }
+    const std::vector<FrameIndexEntry>& entries() const{ return _entries; }
+
+    // Index of the frame with the given timestep, or -1.
+    long findTimestep(int64_t timestep) const{
+        for(size_t i = 0; i < _entries.size(); ++i){
+            if(_entries[i].timestep == timestep) return static_cast<long>(i);
+        }
+        return -1;
+    }
+
+    // Load the sidecar if it matches the dump's current size and mtime,
+    // otherwise rebuild from the mapping and try to persist the result.
+    // A read-only directory only costs the rebuild on the next open.
+    bool open(const std::string& dumpPath, const char* data, size_t size, unsigned threads = 0){
+        if(load(dumpPath)) return true;
+        if(!build(data, size, threads)) return false;
+        uint64_t fileSize = 0;
+        int64_t mtime = 0;
+        if(fileStamp(dumpPath, fileSize, mtime) && fileSize == size){
+            _fileSize = fileSize;
+            _fileMtime = mtime;
+            save(dumpPath);
+        }
+        return true;
+    }
+
+    // Scan the whole dump once. Each worker memchr()s its byte range for
+    // 'I' and keeps the hits that start an "ITEM: TIMESTEP" line; atom
+    // lines almost never contain an 'I', so this runs at memchr speed.
+    // Headers are then decoded by the worker that found them.
+    bool build(const char* data, size_t size, unsigned threads = 0){
+        _entries.clear();
+        if(!data || size == 0) return false;
+
+        if(threads == 0){
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        constexpr size_t MinBytesPerThread = size_t(1) << 22;
+        threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, size / MinBytesPerThread)));
+
+        std::vector<std::vector<FrameIndexEntry>> partial(threads);
+        std::vector<char> ok(threads, 1);
+        auto worker = [&](unsigned t){
+            const size_t lo = (size * t) / threads;
+            const size_t hi = (size * (t + 1)) / threads;
+            const char* p = data + lo;
+            const char* rangeEnd = data + hi;
+            const char* end = data + size;
+            while(p < rangeEnd){
+                const char* hit = static_cast<const char*>(std::memchr(p, 'I', static_cast<size_t>(rangeEnd - p)));
+                if(!hit) break;
+                p = hit + 1;
+                if(hit != data && hit[-1] != '\n') continue;
+                if(!startsWith(hit, end, "ITEM: TIMESTEP")) continue;
+
+                FrameIndexEntry entry{};
+                entry.offset = static_cast<uint64_t>(hit - data);
+                if(!parseHeader(data, end, entry)){
+                    ok[t] = 0;
+                    return;
+                }
+                partial[t].push_back(entry);
+            }
+        };
+
+        if(threads == 1){
+            worker(0);
+        }else{
+            std::vector<std::thread> pool;
+            pool.reserve(threads);
+            for(unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+            for(auto& th : pool) th.join();
+        }
+
+        for(unsigned t = 0; t < threads; ++t){
+            if(!ok[t]) return false;
+            _entries.insert(_entries.end(), partial[t].begin(), partial[t].end());
+        }
+        for(size_t i = 0; i < _entries.size(); ++i){
+            _entries[i].end = (i + 1 < _entries.size()) ? _entries[i + 1].offset : size;
+        }
+        _fileSize = size;
+        _fileMtime = 0;
+        return !_entries.empty();
+    }
+
+    bool load(const std::string& dumpPath){
+        uint64_t fileSize = 0;
+        int64_t mtime = 0;
+        if(!fileStamp(dumpPath, fileSize, mtime)) return false;
+
+        const std::string path = sidecarPath(dumpPath);
+        std::error_code ec;
+        const uint64_t sidecarSize = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+        if(ec || sidecarSize < sizeof(Header)) return false;
+
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return false;
+
+        Header header{};
+        if(!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        if(std::memcmp(header.magic, Magic, sizeof(header.magic)) != 0) return false;
+        if(header.version != FormatVersion || header.entrySize != sizeof(FrameIndexEntry)) return false;
+        if(header.fileSize != fileSize || header.fileMtime != mtime) return false;
+        // The count must describe exactly the entries the sidecar holds, so a
+        // corrupted header cannot request an arbitrary allocation.
+        if(header.count == 0 || header.count != (sidecarSize - sizeof(Header)) / sizeof(FrameIndexEntry) ||
+           (sidecarSize - sizeof(Header)) % sizeof(FrameIndexEntry) != 0){
+            return false;
+        }
+
+        std::vector<FrameIndexEntry> entries(static_cast<size_t>(header.count));
+        if(!in.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(FrameIndexEntry)))){
+            return false;
+        }
+        // Readers index the dump mapping with these offsets; any entry that
+        // points outside the dump or out of order means the sidecar is stale
+        // or damaged and the index is rebuilt instead.
+        uint64_t previousEnd = 0;
+        for(const FrameIndexEntry& entry : entries){
+            if(entry.offset < previousEnd || entry.offset >= entry.atomsOffset ||
+               entry.atomsOffset > entry.end || entry.end > fileSize){
+                return false;
+            }
+            previousEnd = entry.end;
+        }
+        _entries = std::move(entries);
+        _fileSize = fileSize;
+        _fileMtime = mtime;
+        return true;
+    }
+
+    // Written to a temporary file and renamed so concurrent readers never
+    // observe a partially written index. The temporary name has a random
+    // suffix and is created exclusively, so processes indexing the same dump
+    // at once do not write into each other's file.
+    bool save(const std::string& dumpPath) const{
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(header.magic));
+        header.version = FormatVersion;
+        header.entrySize = sizeof(FrameIndexEntry);
+        header.fileSize = _fileSize;
+        header.fileMtime = _fileMtime;
+        header.count = _entries.size();
+
+        const std::string target = sidecarPath(dumpPath);
+        std::random_device random;
+        std::string tmp;
+        std::FILE* out = nullptr;
+        for(int attempt = 0; attempt < 16 && !out; ++attempt){
+            char suffix[32];
+            std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", unsigned(random()), unsigned(random()));
+            tmp = target + suffix;
+            out = std::fopen(tmp.c_str(), "wbx");
+        }
+        if(!out) return false;
+
+        bool written = std::fwrite(&header, sizeof(header), 1, out) == 1;
+        if(written && !_entries.empty()){
+            written = std::fwrite(_entries.data(), sizeof(FrameIndexEntry), _entries.size(), out) == _entries.size();
+        }
+        written = std::fclose(out) == 0 && written;
+
+        std::error_code ec;
+        if(!written){
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        std::filesystem::rename(tmp, target, ec);
+        if(ec){
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr char Magic[8] = {'D', 'X', 'A', 'I', 'D', 'X', '\0', '\1'};
+
+    struct Header{
+        char magic[8];
+        uint32_t version;
+        uint32_t entrySize;
+        uint64_t fileSize;
+        int64_t fileMtime;
+        uint64_t count;
+    };
+
+    static bool fileStamp(const std::string& path, uint64_t& size, int64_t& mtime){
+        std::error_code ec;
+        size = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+        if(ec) return false;
+        auto time = std::filesystem::last_write_time(path, ec);
+        if(ec) return false;
+        mtime = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    static bool startsWith(const char* p, const char* end, std::string_view prefix){
+        return static_cast<size_t>(end - p) >= prefix.size() && std::memcmp(p, prefix.data(), prefix.size()) == 0;
+    }
+
+    static const char* nextLine(const char* p, const char* end, std::string_view& line){
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* lineEnd = nl ? nl : end;
+        line = std::string_view(p, static_cast<size_t>(lineEnd - p));
+        if(!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return nl ? nl + 1 : end;
+    }
+
+    static bool nextToken(std::string_view& line, std::string_view& token){
+        size_t b = line.find_first_not_of(" \t");
+        if(b == std::string_view::npos) return false;
+        size_t e = line.find_first_of(" \t", b);
+        if(e == std::string_view::npos) e = line.size();
+        token = line.substr(b, e - b);
+        line.remove_prefix(e);
+        return true;
+    }
+
+    template <typename T>
+    static bool parseNumber(std::string_view& line, T& out){
+        std::string_view token;
+        if(!nextToken(line, token)) return false;
+        auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+        return result.ec == std::errc();
+    }
+
+    // Decode the header block that starts at entry.offset. PBC flags follow
+    // LammpsParser: the last three BOX BOUNDS tokens, periodic unless given.
+    static bool parseHeader(const char* data, const char* end, FrameIndexEntry& entry){
+        const char* p = data + entry.offset;
+        std::string_view line;
+
+        p = nextLine(p, end, line);
+        p = nextLine(p, end, line);
+        if(!parseNumber(line, entry.timestep)) return false;
+
+        p = nextLine(p, end, line);
+        if(!startsWith(line.data(), line.data() + line.size(), "ITEM: NUMBER OF ATOMS")) return false;
+        p = nextLine(p, end, line);
+        if(!parseNumber(line, entry.natoms)) return false;
+
+        p = nextLine(p, end, line);
+        if(!startsWith(line.data(), line.data() + line.size(), "ITEM: BOX BOUNDS")) return false;
+        entry.triclinic = line.find("xy") != std::string_view::npos ? 1 : 0;
+        std::string_view tokens[3];
+        size_t count = 0;
+        std::string_view token;
+        while(nextToken(line, token)){
+            tokens[count % 3] = token;
+            ++count;
+        }
+        for(int i = 0; i < 3; ++i){
+            entry.pbc[i] = (count >= 6) ? (tokens[(count + i) % 3] == "pp") : 1;
+        }
+
+        for(int i = 0; i < 3; ++i){
+            p = nextLine(p, end, line);
+            if(!parseNumber(line, entry.boxLo[i])) return false;
+            if(!parseNumber(line, entry.boxHi[i])) return false;
+            if(!parseNumber(line, entry.tilt[i])) entry.tilt[i] = 0.0;
+        }
+
+        p = nextLine(p, end, line);
+        if(!startsWith(line.data(), line.data() + line.size(), "ITEM: ATOMS")) return false;
+        entry.atomsOffset = static_cast<uint64_t>(p - data);
+        return true;
+    }
+
+    std::vector<FrameIndexEntry> _entries;
+    uint64_t _fileSize = 0;
+    int64_t _fileMtime = 0;
+};
+
+}
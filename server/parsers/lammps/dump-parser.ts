@@ -17,7 +17,7 @@ interface NativeDumpResult {
 }
 
 interface NativeModule {
-    parseDump(filePath: string, options: { includeIds?: boolean; properties?: string[] }): NativeDumpResult | undefined;
+    parseDump(filePath: string, options: { includeIds?: boolean; properties?: string[]; frame?: number }): NativeDumpResult | undefined;
 }
 
 const nativePath = path.join(process.cwd(), 'native/build/Release/dump_parser.node');
@@ -34,7 +34,8 @@ export default class LammpsDumpParser {
     public parse(filePath: string, options: ParseOptions = {}): ParseResult {
         const result = nativeModule.parseDump(filePath, {
             includeIds: options.includeIds,
-            properties: options.properties
+            properties: options.properties,
+            frame: options.frame
         });
 
         if (!result) {